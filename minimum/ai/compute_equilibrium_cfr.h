@@ -0,0 +1,797 @@
+#pragma once
+// Iterative computation of Nash equilibria of two-player zero-sum
+// games of imperfect information, using the same State and
+// InformationSet concepts as compute_equilibrium_sequential.h.
+//
+// Unlike the linear program, which needs the sequence-form matrices,
+// memory use is a few numbers per move of every information set.
+//
+// Algorithms from
+//
+// [1] Tammelin, O. (2014). Solving large imperfect information games
+//     using CFR+. arXiv:1407.5042.
+//
+// [2] Lanctot, M., Waugh, K., Zinkevich, M., & Bowling, M. (2009).
+//     Monte Carlo sampling for regret minimization in extensive games.
+//     In Advances in Neural Information Processing Systems (pp.
+//     1078-1086).
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <minimum/ai/compute_equilibrium_sequential.h>
+#include <minimum/core/check.h>
+#include <minimum/core/hash.h>
+#include <minimum/core/time.h>
+
+namespace minimum {
+namespace ai {
+namespace equilibrium_cfr {
+
+struct Options {
+	enum class Algorithm {
+		// Full traversals of the game tree with regret matching+,
+		// alternating updates and linear averaging [1]. Deterministic.
+		CFR_PLUS,
+		// Monte Carlo CFR with external sampling [2]. One iteration
+		// samples the initial state and the moves of the opponent,
+		// once for each player.
+		EXTERNAL_SAMPLING
+	};
+	Algorithm algorithm = Algorithm::CFR_PLUS;
+
+	// 0 means the number of hardware threads. CFR+ distributes the
+	// initial states of an iteration over the threads; external
+	// sampling runs independent iterations in every thread.
+	int number_of_threads = 0;
+
+	// Stops when any of these limits is reached. Negative values mean
+	// no limit. The time does not include evaluations.
+	long long max_iterations = 1000;
+	double max_time = -1;
+	double target_exploitability = -1;
+
+	// Seconds of solving before the first evaluation of the
+	// exploitability. The interval doubles after every evaluation, so
+	// the points are evenly spaced in log time. The exploitability is
+	// always evaluated when the solving stops. An evaluation costs a
+	// few full traversals of the game tree per player.
+	double evaluation_interval = 0.1;
+
+	bool verbose = false;
+};
+
+struct ExploitabilityPoint {
+	// Seconds spent solving, not counting evaluations.
+	double time;
+	long long iterations;
+	double exploitability;
+};
+
+template <typename State>
+struct Result : public equilibrium_sequential::Result<State> {
+	// Half the sum of what the players can win by best responses to
+	// the average strategies. Zero for an equilibrium.
+	double exploitability = 0;
+	long long iterations = 0;
+	std::vector<ExploitabilityPoint> exploitability_curve;
+};
+
+// Flat hash table from information sets to indices. The data for the
+// moves of all information sets are stored consecutively, starting
+// at the offset of each set.
+template <typename State>
+class InformationSetTable {
+   public:
+	typedef typename State::InformationSet InformationSet;
+	typedef typename State::Move Move;
+
+	struct Entry {
+		int offset;
+		int number_of_moves;
+		int player;
+		// Number of earlier moves by the player.
+		int depth;
+	};
+
+	// Returns the index of the information set of the player or -1.
+	// The information sets of the two players are different even if
+	// they compare equal.
+	int find(const InformationSet& information_set, int player) const {
+		if (slots.empty()) {
+			return -1;
+		}
+		auto hash = hash_of(information_set, player);
+		for (auto slot = home_slot(hash);; slot = (slot + 1) & mask()) {
+			int index = slots[slot];
+			if (index < 0) {
+				return -1;
+			}
+			if (hashes[index] == hash && entries[index].player == player
+			    && keys[index] == information_set) {
+				return index;
+			}
+		}
+	}
+
+	// Adds an information set that is not in the table and returns
+	// its index.
+	int insert(const InformationSet& information_set,
+	           const std::vector<Move>& set_moves,
+	           int player,
+	           int depth) {
+		if (2 * (keys.size() + 1) > slots.size()) {
+			rehash(std::max(std::size_t(16), 2 * slots.size()));
+		}
+		int index = int(keys.size());
+		keys.push_back(information_set);
+		hashes.push_back(hash_of(information_set, player));
+		entries.push_back({int(moves.size()), int(set_moves.size()), player, depth});
+		moves.insert(moves.end(), set_moves.begin(), set_moves.end());
+		place(index);
+		return index;
+	}
+
+	int size() const { return int(entries.size()); }
+	const Entry& entry(int index) const { return entries[index]; }
+	const InformationSet& information_set(int index) const { return keys[index]; }
+
+	// Moves of all information sets.
+	int total_moves() const { return int(moves.size()); }
+	const Move& move(int offset) const { return moves[offset]; }
+
+   private:
+	std::size_t mask() const { return slots.size() - 1; }
+
+	// The hashes of the games often differ only in a few bits, so
+	// they are mixed (Fibonacci hashing) before the slot is chosen.
+	std::size_t home_slot(std::size_t hash) const {
+		return std::size_t((std::uint64_t(hash) * 0x9e3779b97f4a7c15ULL) >> (64 - slot_bits));
+	}
+
+	std::size_t hash_of(const InformationSet& information_set, int player) const {
+		return minimum::core::hash_combine(hasher(information_set), std::size_t(player));
+	}
+
+	void place(int index) {
+		auto slot = home_slot(hashes[index]);
+		while (slots[slot] >= 0) {
+			slot = (slot + 1) & mask();
+		}
+		slots[slot] = index;
+	}
+
+	void rehash(std::size_t new_size) {
+		slots.assign(new_size, -1);
+		slot_bits = std::countr_zero(new_size);
+		for (int index = 0; index < int(keys.size()); ++index) {
+			place(index);
+		}
+	}
+
+	// Power of two; -1 for empty slots.
+	std::vector<int> slots;
+	int slot_bits = 0;
+	std::vector<std::size_t> hashes;
+	std::vector<InformationSet> keys;
+	std::vector<Entry> entries;
+	std::vector<Move> moves;
+	std::hash<InformationSet> hasher;
+};
+
+template <typename State>
+class Solver {
+   public:
+	typedef typename State::InformationSet InformationSet;
+	typedef typename State::Move Move;
+
+	// Enumerates all information sets of the game.
+	Solver(const Options& options = Options());
+
+	// Runs until one of the limits in the options is reached. Can be
+	// called again to continue.
+	Result<State> solve();
+
+	// Half the sum of what the players gain by best responses to the
+	// average strategies.
+	double exploitability() const;
+
+	// Expected reward for player 0 when both players use their
+	// average strategies.
+	double average_strategy_value() const;
+
+	const InformationSetTable<State>& information_sets() const { return table; }
+
+   private:
+	void discover(const State& state, int depth, int player_depth[2]);
+
+	// Regret matching(+): the strategy proportional to the positive
+	// regrets.
+	void current_strategy(int index, double* strategy) const;
+	void average_strategy(int index, double* strategy) const;
+
+	double cfr_plus(const State& state,
+	                int player,
+	                double weight,
+	                double reach,
+	                double opponent_reach,
+	                double* scratch);
+	void cfr_plus_iteration();
+
+	template <typename RandomEngine>
+	double external_sampling(const State& state,
+	                         int player,
+	                         RandomEngine* engine,
+	                         double* scratch);
+
+	// Accumulates the counterfactual values for the moves of the
+	// player's information sets at a depth.
+	void best_response_values(const State& state,
+	                          int player,
+	                          int depth,
+	                          double opponent_reach,
+	                          double* scratch) const;
+	// Value for the player of a best response with the best moves
+	// chosen so far.
+	double best_response_value(const State& state, int player, double* scratch) const;
+	double best_response(int player) const;
+
+	double expected_value(const State& state, double* scratch) const;
+
+	// Runs a function for every initial state, distributed over the
+	// threads. The function gets a scratch buffer of scratch_size().
+	// The recursions use a slice of it for every depth.
+	template <typename Function>
+	void for_each_initial_state(const Function& f) const;
+
+	int threads() const;
+	std::size_t scratch_size() const { return std::size_t(2) * (max_depth + 1) * max_moves; }
+
+	Options options;
+	std::vector<State> initial_states;
+	InformationSetTable<State> table;
+	int max_depth = 0;
+	int max_moves = 0;
+	int max_player_depth = 0;
+
+	std::vector<double> regrets;
+	std::vector<double> regret_updates;
+	std::vector<double> strategy_sums;
+
+	long long iterations = 0;
+	double solve_time = 0;
+	std::vector<ExploitabilityPoint> curve;
+	std::vector<std::mt19937_64> engines;
+
+	// Used by the best responses.
+	mutable std::vector<double> action_values;
+	mutable std::vector<int> best_moves;
+};
+
+// Computes an approximate equilibrium.
+template <typename State>
+Result<State> compute(const Options& options = Options()) {
+	Solver<State> solver(options);
+	return solver.solve();
+}
+
+/////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////
+
+namespace internal {
+inline void atomic_add(double* target, double value) {
+	std::atomic_ref<double>(*target).fetch_add(value, std::memory_order_relaxed);
+}
+
+inline double atomic_load(const double* source) {
+	return std::atomic_ref<double>(*const_cast<double*>(source)).load(std::memory_order_relaxed);
+}
+}  // namespace internal
+
+template <typename State>
+Solver<State>::Solver(const Options& options_) : options(options_) {
+	initial_states = State::all_initial_states();
+	minimum_core_assert(State::num_players() == 2);
+	minimum::core::check(!initial_states.empty(), "The game needs an initial state.");
+
+	for (const auto& state : initial_states) {
+		int player_depth[2] = {0, 0};
+		discover(state, 0, player_depth);
+	}
+	regrets.resize(table.total_moves(), 0.0);
+	regret_updates.resize(table.total_moves(), 0.0);
+	strategy_sums.resize(table.total_moves(), 0.0);
+	action_values.resize(table.total_moves(), 0.0);
+	best_moves.resize(table.size(), 0);
+
+	for (int t = 0; t < threads(); ++t) {
+		engines.emplace_back(1012411 * t + 12515);
+	}
+
+	if (options.verbose) {
+		std::cerr << table.size() << " information sets with " << table.total_moves()
+		          << " moves." << std::endl;
+	}
+}
+
+template <typename State>
+void Solver<State>::discover(const State& state, int depth, int player_depth[2]) {
+	max_depth = std::max(max_depth, depth);
+	if (state.terminal()) {
+		return;
+	}
+
+	int player = state.player();
+	minimum_core_assert(player == 0 || player == 1);
+	auto moves = state.possible_moves();
+	InformationSet information_set(state);
+	int index = table.find(information_set, player);
+	if (index < 0) {
+		table.insert(information_set, moves, player, player_depth[player]);
+		max_moves = std::max(max_moves, int(moves.size()));
+		max_player_depth = std::max(max_player_depth, player_depth[player]);
+	} else {
+		auto& entry = table.entry(index);
+		minimum::core::check(entry.number_of_moves == int(moves.size())
+		                         && entry.depth == player_depth[player],
+		                     "Information set ",
+		                     information_set.str(),
+		                     " is reached with different moves or after a different number "
+		                     "of moves. This seems to be a game of imperfect recall.");
+	}
+
+	player_depth[player]++;
+	for (auto move : moves) {
+		State child = state;
+		child.move(move);
+		discover(child, depth + 1, player_depth);
+	}
+	player_depth[player]--;
+}
+
+template <typename State>
+int Solver<State>::threads() const {
+	if (options.number_of_threads > 0) {
+		return options.number_of_threads;
+	}
+	return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+template <typename State>
+void Solver<State>::current_strategy(int index, double* strategy) const {
+	auto& entry = table.entry(index);
+	double sum = 0;
+	for (int a = 0; a < entry.number_of_moves; ++a) {
+		strategy[a] = std::max(internal::atomic_load(&regrets[entry.offset + a]), 0.0);
+		sum += strategy[a];
+	}
+	for (int a = 0; a < entry.number_of_moves; ++a) {
+		strategy[a] = sum > 0 ? strategy[a] / sum : 1.0 / entry.number_of_moves;
+	}
+}
+
+template <typename State>
+void Solver<State>::average_strategy(int index, double* strategy) const {
+	auto& entry = table.entry(index);
+	double sum = 0;
+	for (int a = 0; a < entry.number_of_moves; ++a) {
+		strategy[a] = strategy_sums[entry.offset + a];
+		sum += strategy[a];
+	}
+	for (int a = 0; a < entry.number_of_moves; ++a) {
+		strategy[a] = sum > 0 ? strategy[a] / sum : 1.0 / entry.number_of_moves;
+	}
+}
+
+template <typename State>
+template <typename Function>
+void Solver<State>::for_each_initial_state(const Function& f) const {
+	std::atomic<int> next_state(0);
+	auto work = [&]() {
+		std::vector<double> scratch(scratch_size());
+		while (true) {
+			int i = next_state.fetch_add(1);
+			if (i >= int(initial_states.size())) {
+				break;
+			}
+			f(initial_states[i], scratch.data());
+		}
+	};
+
+	int number_of_threads = std::min(threads(), int(initial_states.size()));
+	std::vector<std::thread> workers;
+	std::vector<std::exception_ptr> exceptions(number_of_threads);
+	for (int t = 1; t < number_of_threads; ++t) {
+		workers.emplace_back([&, t]() {
+			try {
+				work();
+			} catch (...) {
+				exceptions[t] = std::current_exception();
+			}
+		});
+	}
+	try {
+		work();
+	} catch (...) {
+		exceptions[0] = std::current_exception();
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	for (auto& exception : exceptions) {
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+}
+
+template <typename State>
+double Solver<State>::cfr_plus(const State& state,
+                               int player,
+                               double weight,
+                               double reach,
+                               double opponent_reach,
+                               double* scratch) {
+	if (state.terminal()) {
+		return state.reward()[player];
+	}
+
+	int index = table.find(InformationSet(state), state.player());
+	minimum_core_assert(index >= 0);
+	auto& entry = table.entry(index);
+	int n = entry.number_of_moves;
+	double* strategy = scratch;
+	double* values = scratch + n;
+	current_strategy(index, strategy);
+
+	double value = 0;
+	if (entry.player == player) {
+		for (int a = 0; a < n; ++a) {
+			State child = state;
+			child.move(table.move(entry.offset + a));
+			values[a] = cfr_plus(
+			    child, player, weight, reach * strategy[a], opponent_reach, scratch + 2 * n);
+			value += strategy[a] * values[a];
+		}
+		for (int a = 0; a < n; ++a) {
+			internal::atomic_add(&regret_updates[entry.offset + a],
+			                     opponent_reach * (values[a] - value));
+			internal::atomic_add(&strategy_sums[entry.offset + a], weight * reach * strategy[a]);
+		}
+	} else {
+		for (int a = 0; a < n; ++a) {
+			if (strategy[a] > 0) {
+				State child = state;
+				child.move(table.move(entry.offset + a));
+				value += strategy[a]
+				         * cfr_plus(child,
+				                    player,
+				                    weight,
+				                    reach,
+				                    opponent_reach * strategy[a],
+				                    scratch + 2 * n);
+			}
+		}
+	}
+	return value;
+}
+
+template <typename State>
+void Solver<State>::cfr_plus_iteration() {
+	double chance = 1.0 / initial_states.size();
+	double weight = double(iterations + 1);
+	for (int player = 0; player < 2; ++player) {
+		for_each_initial_state([&](const State& state, double* scratch) {
+			cfr_plus(state, player, weight, 1.0, chance, scratch);
+		});
+
+		// Regret matching+ keeps only the positive regrets.
+		for (int index = 0; index < table.size(); ++index) {
+			auto& entry = table.entry(index);
+			if (entry.player != player) {
+				continue;
+			}
+			for (int i = entry.offset; i < entry.offset + entry.number_of_moves; ++i) {
+				regrets[i] = std::max(regrets[i] + regret_updates[i], 0.0);
+				regret_updates[i] = 0;
+			}
+		}
+	}
+}
+
+template <typename State>
+template <typename RandomEngine>
+double Solver<State>::external_sampling(const State& state,
+                                        int player,
+                                        RandomEngine* engine,
+                                        double* scratch) {
+	if (state.terminal()) {
+		return state.reward()[player];
+	}
+
+	int index = table.find(InformationSet(state), state.player());
+	minimum_core_assert(index >= 0);
+	auto& entry = table.entry(index);
+	int n = entry.number_of_moves;
+	double* strategy = scratch;
+	double* values = scratch + n;
+	current_strategy(index, strategy);
+
+	if (entry.player == player) {
+		double value = 0;
+		for (int a = 0; a < n; ++a) {
+			State child = state;
+			child.move(table.move(entry.offset + a));
+			values[a] = external_sampling(child, player, engine, scratch + 2 * n);
+			value += strategy[a] * values[a];
+		}
+		for (int a = 0; a < n; ++a) {
+			internal::atomic_add(&regrets[entry.offset + a], values[a] - value);
+		}
+		return value;
+	} else {
+		// The opponent's average strategy is updated where the
+		// opponent's moves are sampled.
+		std::uniform_real_distribution<double> uniform(0, 1);
+		double r = uniform(*engine);
+		int sampled = n - 1;
+		for (int a = 0; a < n; ++a) {
+			internal::atomic_add(&strategy_sums[entry.offset + a], strategy[a]);
+			r -= strategy[a];
+			if (r < 0 && sampled == n - 1) {
+				sampled = a;
+			}
+		}
+		State child = state;
+		child.move(table.move(entry.offset + sampled));
+		return external_sampling(child, player, engine, scratch + 2 * n);
+	}
+}
+
+template <typename State>
+void Solver<State>::best_response_values(const State& state,
+                                         int player,
+                                         int depth,
+                                         double opponent_reach,
+                                         double* scratch) const {
+	if (state.terminal() || opponent_reach <= 0) {
+		return;
+	}
+
+	int index = table.find(InformationSet(state), state.player());
+	auto& entry = table.entry(index);
+	if (entry.player == player) {
+		for (int a = 0; a < entry.number_of_moves; ++a) {
+			State child = state;
+			child.move(table.move(entry.offset + a));
+			if (entry.depth == depth) {
+				internal::atomic_add(&action_values[entry.offset + a],
+				                     opponent_reach * best_response_value(child, player, scratch));
+			} else {
+				best_response_values(child, player, depth, opponent_reach, scratch);
+			}
+		}
+	} else {
+		double* strategy = scratch;
+		average_strategy(index, strategy);
+		for (int a = 0; a < entry.number_of_moves; ++a) {
+			State child = state;
+			child.move(table.move(entry.offset + a));
+			best_response_values(
+			    child, player, depth, opponent_reach * strategy[a], scratch + entry.number_of_moves);
+		}
+	}
+}
+
+template <typename State>
+double Solver<State>::best_response_value(const State& state,
+                                          int player,
+                                          double* scratch) const {
+	if (state.terminal()) {
+		return state.reward()[player];
+	}
+
+	int index = table.find(InformationSet(state), state.player());
+	auto& entry = table.entry(index);
+	if (entry.player == player) {
+		State child = state;
+		child.move(table.move(entry.offset + best_moves[index]));
+		return best_response_value(child, player, scratch);
+	} else {
+		double* strategy = scratch;
+		average_strategy(index, strategy);
+		double value = 0;
+		for (int a = 0; a < entry.number_of_moves; ++a) {
+			if (strategy[a] > 0) {
+				State child = state;
+				child.move(table.move(entry.offset + a));
+				value += strategy[a]
+				         * best_response_value(child, player, scratch + entry.number_of_moves);
+			}
+		}
+		return value;
+	}
+}
+
+template <typename State>
+double Solver<State>::best_response(int player) const {
+	double chance = 1.0 / initial_states.size();
+
+	// Perfect recall means that the best moves can be chosen from the
+	// last move of the player and backwards.
+	for (int depth = max_player_depth; depth >= 0; --depth) {
+		std::fill(action_values.begin(), action_values.end(), 0.0);
+		for_each_initial_state([&](const State& state, double* scratch) {
+			best_response_values(state, player, depth, chance, scratch);
+		});
+		for (int index = 0; index < table.size(); ++index) {
+			auto& entry = table.entry(index);
+			if (entry.player == player && entry.depth == depth) {
+				auto begin = action_values.begin() + entry.offset;
+				best_moves[index] =
+				    int(std::max_element(begin, begin + entry.number_of_moves) - begin);
+			}
+		}
+	}
+
+	std::vector<double> scratch(scratch_size());
+	double value = 0;
+	for (const auto& state : initial_states) {
+		value += chance * best_response_value(state, player, scratch.data());
+	}
+	return value;
+}
+
+template <typename State>
+double Solver<State>::exploitability() const {
+	return (best_response(0) + best_response(1)) / 2;
+}
+
+template <typename State>
+double Solver<State>::expected_value(const State& state, double* scratch) const {
+	if (state.terminal()) {
+		return state.reward()[0];
+	}
+
+	int index = table.find(InformationSet(state), state.player());
+	auto& entry = table.entry(index);
+	double* strategy = scratch;
+	average_strategy(index, strategy);
+	double value = 0;
+	for (int a = 0; a < entry.number_of_moves; ++a) {
+		if (strategy[a] > 0) {
+			State child = state;
+			child.move(table.move(entry.offset + a));
+			value += strategy[a] * expected_value(child, scratch + entry.number_of_moves);
+		}
+	}
+	return value;
+}
+
+template <typename State>
+double Solver<State>::average_strategy_value() const {
+	std::vector<double> scratch(scratch_size());
+	double value = 0;
+	for (const auto& state : initial_states) {
+		value += expected_value(state, scratch.data());
+	}
+	return value / initial_states.size();
+}
+
+template <typename State>
+Result<State> Solver<State>::solve() {
+	using namespace std;
+
+	const double solve_start = solve_time;
+	const long long iterations_start = iterations;
+	auto iteration_limit_reached = [&]() {
+		return options.max_iterations >= 0
+		       && iterations - iterations_start >= options.max_iterations;
+	};
+	auto done_solving = [&]() {
+		return iteration_limit_reached()
+		       || (options.max_time >= 0 && solve_time - solve_start >= options.max_time);
+	};
+
+	double exploitability_now = -1;
+	double interval = options.evaluation_interval;
+	while (true) {
+		double next_evaluation = solve_time + interval;
+		interval *= 2;
+		double start_time = core::wall_time();
+		auto time_left = [&]() {
+			double time = solve_time + core::wall_time() - start_time;
+			return time < next_evaluation
+			       && (options.max_time < 0 || time - solve_start < options.max_time);
+		};
+
+		if (options.algorithm == Options::Algorithm::CFR_PLUS) {
+			// At least one iteration between evaluations, unless the
+			// iteration limit has been reached.
+			while (!iteration_limit_reached()) {
+				cfr_plus_iteration();
+				iterations++;
+				if (!time_left()) {
+					break;
+				}
+			}
+		} else {
+			atomic<long long> shared_iterations(iterations);
+			const long long max_iterations = options.max_iterations < 0
+			                                     ? numeric_limits<long long>::max()
+			                                     : iterations_start + options.max_iterations;
+			vector<thread> workers;
+			vector<exception_ptr> exceptions(threads());
+			for (int t = 0; t < threads(); ++t) {
+				workers.emplace_back([&, t]() {
+					try {
+						vector<double> scratch(scratch_size());
+						uniform_int_distribution<size_t> initial(0, initial_states.size() - 1);
+						do {
+							if (shared_iterations.fetch_add(1) >= max_iterations) {
+								break;
+							}
+							auto& state = initial_states[initial(engines[t])];
+							for (int player = 0; player < 2; ++player) {
+								external_sampling(state, player, &engines[t], scratch.data());
+							}
+						} while (time_left());
+					} catch (...) {
+						exceptions[t] = current_exception();
+					}
+				});
+			}
+			for (auto& worker : workers) {
+				worker.join();
+			}
+			for (auto& exception : exceptions) {
+				if (exception) {
+					rethrow_exception(exception);
+				}
+			}
+			iterations = min(shared_iterations.load(), max_iterations);
+		}
+		solve_time += core::wall_time() - start_time;
+
+		exploitability_now = exploitability();
+		curve.push_back({solve_time, iterations, exploitability_now});
+		if (options.verbose) {
+			cerr << "Iteration " << setw(8) << iterations << ", " << setw(8) << setprecision(4)
+			     << solve_time << " s: exploitability " << exploitability_now << endl;
+		}
+
+		if (done_solving() || exploitability_now <= options.target_exploitability) {
+			break;
+		}
+	}
+
+	Result<State> result;
+	result.value = average_strategy_value();
+	result.exploitability = exploitability_now;
+	result.iterations = iterations;
+	result.exploitability_curve = curve;
+	vector<double> strategy(max_moves);
+	for (int index = 0; index < table.size(); ++index) {
+		auto& entry = table.entry(index);
+		average_strategy(index, strategy.data());
+		auto& moves = result.player_strategies[entry.player][table.information_set(index)];
+		for (int a = 0; a < entry.number_of_moves; ++a) {
+			moves.emplace_back(table.move(entry.offset + a), strategy[a]);
+		}
+	}
+	return result;
+}
+}  // namespace equilibrium_cfr
+}  // namespace ai
+}  // namespace minimum
@@ -0,0 +1,528 @@
+#pragma once
+// First-order computation of Nash equilibria of two-player zero-sum
+// games of imperfect information, using the sequence-form matrices of
+// compute_equilibrium_sequential.h. The equilibrium is the saddle
+// point of
+//
+//   max_x min_y x^T A y,  Ex = e, Fy = f, x ≥ 0, y ≥ 0,
+//
+// which is found without a linear program. An iteration costs four
+// sparse matrix-vector products and a few passes over the sequences,
+// so the time per iteration is linear in the size of the game.
+//
+// Algorithm from
+//
+// [1] Nemirovski, A. (2004). Prox-method with rate of convergence
+//     O(1/t) for variational inequalities with Lipschitz continuous
+//     monotone operators and smooth convex-concave saddle point
+//     problems. SIAM Journal on Optimization, 15(1), 229-251.
+//
+// with the dilated entropy of
+//
+// [2] Kroer, C., Waugh, K., Kılınç-Karzan, F., & Sandholm, T. (2020).
+//     Faster algorithms for extensive-form game solving via improved
+//     smoothing functions. Mathematical Programming, 179, 385-417.
+//
+// and the restarts of
+//
+// [3] Applegate, D., Hinder, O., Lu, H., & Lubin, M. (2023). Faster
+//     first-order primal-dual methods for linear programming using
+//     restarts and sharpness. Mathematical Programming, 201, 133-184.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <minimum/ai/compute_equilibrium_sequential.h>
+#include <minimum/core/check.h>
+#include <minimum/core/time.h>
+
+namespace minimum {
+namespace ai {
+namespace equilibrium_saddle_point {
+
+struct Options {
+	// Stops when any of these limits is reached. Negative values mean
+	// no limit. The duality gap is the sum of what the two players
+	// can win by best responses to the strategies, which is twice the
+	// exploitability reported by equilibrium_cfr.
+	double target_gap = 1e-6;
+	long long max_iterations = 100000;
+	double max_time = -1;
+
+	// Number of iterations between computations of the duality gap,
+	// which cost about half an iteration.
+	int gap_interval = 10;
+
+	// Threads for the matrix-vector products. 0 means the OpenMP
+	// default. Ignored without OpenMP.
+	int number_of_threads = 0;
+
+	bool verbose = false;
+};
+
+// The strategies in sequence form.
+struct Solution {
+	Eigen::VectorXd x;
+	Eigen::VectorXd y;
+	double value = 0;
+	double gap = 0;
+	long long iterations = 0;
+};
+
+template <typename State>
+struct Result : public equilibrium_sequential::Result<State> {
+	double gap = 0;
+	// Half the duality gap, as defined in equilibrium_cfr::Result.
+	double exploitability = 0;
+	long long iterations = 0;
+};
+
+// The strategy polytope {x ≥ 0 : Ex = e} of one player. Every row of
+// E is an information set, with 1 for the sequences ending in its
+// moves and -1 for the sequence leading to it. The exception is the
+// row of the empty sequence, which has a single 1.
+//
+// Points are also stored as the probabilities q of the moves at each
+// information set, which the entropy needs when the probability of
+// reaching a set is tiny.
+class Treeplex {
+   public:
+	explicit Treeplex(const Eigen::SparseMatrix<double>& E);
+
+	int number_of_sequences() const { return int(number_of_children.size()); }
+
+	// Returns max <c, x> over the polytope and a maximizer if x is not
+	// null.
+	double maximize(const Eigen::VectorXd& c, Eigen::VectorXd* x = nullptr) const;
+
+	// Computes the maximizer of <c, x> - ψ(x), where ψ is the dilated
+	// entropy
+	//
+	//   ψ(x) = Σ_I Σ_{a ∈ I} x_a log(x_a / x_{p(I)}).
+	void entropy_maximize(const Eigen::VectorXd& c, Eigen::VectorXd* q, Eigen::VectorXd* x) const;
+
+	// The probabilities of the moves at a point. Uniform at
+	// information sets that are never reached.
+	void behavioral(const Eigen::VectorXd& x, Eigen::VectorXd* q) const;
+
+	// The gradient of ψ at a point.
+	void entropy_gradient(const Eigen::VectorXd& q, Eigen::VectorXd* gradient) const;
+
+	// The Bregman divergence of ψ between two points
+	//
+	//   Σ_I Σ_{a ∈ I} x_a log(q_a / q_center_a).
+	double divergence(const Eigen::VectorXd& x,
+	                  const Eigen::VectorXd& q,
+	                  const Eigen::VectorXd& q_center) const;
+
+   private:
+	int root = -1;
+	// The information sets, parents before children.
+	std::vector<int> parents;
+	std::vector<int> offsets;
+	std::vector<int> sequences;
+	// Number of information sets directly after each sequence.
+	std::vector<int> number_of_children;
+
+	mutable Eigen::VectorXd values;
+};
+
+// Computes an approximate equilibrium from the sequence-form matrices.
+inline Solution solve(const Eigen::SparseMatrix<double>& A,
+                      const Eigen::SparseMatrix<double>& E,
+                      const Eigen::SparseMatrix<double>& F,
+                      const Options& options = Options());
+
+// Computes an approximate equilibrium. Both strategies come from the
+// same run.
+template <typename State>
+Result<State> compute(const Options& options = Options()) {
+	equilibrium_sequential::RecurseInfo<State> recurse_info;
+	equilibrium_sequential::all_sequences(&recurse_info);
+
+	Eigen::SparseMatrix<double> E;
+	std::vector<double> e;
+	Eigen::SparseMatrix<double> F;
+	std::vector<double> f;
+	equilibrium_sequential::compute_matrices(recurse_info, &E, &e, &F, &f);
+	Eigen::SparseMatrix<double> A;
+	equilibrium_sequential::compute_matrix_A(recurse_info, &A);
+
+	auto solution = solve(A, E, F, options);
+
+	Result<State> result;
+	result.value = solution.value;
+	result.gap = solution.gap;
+	result.exploitability = solution.gap / 2;
+	result.iterations = solution.iterations;
+	equilibrium_sequential::extract_solution(recurse_info, solution.x, 0, &result);
+	equilibrium_sequential::extract_solution(recurse_info, solution.y, 1, &result);
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////
+
+namespace internal {
+typedef Eigen::SparseMatrix<double, Eigen::RowMajor> RowMajorMatrix;
+
+inline void multiply(const RowMajorMatrix& M,
+                     const Eigen::VectorXd& v,
+                     double scale,
+                     int number_of_threads,
+                     Eigen::VectorXd* result) {
+	result->resize(M.rows());
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(number_of_threads) schedule(static, 256) if (M.rows() > 4096)
+#endif
+	for (int i = 0; i < M.rows(); ++i) {
+		double sum = 0;
+		for (RowMajorMatrix::InnerIterator itr(M, i); itr; ++itr) {
+			sum += itr.value() * v(itr.col());
+		}
+		(*result)(i) = scale * sum;
+	}
+}
+
+// Avoids log(0) for moves whose probability has underflowed.
+inline double safe_log(double q) {
+	return std::log(std::max(q, std::numeric_limits<double>::min()));
+}
+}  // namespace internal
+
+inline Treeplex::Treeplex(const Eigen::SparseMatrix<double>& E) {
+	using namespace std;
+	int number_of_sets = int(E.rows());
+	vector<vector<int>> set_sequences(number_of_sets);
+	vector<int> set_parents(number_of_sets, -1);
+	vector<int> owner(E.cols(), -1);
+	for (int j = 0; j < E.outerSize(); ++j) {
+		for (Eigen::SparseMatrix<double>::InnerIterator itr(E, j); itr; ++itr) {
+			int row = int(itr.row());
+			int col = int(itr.col());
+			if (itr.value() > 0) {
+				minimum::core::check(
+				    owner[col] < 0, "Sequence ", col, " ends in two information sets.");
+				set_sequences[row].push_back(col);
+				owner[col] = row;
+			} else {
+				minimum::core::check(
+				    set_parents[row] < 0, "Information set ", row, " has two parents.");
+				set_parents[row] = col;
+			}
+		}
+	}
+
+	number_of_children.assign(E.cols(), 0);
+	for (int row = 0; row < number_of_sets; ++row) {
+		if (set_parents[row] < 0) {
+			minimum::core::check(root < 0 && set_sequences[row].size() == 1,
+			                     "Expected a single empty sequence.");
+			root = set_sequences[row][0];
+		} else {
+			number_of_children[set_parents[row]]++;
+		}
+	}
+	minimum::core::check(root >= 0, "Expected a single empty sequence.");
+	for (int col = 0; col < E.cols(); ++col) {
+		minimum::core::check(owner[col] >= 0, "Sequence ", col, " is not in any information set.");
+	}
+
+	// Sorts the information sets by depth.
+	vector<int> depths(number_of_sets, -1);
+	function<int(int)> depth_of = [&](int row) {
+		if (depths[row] < 0) {
+			depths[row] = set_parents[row] < 0 ? 0 : depth_of(owner[set_parents[row]]) + 1;
+		}
+		return depths[row];
+	};
+	vector<int> order;
+	for (int row = 0; row < number_of_sets; ++row) {
+		if (set_parents[row] >= 0) {
+			order.push_back(row);
+		}
+	}
+	stable_sort(
+	    order.begin(), order.end(), [&](int a, int b) { return depth_of(a) < depth_of(b); });
+
+	offsets.push_back(0);
+	for (int row : order) {
+		parents.push_back(set_parents[row]);
+		sequences.insert(sequences.end(), set_sequences[row].begin(), set_sequences[row].end());
+		offsets.push_back(int(sequences.size()));
+	}
+}
+
+inline double Treeplex::maximize(const Eigen::VectorXd& c, Eigen::VectorXd* x) const {
+	minimum_core_assert(c.size() == number_of_sequences());
+	values = c;
+	std::vector<int> best_moves;
+	if (x != nullptr) {
+		best_moves.resize(parents.size());
+	}
+	for (int s = int(parents.size()) - 1; s >= 0; --s) {
+		int best = offsets[s];
+		for (int k = offsets[s] + 1; k < offsets[s + 1]; ++k) {
+			if (values(sequences[k]) > values(sequences[best])) {
+				best = k;
+			}
+		}
+		values(parents[s]) += values(sequences[best]);
+		if (x != nullptr) {
+			best_moves[s] = sequences[best];
+		}
+	}
+
+	if (x != nullptr) {
+		x->setZero(number_of_sequences());
+		(*x)(root) = 1;
+		for (int s = 0; s < int(parents.size()); ++s) {
+			(*x)(best_moves[s]) = (*x)(parents[s]);
+		}
+	}
+	return values(root);
+}
+
+inline void Treeplex::entropy_maximize(const Eigen::VectorXd& c,
+                                       Eigen::VectorXd* q,
+                                       Eigen::VectorXd* x) const {
+	minimum_core_assert(c.size() == number_of_sequences());
+	// values are the maximum of <c, x> - ψ(x) below each sequence,
+	// relative to its probability. At every information set, this is
+	// a log-sum-exp of the values of the moves.
+	values = c;
+	q->resize(number_of_sequences());
+	for (int s = int(parents.size()) - 1; s >= 0; --s) {
+		double max_value = -std::numeric_limits<double>::infinity();
+		for (int k = offsets[s]; k < offsets[s + 1]; ++k) {
+			max_value = std::max(max_value, values(sequences[k]));
+		}
+		double sum = 0;
+		for (int k = offsets[s]; k < offsets[s + 1]; ++k) {
+			double weight = std::exp(values(sequences[k]) - max_value);
+			(*q)(sequences[k]) = weight;
+			sum += weight;
+		}
+		for (int k = offsets[s]; k < offsets[s + 1]; ++k) {
+			(*q)(sequences[k]) /= sum;
+		}
+		values(parents[s]) += max_value + std::log(sum);
+	}
+
+	(*q)(root) = 1;
+	x->resize(number_of_sequences());
+	(*x)(root) = 1;
+	for (int s = 0; s < int(parents.size()); ++s) {
+		for (int k = offsets[s]; k < offsets[s + 1]; ++k) {
+			(*x)(sequences[k]) = (*x)(parents[s]) * (*q)(sequences[k]);
+		}
+	}
+}
+
+inline void Treeplex::behavioral(const Eigen::VectorXd& x, Eigen::VectorXd* q) const {
+	q->resize(number_of_sequences());
+	(*q)(root) = 1;
+	for (int s = 0; s < int(parents.size()); ++s) {
+		double parent = x(parents[s]);
+		int number_of_moves = offsets[s + 1] - offsets[s];
+		for (int k = offsets[s]; k < offsets[s + 1]; ++k) {
+			(*q)(sequences[k]) = parent > 0 ? x(sequences[k]) / parent : 1.0 / number_of_moves;
+		}
+	}
+}
+
+inline void Treeplex::entropy_gradient(const Eigen::VectorXd& q, Eigen::VectorXd* gradient) const {
+	// The derivative of x_a log(x_a / x_{p(I)}) is log q_a + 1, and
+	// every information set after a contributes -1.
+	gradient->resize(number_of_sequences());
+	for (int i = 0; i < number_of_sequences(); ++i) {
+		(*gradient)(i) = -number_of_children[i];
+	}
+	for (int s = 0; s < int(parents.size()); ++s) {
+		for (int k = offsets[s]; k < offsets[s + 1]; ++k) {
+			(*gradient)(sequences[k]) += internal::safe_log(q(sequences[k])) + 1;
+		}
+	}
+}
+
+inline double Treeplex::divergence(const Eigen::VectorXd& x,
+                                   const Eigen::VectorXd& q,
+                                   const Eigen::VectorXd& q_center) const {
+	double sum = 0;
+	for (int k = 0; k < int(sequences.size()); ++k) {
+		int a = sequences[k];
+		if (x(a) > 0) {
+			sum += x(a) * (internal::safe_log(q(a)) - internal::safe_log(q_center(a)));
+		}
+	}
+	return sum;
+}
+
+inline Solution solve(const Eigen::SparseMatrix<double>& A,
+                      const Eigen::SparseMatrix<double>& E,
+                      const Eigen::SparseMatrix<double>& F,
+                      const Options& options) {
+	using namespace std;
+	using internal::multiply;
+	minimum_core_assert(A.rows() == E.cols() && A.cols() == F.cols());
+
+	double start_time = minimum::core::wall_time();
+	int threads = options.number_of_threads;
+#ifdef USE_OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#endif
+
+	Treeplex X(E);
+	Treeplex Y(F);
+	internal::RowMajorMatrix AT = A.transpose();
+	internal::RowMajorMatrix Ar = A;
+
+	// The current point z = (x, y) starts at the minimum of the
+	// entropy. g are the gradients of the players' payoffs there,
+	// A y and -A^T x.
+	Eigen::VectorXd qx, x, qy, y;
+	X.entropy_maximize(Eigen::VectorXd::Zero(A.rows()), &qx, &x);
+	Y.entropy_maximize(Eigen::VectorXd::Zero(A.cols()), &qy, &y);
+	Eigen::VectorXd gx, gy;
+	multiply(Ar, y, 1, threads, &gx);
+	multiply(AT, x, -1, threads, &gy);
+
+	Eigen::VectorXd hx, hy;
+	Eigen::VectorXd qx_half, x_half, qy_half, y_half, gx_half, gy_half;
+	Eigen::VectorXd qx_next, x_next, qy_next, y_next;
+	Eigen::VectorXd x_sum = Eigen::VectorXd::Zero(A.rows());
+	Eigen::VectorXd y_sum = Eigen::VectorXd::Zero(A.cols());
+	double weight_sum = 0;
+
+	double max_coefficient = 0;
+	for (int j = 0; j < A.outerSize(); ++j) {
+		for (Eigen::SparseMatrix<double>::InnerIterator itr(A, j); itr; ++itr) {
+			max_coefficient = max(max_coefficient, abs(itr.value()));
+		}
+	}
+	double step = 1.0 / max(max_coefficient, 1e-12);
+
+	// The averages converge, but the last points are often much
+	// closer to the saddle point. The one with the smallest gap is
+	// returned.
+	Solution solution;
+	Eigen::VectorXd Ay, ATx;
+	auto evaluate = [&](const Eigen::VectorXd& x_candidate, const Eigen::VectorXd& y_candidate) {
+		multiply(Ar, y_candidate, 1, threads, &Ay);
+		multiply(AT, x_candidate, -1, threads, &ATx);
+		double gap = X.maximize(Ay) + Y.maximize(ATx);
+		if (gap < solution.gap) {
+			solution.x = x_candidate;
+			solution.y = y_candidate;
+			solution.value = x_candidate.dot(Ay);
+			solution.gap = gap;
+		}
+	};
+	auto evaluate_all = [&]() {
+		solution.gap = numeric_limits<double>::infinity();
+		if (weight_sum > 0) {
+			evaluate(x_sum / weight_sum, y_sum / weight_sum);
+		}
+		evaluate(x, y);
+		if (options.verbose) {
+			clog << setw(10) << solution.iterations << setw(16) << solution.gap << setw(12)
+			     << minimum::core::wall_time() - start_time << " s." << endl;
+		}
+	};
+
+	double restart_gap = numeric_limits<double>::infinity();
+	bool evaluated = false;
+	while (true) {
+		bool out_of_iterations =
+		    options.max_iterations >= 0 && solution.iterations >= options.max_iterations;
+		bool out_of_time =
+		    options.max_time >= 0 && minimum::core::wall_time() - start_time >= options.max_time;
+		if (out_of_iterations || out_of_time) {
+			if (!evaluated) {
+				evaluate_all();
+			}
+			break;
+		}
+
+		// Extragradient step of [1]. Both prox steps start from z.
+		X.entropy_gradient(qx, &hx);
+		Y.entropy_gradient(qy, &hy);
+		while (true) {
+			X.entropy_maximize(step * gx + hx, &qx_half, &x_half);
+			Y.entropy_maximize(step * gy + hy, &qy_half, &y_half);
+			multiply(Ar, y_half, 1, threads, &gx_half);
+			multiply(AT, x_half, -1, threads, &gy_half);
+			X.entropy_maximize(step * gx_half + hx, &qx_next, &x_next);
+			Y.entropy_maximize(step * gy_half + hy, &qy_next, &y_next);
+
+			// The step is small enough if the error of the linear
+			// approximation is bounded by the divergences. Near the
+			// saddle point, both sides are rounding errors.
+			double error = step * ((gx_half - gx).dot(x_next - x_half)
+			                       + (gy_half - gy).dot(y_next - y_half));
+			double bound = X.divergence(x_next, qx_next, qx_half)
+			               + X.divergence(x_half, qx_half, qx)
+			               + Y.divergence(y_next, qy_next, qy_half)
+			               + Y.divergence(y_half, qy_half, qy);
+			if (error <= bound + 1e-12) {
+				break;
+			}
+			step /= 2;
+		}
+
+		x_sum += step * x_half;
+		y_sum += step * y_half;
+		weight_sum += step;
+		solution.iterations++;
+
+		swap(qx, qx_next);
+		swap(x, x_next);
+		swap(qy, qy_next);
+		swap(y, y_next);
+		multiply(Ar, y, 1, threads, &gx);
+		multiply(AT, x, -1, threads, &gy);
+		step *= 1.2;
+
+		evaluated = false;
+		if (solution.iterations % max(options.gap_interval, 1) == 0) {
+			evaluate_all();
+			evaluated = true;
+			if (solution.gap <= options.target_gap) {
+				break;
+			}
+			// Restarts from the best point every time the gap has
+			// halved. The averages then forget the early points,
+			// which is much faster for these polyhedral problems [3].
+			if (solution.gap <= 0.5 * restart_gap) {
+				restart_gap = solution.gap;
+				x = solution.x;
+				y = solution.y;
+				X.behavioral(x, &qx);
+				Y.behavioral(y, &qy);
+				multiply(Ar, y, 1, threads, &gx);
+				multiply(AT, x, -1, threads, &gy);
+				x_sum.setZero();
+				y_sum.setZero();
+				weight_sum = 0;
+			}
+		}
+	}
+	return solution;
+}
+}  // namespace equilibrium_saddle_point
+}  // namespace ai
+}  // namespace minimum
@@ -19,12 +19,15 @@ void main_program() {
 	player2_options.verbose = true;
 
 	ConnectFourState state;
+	// The searches keep their trees between moves.
+	minimum::ai::MonteCarloTreeSearch<ConnectFourState> player1(state, player1_options);
+	minimum::ai::MonteCarloTreeSearch<ConnectFourState> player2(state, player2_options);
 	while (state.has_moves()) {
 		cout << endl << "State: " << state << endl;
 
 		ConnectFourState::Move move = ConnectFourState::no_move;
 		if (state.player_to_move == 1) {
-			move = minimum::ai::compute_move(state, player1_options);
+			move = player1.compute_move();
 			state.do_move(move);
 		} else {
 			if (human_player) {
@@ -40,10 +43,12 @@ void main_program() {
 					}
 				}
 			} else {
-				move = minimum::ai::compute_move(state, player2_options);
+				move = player2.compute_move();
 				state.do_move(move);
 			}
 		}
+		player1.do_move(move);
+		player2.do_move(move);
 	}
 
 	cout << endl << "Final state: " << state << endl;
@@ -0,0 +1,114 @@
+// Measures complete random games (playouts) per second for the two
+// Connect Four states, for a range of thread counts, and the rate of
+// the Monte Carlo tree search using them.
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include <minimum/ai/games/connect_four.h>
+#include <minimum/ai/games/connect_four_bitboard.h>
+#include <minimum/ai/mcts.h>
+#include <minimum/core/string.h>
+#include <minimum/core/time.h>
+
+// Plays random games from the start and returns the number of
+// playouts per second summed over all threads.
+template <typename State>
+double playouts_per_second(int number_of_threads, int playouts_per_thread) {
+	vector<thread> threads;
+	vector<double> wins(number_of_threads, 0);
+	double start_time = minimum::core::wall_time();
+	for (int t = 0; t < number_of_threads; ++t) {
+		threads.emplace_back([t, playouts_per_thread, &wins]() {
+			std::mt19937_64 engine(1012411 * t + 12515);
+			double player1_wins = 0;
+			for (int i = 0; i < playouts_per_thread; ++i) {
+				State state;
+				while (state.has_moves()) {
+					state.do_random_move(&engine);
+				}
+				player1_wins += state.get_result(2);
+			}
+			// Keeps the games from being optimized away.
+			wins[t] = player1_wins;
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double elapsed = minimum::core::wall_time() - start_time;
+
+	double total_wins = 0;
+	for (auto w : wins) {
+		total_wins += w;
+	}
+	minimum_core_assert(total_wins >= 0);
+	return double(number_of_threads) * playouts_per_thread / elapsed;
+}
+
+// Games per second of a search for the first move.
+template <typename State>
+double mcts_games_per_second(int number_of_threads, int iterations_per_thread) {
+	minimum::ai::ComputeOptions options;
+	options.number_of_threads = number_of_threads;
+	options.max_iterations = iterations_per_thread;
+	double start_time = minimum::core::wall_time();
+	minimum::ai::compute_move(State(), options);
+	double elapsed = minimum::core::wall_time() - start_time;
+	return double(number_of_threads) * iterations_per_thread / elapsed;
+}
+
+void main_program(int argc, char* argv[]) {
+	int max_threads = max(1u, thread::hardware_concurrency());
+	int playouts = 200000;
+	if (argc > 1) {
+		max_threads = minimum::core::from_string<int>(argv[1]);
+	}
+	if (argc > 2) {
+		playouts = minimum::core::from_string<int>(argv[2]);
+	}
+
+	vector<int> thread_counts;
+	for (int threads = 1; threads < max_threads; threads *= 2) {
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	cout << "Playouts / second." << endl;
+	cout << setw(8) << "threads" << setw(14) << "vector" << setw(14) << "bitboard" << setw(10)
+	     << "speedup" << endl;
+	for (int threads : thread_counts) {
+		double vector_rate = playouts_per_second<ConnectFourState>(threads, playouts / threads);
+		double bitboard_rate =
+		    playouts_per_second<BitboardConnectFourState>(threads, playouts / threads);
+		cout << setw(8) << threads << setw(14) << int(vector_rate) << setw(14)
+		     << int(bitboard_rate) << setw(10) << setprecision(3) << bitboard_rate / vector_rate
+		     << endl;
+	}
+
+	cout << endl << "Monte Carlo tree search games / second." << endl;
+	cout << setw(8) << "threads" << setw(14) << "vector" << setw(14) << "bitboard" << setw(10)
+	     << "speedup" << endl;
+	for (int threads : thread_counts) {
+		int iterations = playouts / 4 / threads;
+		double vector_rate = mcts_games_per_second<ConnectFourState>(threads, iterations);
+		double bitboard_rate = mcts_games_per_second<BitboardConnectFourState>(threads, iterations);
+		cout << setw(8) << threads << setw(14) << int(vector_rate) << setw(14)
+		     << int(bitboard_rate) << setw(10) << setprecision(3) << bitboard_rate / vector_rate
+		     << endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		main_program(argc, argv);
+	} catch (std::runtime_error& error) {
+		std::cerr << "ERROR: " << error.what() << std::endl;
+		return 1;
+	}
+}
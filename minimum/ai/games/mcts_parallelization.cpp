@@ -0,0 +1,89 @@
+// Compares root parallelization and tree parallelization of the
+// Monte Carlo tree search on Connect Four: games per second and
+// results in matches between the two.
+
+#include <iostream>
+#include <string>
+using namespace std;
+
+#include <minimum/ai/games/connect_four.h>
+#include <minimum/ai/mcts.h>
+#include <minimum/core/string.h>
+#include <minimum/core/time.h>
+
+using minimum::ai::ComputeOptions;
+
+const char* name(ComputeOptions::Parallelization parallelization) {
+	return parallelization == ComputeOptions::Parallelization::TREE ? "tree" : "root";
+}
+
+// Returns the result for player 1.
+double play_game(const ComputeOptions& player1_options, const ComputeOptions& player2_options) {
+	ConnectFourState state;
+	while (state.has_moves()) {
+		if (state.player_to_move == 1) {
+			state.do_move(minimum::ai::compute_move(state, player1_options));
+		} else {
+			state.do_move(minimum::ai::compute_move(state, player2_options));
+		}
+	}
+	return state.get_result(2);
+}
+
+void main_program(int argc, char* argv[]) {
+	int number_of_threads = 8;
+	int number_of_games = 10;
+	int iterations_per_move = 2000;
+	if (argc > 1) {
+		number_of_threads = minimum::core::from_string<int>(argv[1]);
+	}
+	if (argc > 2) {
+		number_of_games = minimum::core::from_string<int>(argv[2]);
+	}
+	if (argc > 3) {
+		iterations_per_move = minimum::core::from_string<int>(argv[3]);
+	}
+
+	ComputeOptions root_options;
+	root_options.number_of_threads = number_of_threads;
+	ComputeOptions tree_options = root_options;
+	tree_options.parallelization = ComputeOptions::Parallelization::TREE;
+
+	for (auto options : {root_options, tree_options}) {
+		options.max_iterations = 20000;
+		double start_time = minimum::core::wall_time();
+		minimum::ai::compute_move(ConnectFourState(), options);
+		double elapsed = minimum::core::wall_time() - start_time;
+		cout << name(options.parallelization) << ": "
+		     << double(options.max_iterations) * number_of_threads / elapsed << " games / second."
+		     << endl;
+	}
+
+	// The same number of games for both players. The time limit
+	// is measured from the start of each thread in root
+	// parallelization, which favors it when threads start late.
+	root_options.max_iterations = iterations_per_move;
+	tree_options.max_iterations = iterations_per_move;
+	double tree_score = 0;
+	for (int game = 0; game < number_of_games; ++game) {
+		double result;
+		if (game % 2 == 0) {
+			result = play_game(tree_options, root_options);
+		} else {
+			result = 1.0 - play_game(root_options, tree_options);
+		}
+		tree_score += result;
+		cout << "Game " << game + 1 << ": tree scored " << result << "." << endl;
+	}
+	cout << "Tree parallelization scored " << tree_score << " of " << number_of_games << "."
+	     << endl;
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		main_program(argc, argv);
+	} catch (std::runtime_error& error) {
+		std::cerr << "ERROR: " << error.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,88 @@
+// Solves imperfect-information games with counterfactual regret
+// minimization and prints the exploitability over time.
+//
+//   cfr <game> [cfr+|external_sampling] [max_time] [threads]
+//
+// The games are kuhn, kuhn52, leduc, goofspiel4, goofspiel5 and
+// goofspiel6. The linear program in compute_equilibrium_sequential.h
+// does not fit in memory for the larger goofspiel games.
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <minimum/ai/compute_equilibrium_cfr.h>
+#include <minimum/ai/imperfect_games/goofspiel.h>
+#include <minimum/ai/imperfect_games/kuhn_poker.h>
+#include <minimum/ai/imperfect_games/leduc_holdem.h>
+#include <minimum/core/string.h>
+using namespace minimum::ai;
+using namespace std;
+
+template <typename State>
+void solve(const equilibrium_cfr::Options& options) {
+	double start_time = minimum::core::wall_time();
+	equilibrium_cfr::Solver<State> solver(options);
+	cout << solver.information_sets().size() << " information sets with "
+	     << solver.information_sets().total_moves() << " moves found in "
+	     << minimum::core::wall_time() - start_time << " s.\n";
+
+	auto result = solver.solve();
+	cout << setw(12) << "time (s)" << setw(12) << "iterations" << setw(16) << "exploitability"
+	     << "\n";
+	for (auto& point : result.exploitability_curve) {
+		cout << setw(12) << point.time << setw(12) << point.iterations << setw(16)
+		     << point.exploitability << "\n";
+	}
+	cout << "Game value is " << result.value << " for player 0.\n";
+}
+
+void main_program(int argc, char* argv[]) {
+	minimum::core::check(argc >= 2, "Usage: cfr <game> [cfr+|external_sampling] [max_time] [threads]");
+	string game = argv[1];
+
+	equilibrium_cfr::Options options;
+	options.max_iterations = -1;
+	options.max_time = 10;
+	if (argc > 2) {
+		string algorithm = argv[2];
+		if (algorithm == "external_sampling") {
+			options.algorithm = equilibrium_cfr::Options::Algorithm::EXTERNAL_SAMPLING;
+		} else {
+			minimum::core::check(algorithm == "cfr+", "Unknown algorithm: ", algorithm);
+		}
+	}
+	if (argc > 3) {
+		options.max_time = minimum::core::from_string<double>(argv[3]);
+	}
+	if (argc > 4) {
+		options.number_of_threads = minimum::core::from_string<int>(argv[4]);
+	}
+	options.evaluation_interval = options.max_time / 64;
+
+	if (game == "kuhn") {
+		solve<kuhn_poker::State<>>(options);
+	} else if (game == "kuhn52") {
+		solve<kuhn_poker::State<52>>(options);
+	} else if (game == "leduc") {
+		solve<leduc_holdem::State>(options);
+	} else if (game == "goofspiel4") {
+		solve<goofspiel::State<4>>(options);
+	} else if (game == "goofspiel5") {
+		solve<goofspiel::State<5>>(options);
+	} else if (game == "goofspiel6") {
+		solve<goofspiel::State<6>>(options);
+	} else {
+		minimum::core::check(false, "Unknown game: ", game);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		main_program(argc, argv);
+		return 0;
+	} catch (std::exception& error) {
+		std::cerr << "ERROR: " << error.what() << std::endl;
+		return 1;
+	}
+}
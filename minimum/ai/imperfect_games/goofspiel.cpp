@@ -7,7 +7,7 @@ using namespace minimum::ai;
 using namespace std;
 
 void main_program() {
-	typedef goofspiel::State State;
+	typedef goofspiel::State<> State;
 
 	auto result = equilibrium_sequential::compute<State>();
 	equilibrium_sequential::print_result(result);
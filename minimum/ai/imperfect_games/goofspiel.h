@@ -8,19 +8,22 @@
 #include <minimum/core/check.h>
 #include <minimum/core/hash.h>
 #include <minimum/core/range.h>
+#include <minimum/core/string.h>
 using minimum::core::hash_combine;
 using minimum::core::range;
 
 namespace goofspiel {
 
-constexpr int num_cards = 4;
-
+template <int num_cards>
 class InformationSet;
 
+// Each player has the cards 1, ..., num_cards. The number of
+// information sets grows quickly with num_cards.
+template <int num_cards = 4>
 class State {
    public:
-	friend class InformationSet;
-	typedef goofspiel::InformationSet InformationSet;
+	friend class goofspiel::InformationSet<num_cards>;
+	typedef goofspiel::InformationSet<num_cards> InformationSet;
 
 	typedef int Move;
 	typedef std::array<double, 2> Reward;
@@ -115,6 +118,7 @@ class State {
 	double game_result = 0;
 };
 
+template <int num_cards>
 class InformationSet {
    public:
 	// Creates the "null" information sets. Can not be equal to any other.
@@ -125,7 +129,7 @@ class InformationSet {
 
 	// Creates an InformationSet from a State, using all the information the player
 	// has access to.
-	InformationSet(const State& state) {
+	InformationSet(const State<num_cards>& state) {
 		player_cards[0] = state.player_cards[0];
 		player_cards[1] = state.player_cards[1];
 		history[0] = state.history[0];
@@ -145,7 +149,7 @@ class InformationSet {
 	std::string str() const {
 		std::stringstream sout;
 		for (int i : range(2)) {
-			sout << "Player " << i << " has played " << to_string(history[i]) << ".";
+			sout << "Player " << i << " has played " << minimum::core::to_string(history[i]) << ".";
 		}
 		return sout.str();
 	}
@@ -156,10 +160,10 @@ class InformationSet {
 }  // namespace goofspiel
 
 namespace std {
-template <>
-struct hash<goofspiel::InformationSet> {
+template <int num_cards>
+struct hash<goofspiel::InformationSet<num_cards>> {
 	std::hash<int> hasher;
-	size_t operator()(goofspiel::InformationSet const& is) const {
+	size_t operator()(goofspiel::InformationSet<num_cards> const& is) const {
 		size_t h = 0;
 		for (int i : range(2)) {
 			for (auto card : is.history[i]) {
@@ -6,7 +6,8 @@
 // Originally based on Python code at
 // http://mcts.ai/code/python.html
 //
-// Uses the "root parallelization" technique [1].
+// Uses the "root parallelization" technique [1] or "tree
+// parallelization" with virtual loss [2].
 //
 namespace minimum {
 namespace ai {
@@ -59,20 +60,39 @@ concept GameState = requires(State state, const State cstate) {
 
 struct ComputeOptions {
 	int number_of_threads;
-	int max_iterations;
+	int max_iterations;  // Per thread.
 	double max_time;
 	bool verbose;
 
+	// How the threads cooperate.
+	//
+	//  * ROOT -- every thread grows its own tree. The statistics of the
+	//            children of the roots are merged at the end.
+	//  * TREE -- all threads grow one shared tree. The node statistics
+	//            are atomic and children are added without locks.
+	enum class Parallelization { ROOT, TREE };
+	Parallelization parallelization;
+
+	// Only used by tree parallelization. A thread adds this many losses
+	// to every node it selects and removes them when the result of the
+	// game is known, so that the other threads explore other paths.
+	int virtual_loss;
+
 	ComputeOptions()
 	    : number_of_threads(8),
 	      max_iterations(10000),
 	      max_time(-1.0),  // default is no time limit.
-	      verbose(false) {}
+	      verbose(false),
+	      parallelization(Parallelization::ROOT),
+	      virtual_loss(1) {}
 };
 
 template <GameState State>
 typename State::Move compute_move(const State root_state,
                                   const ComputeOptions options = ComputeOptions());
+
+// MonteCarloTreeSearch<State> (below) computes moves for a whole game
+// and reuses the search tree from one move to the next.
 }  // namespace ai
 }  // namespace minimum
 
@@ -82,19 +102,28 @@ typename State::Move compute_move(const State root_state,
 //     Parallel monte-carlo tree search. In Computers and Games (pp.
 //     60-71). Springer Berlin Heidelberg.
 //
+// [2] Same as [1], section 3.3 (tree parallelization with virtual loss).
+//
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
 #include <cstdlib>
 #include <future>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <random>
 #include <set>
+#include <span>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <minimum/core/check.h>
@@ -107,29 +136,107 @@ using std::endl;
 using std::size_t;
 using std::vector;
 
+//
+// Memory for the nodes of a tree. The memory is allocated in large
+// chunks and only released all at once, so adding a node does not
+// call malloc and freeing a tree does not visit its nodes. No
+// destructors are run for objects in the arena.
+//
+class Arena {
+   public:
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Returns uninitialized memory for n objects of type T.
+	template <typename T>
+	T* allocate(size_t n) {
+		static_assert(std::is_trivially_destructible_v<T>);
+		static_assert(alignof(T) <= alignof(std::max_align_t));
+		size_t bytes = n * sizeof(T);
+		offset = (offset + alignof(T) - 1) / alignof(T) * alignof(T);
+		if (chunks.empty() || offset + bytes > chunks[current].size) {
+			next_chunk(bytes);
+		}
+		T* result = reinterpret_cast<T*>(chunks[current].data.get() + offset);
+		offset += bytes;
+		return result;
+	}
+
+	// Frees all objects. The chunks are kept for reuse.
+	void clear() {
+		current = 0;
+		offset = 0;
+	}
+
+	// Total size of all chunks in bytes.
+	size_t capacity() const {
+		size_t size = 0;
+		for (auto& chunk : chunks) {
+			size += chunk.size;
+		}
+		return size;
+	}
+
+   private:
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	void next_chunk(size_t bytes) {
+		if (!chunks.empty()) {
+			++current;
+		}
+		// Chunks kept after clear() are reused if they are large enough.
+		while (current < chunks.size() && chunks[current].size < bytes) {
+			++current;
+		}
+		if (current == chunks.size()) {
+			size_t size = std::max(chunk_size, bytes);
+			chunks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+		}
+		offset = 0;
+	}
+
+	static constexpr size_t chunk_size = size_t(1) << 20;
+	std::vector<Chunk> chunks;
+	size_t current = 0;
+	size_t offset = 0;
+};
+
 //
 // This class is used to build the game tree. The root is created by the users and
-// the rest of the tree is created by add_node.
+// the rest of the tree is created by add_child. All nodes and their moves are
+// stored in an Arena and the children of a node are stored contiguously.
 //
 template <GameState State>
 class Node {
    public:
 	typedef typename State::Move Move;
 
-	Node(const State& state);
-	~Node();
+	// Creates a root node in the arena.
+	static Node* create(const State& state, Arena* arena);
 
-	bool has_untried_moves() const;
+	bool has_untried_moves() const { return number_of_children < number_of_moves; }
 	template <typename RandomEngine>
 	Move get_untried_move(RandomEngine* engine) const;
 	Node* best_child() const;
 
-	bool has_children() const { return !children.empty(); }
+	bool has_children() const { return number_of_children > 0; }
+	std::span<Node> children() const { return {children_begin, size_t(number_of_children)}; }
 
 	Node* select_child_UCT() const;
-	Node* add_child(const Move& move, const State& state);
+	Node* add_child(const Move& move, const State& state, Arena* arena);
 	void update(double result);
 
+	// Returns the child for a move or nullptr if it has not been added.
+	Node* find_child(const Move& move) const;
+
+	// Copies the subtree with this node as root to another arena. The
+	// copy is a root node.
+	Node* copy_to(Arena* arena) const;
+
 	std::string to_string() const;
 	std::string tree_to_string(int max_depth = 1000000, int indent = 0) const;
 
@@ -137,113 +244,154 @@ class Node {
 	Node* const parent;
 	const int player_to_move;
 
-	// std::atomic<double> wins;
-	// std::atomic<int> visits;
 	double wins;
 	int visits;
 
-	std::vector<Move> moves;
-	std::vector<Node*> children;
-
    private:
-	Node(const State& state, const Move& move, Node* parent);
+	Node(const State& state, const Move& move, Node* parent, Arena* arena);
+	// Copies everything except the children.
+	Node(const Node& node, Node* parent, Arena* arena);
+
+	void copy_children_to(Node* node, Arena* arena) const;
 
 	std::string indent_string(int indent) const;
 
 	Node(const Node&);
 	Node& operator=(const Node&);
 
-	double UCT_score;
+	// The moves of the children in order, followed by the untried moves.
+	Move* moves;
+	// Space for number_of_moves children, allocated with the first child.
+	Node* children_begin;
+	int number_of_moves;
+	int number_of_children;
 };
 
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
 
 template <GameState State>
-Node<State>::Node(const State& state)
-    : move(State::no_move),
-      parent(nullptr),
-      player_to_move(state.player_to_move),
-      wins(0),
-      visits(0),
-      moves(state.get_moves()),
-      UCT_score(0) {}
+Node<State>* Node<State>::create(const State& state, Arena* arena) {
+	const Move no_move = State::no_move;
+	return new (arena->allocate<Node>(1)) Node(state, no_move, nullptr, arena);
+}
 
 template <GameState State>
-Node<State>::Node(const State& state, const Move& move_, Node* parent_)
+Node<State>::Node(const State& state, const Move& move_, Node* parent_, Arena* arena)
     : move(move_),
       parent(parent_),
       player_to_move(state.player_to_move),
       wins(0),
       visits(0),
-      moves(state.get_moves()),
-      UCT_score(0) {}
-
-template <GameState State>
-Node<State>::~Node() {
-	for (auto child : children) {
-		delete child;
-	}
+      children_begin(nullptr),
+      number_of_children(0) {
+	auto state_moves = state.get_moves();
+	number_of_moves = static_cast<int>(state_moves.size());
+	moves = arena->allocate<Move>(state_moves.size());
+	std::uninitialized_copy(state_moves.begin(), state_moves.end(), moves);
 }
 
 template <GameState State>
-bool Node<State>::has_untried_moves() const {
-	return !moves.empty();
+Node<State>::Node(const Node& node, Node* parent_, Arena* arena)
+    : move(node.move),
+      parent(parent_),
+      player_to_move(node.player_to_move),
+      wins(node.wins),
+      visits(node.visits),
+      children_begin(nullptr),
+      number_of_moves(node.number_of_moves),
+      number_of_children(0) {
+	moves = arena->allocate<Move>(number_of_moves);
+	std::uninitialized_copy(node.moves, node.moves + number_of_moves, moves);
 }
 
 template <GameState State>
 template <typename RandomEngine>
 typename State::Move Node<State>::get_untried_move(RandomEngine* engine) const {
-	minimum_core_assert(!moves.empty());
-	std::uniform_int_distribution<std::size_t> moves_distribution(0, moves.size() - 1);
+	minimum_core_assert(has_untried_moves());
+	std::uniform_int_distribution<int> moves_distribution(number_of_children,
+	                                                      number_of_moves - 1);
 	return moves[moves_distribution(*engine)];
 }
 
 template <GameState State>
 Node<State>* Node<State>::best_child() const {
-	minimum_core_assert(moves.empty());
-	minimum_core_assert(!children.empty());
+	minimum_core_assert(!has_untried_moves());
+	minimum_core_assert(has_children());
 
-	return *std::max_element(
-	    children.begin(), children.end(), [](Node* a, Node* b) { return a->visits < b->visits; });
-	;
+	auto all = children();
+	return &*std::max_element(
+	    all.begin(), all.end(), [](const Node& a, const Node& b) { return a.visits < b.visits; });
 }
 
 template <GameState State>
 Node<State>* Node<State>::select_child_UCT() const {
-	minimum_core_assert(!children.empty());
-	for (auto child : children) {
-		child->UCT_score = double(child->wins) / double(child->visits)
-		                   + std::sqrt(2.0 * std::log(double(this->visits)) / child->visits);
+	minimum_core_assert(has_children());
+	double log_visits = std::log(double(this->visits));
+	Node* best = nullptr;
+	double best_score = 0;
+	for (auto& child : children()) {
+		double score = double(child.wins) / double(child.visits)
+		               + std::sqrt(2.0 * log_visits / child.visits);
+		if (best == nullptr || score > best_score) {
+			best = &child;
+			best_score = score;
+		}
 	}
-
-	return *std::max_element(children.begin(), children.end(), [](Node* a, Node* b) {
-		return a->UCT_score < b->UCT_score;
-	});
+	return best;
 }
 
 template <GameState State>
-Node<State>* Node<State>::add_child(const Move& move, const State& state) {
-	auto node = new Node(state, move, this);
-	children.push_back(node);
-	minimum_core_assert(!children.empty());
+Node<State>* Node<State>::add_child(const Move& move, const State& state, Arena* arena) {
+	if (children_begin == nullptr) {
+		children_begin = arena->allocate<Node>(number_of_moves);
+	}
 
-	auto itr = moves.begin();
-	for (; itr != moves.end() && *itr != move; ++itr)
+	auto itr = moves + number_of_children;
+	for (; itr != moves + number_of_moves && *itr != move; ++itr)
 		;
-	minimum_core_assert(itr != moves.end());
-	std::iter_swap(itr, moves.end() - 1);
-	moves.pop_back();
+	minimum_core_assert(itr != moves + number_of_moves);
+	std::iter_swap(itr, moves + number_of_children);
+
+	auto node = new (children_begin + number_of_children) Node(state, move, this, arena);
+	number_of_children++;
 	return node;
 }
 
 template <GameState State>
 void Node<State>::update(double result) {
 	visits++;
-
 	wins += result;
-	// double my_wins = wins.load();
-	// while ( ! wins.compare_exchange_strong(my_wins, my_wins + result));
+}
+
+template <GameState State>
+Node<State>* Node<State>::find_child(const Move& move) const {
+	for (auto& child : children()) {
+		if (child.move == move) {
+			return &child;
+		}
+	}
+	return nullptr;
+}
+
+template <GameState State>
+Node<State>* Node<State>::copy_to(Arena* arena) const {
+	auto root = new (arena->allocate<Node>(1)) Node(*this, nullptr, arena);
+	copy_children_to(root, arena);
+	return root;
+}
+
+template <GameState State>
+void Node<State>::copy_children_to(Node* node, Arena* arena) const {
+	if (!has_children()) {
+		return;
+	}
+	node->children_begin = arena->allocate<Node>(number_of_moves);
+	for (int i = 0; i < number_of_children; ++i) {
+		auto child = new (node->children_begin + i) Node(children_begin[i], node, arena);
+		children_begin[i].copy_children_to(child, arena);
+	}
+	node->number_of_children = number_of_children;
 }
 
 template <GameState State>
@@ -253,7 +401,7 @@ std::string Node<State>::to_string() const {
 	     << "P" << 3 - player_to_move << " "
 	     << "M:" << move << " "
 	     << "W/V: " << wins << "/" << visits << " "
-	     << "U: " << moves.size() << "]\n";
+	     << "U: " << number_of_moves - number_of_children << "]\n";
 	return sout.str();
 }
 
@@ -264,8 +412,8 @@ std::string Node<State>::tree_to_string(int max_depth, int indent) const {
 	}
 
 	std::string s = indent_string(indent) + to_string();
-	for (auto child : children) {
-		s += child->tree_to_string(max_depth, indent + 1);
+	for (auto& child : children()) {
+		s += child.tree_to_string(max_depth, indent + 1);
 	}
 	return s;
 }
@@ -279,25 +427,170 @@ std::string Node<State>::indent_string(int indent) const {
 	return s;
 }
 
+//
+// Node of the tree shared by all threads in tree parallelization.
+// Every child has a preallocated slot. A thread claims the next
+// untried move by incrementing a counter, so no locks are needed.
+//
+template <GameState State>
+class SharedNode {
+   public:
+	typedef typename State::Move Move;
+
+	template <typename RandomEngine>
+	SharedNode(const State& state, const Move& move, SharedNode* parent, RandomEngine* engine);
+	~SharedNode();
+
+	bool is_fully_expanded() const { return next_untried.load() >= int(moves.size()); }
+
+	// Plays an untried move and returns the new child. Returns nullptr
+	// if all moves have already been claimed.
+	template <typename RandomEngine>
+	SharedNode* expand(State* state, RandomEngine* engine);
+
+	// Selects among the children added so far. Returns nullptr if there
+	// are none.
+	SharedNode* select_child_UCT() const;
+
+	// Calls f for all children added so far.
+	template <typename Function>
+	void for_each_child(const Function& f) const;
+
+	// Removes the child for a move from the tree and returns it as a
+	// new root. Returns nullptr if the child has not been added. Must
+	// not be called while other threads use the tree.
+	std::unique_ptr<SharedNode> release_child(const Move& move);
+
+	const Move move;
+	// nullptr for the root.
+	SharedNode* parent;
+	const int player_to_move;
+
+	// Visits are counted when the node is selected; the wins when the
+	// result of the game is known.
+	std::atomic<double> wins;
+	std::atomic<int> visits;
+
+   private:
+	SharedNode(const SharedNode&);
+	SharedNode& operator=(const SharedNode&);
+
+	// In random order. Move i becomes child i.
+	std::vector<Move> moves;
+	std::unique_ptr<std::atomic<SharedNode*>[]> children;
+	std::atomic<int> next_untried;
+};
+
+template <GameState State>
+template <typename RandomEngine>
+SharedNode<State>::SharedNode(const State& state,
+                              const Move& move_,
+                              SharedNode* parent_,
+                              RandomEngine* engine)
+    : move(move_),
+      parent(parent_),
+      player_to_move(state.player_to_move),
+      wins(0),
+      visits(0),
+      moves(state.get_moves()),
+      children(new std::atomic<SharedNode*>[moves.size()]),
+      next_untried(0) {
+	std::shuffle(moves.begin(), moves.end(), *engine);
+	for (size_t i = 0; i < moves.size(); ++i) {
+		children[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+template <GameState State>
+SharedNode<State>::~SharedNode() {
+	for (size_t i = 0; i < moves.size(); ++i) {
+		delete children[i].load();
+	}
+}
+
+template <GameState State>
+template <typename RandomEngine>
+SharedNode<State>* SharedNode<State>::expand(State* state, RandomEngine* engine) {
+	if (is_fully_expanded()) {
+		return nullptr;
+	}
+	int i = next_untried.fetch_add(1);
+	if (i >= int(moves.size())) {
+		return nullptr;
+	}
+	state->do_move(moves[i]);
+	auto child = new SharedNode(*state, moves[i], this, engine);
+	children[i].store(child, std::memory_order_release);
+	return child;
+}
+
+template <GameState State>
+template <typename Function>
+void SharedNode<State>::for_each_child(const Function& f) const {
+	int n = std::min(next_untried.load(), int(moves.size()));
+	for (int i = 0; i < n; ++i) {
+		auto child = children[i].load(std::memory_order_acquire);
+		// The child may be claimed but not yet created.
+		if (child != nullptr) {
+			f(child);
+		}
+	}
+}
+
+template <GameState State>
+std::unique_ptr<SharedNode<State>> SharedNode<State>::release_child(const Move& move) {
+	int n = std::min(next_untried.load(), int(moves.size()));
+	for (int i = 0; i < n; ++i) {
+		auto child = children[i].load();
+		if (child != nullptr && child->move == move) {
+			children[i].store(nullptr);
+			child->parent = nullptr;
+			return std::unique_ptr<SharedNode>(child);
+		}
+	}
+	return nullptr;
+}
+
+template <GameState State>
+SharedNode<State>* SharedNode<State>::select_child_UCT() const {
+	double log_visits = std::log(double(std::max(1, visits.load(std::memory_order_relaxed))));
+	SharedNode* best = nullptr;
+	double best_score = -std::numeric_limits<double>::infinity();
+	for_each_child([&](SharedNode* child) {
+		double child_visits = child->visits.load(std::memory_order_relaxed);
+		double score = std::numeric_limits<double>::infinity();
+		if (child_visits > 0) {
+			score = child->wins.load(std::memory_order_relaxed) / child_visits
+			        + std::sqrt(2.0 * log_visits / child_visits);
+		}
+		if (best == nullptr || score > best_score) {
+			best = child;
+			best_score = score;
+		}
+	});
+	return best;
+}
+
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
 
+// Adds games to a tree until the iterations or the time run out. The
+// root may already have been searched.
 template <GameState State>
-std::unique_ptr<Node<State>> compute_tree(const State root_state,
-                                          const ComputeOptions options,
-                                          std::mt19937_64::result_type initial_seed) {
-	std::mt19937_64 random_engine(initial_seed);
-
+void compute_tree(const State& root_state,
+                  const ComputeOptions& options,
+                  Node<State>* root,
+                  Arena* arena,
+                  std::mt19937_64* random_engine) {
 	minimum_core_assert(options.max_iterations >= 0 || options.max_time >= 0);
 	// Will support more players later.
 	minimum_core_assert(root_state.player_to_move == 1 || root_state.player_to_move == 2);
-	auto root = std::unique_ptr<Node<State>>(new Node<State>(root_state));
 
 	double start_time = core::wall_time();
 	double print_time = start_time;
 
 	for (int iter = 1; iter <= options.max_iterations || options.max_iterations < 0; ++iter) {
-		auto node = root.get();
+		auto node = root;
 		State state = root_state;
 
 		// Select a path through the tree to a leaf node.
@@ -309,14 +602,14 @@ std::unique_ptr<Node<State>> compute_tree(const State root_state,
 		// If we are not already at the final state, expand the
 		// tree with a new node and move there.
 		if (node->has_untried_moves()) {
-			auto move = node->get_untried_move(&random_engine);
+			auto move = node->get_untried_move(random_engine);
 			state.do_move(move);
-			node = node->add_child(move, state);
+			node = node->add_child(move, state, arena);
 		}
 
 		// We now play randomly until the game ends.
 		while (state.has_moves()) {
-			state.do_random_move(&random_engine);
+			state.do_random_move(random_engine);
 		}
 
 		// We have now reached a final state. Backpropagate the result
@@ -334,64 +627,251 @@ std::unique_ptr<Node<State>> compute_tree(const State root_state,
 				print_time = time;
 			}
 
-			if (time - start_time >= options.max_time) {
+			if (options.max_time >= 0 && time - start_time >= options.max_time) {
 				break;
 			}
 		}
 	}
+}
 
-	return root;
+// Grows a tree shared with other threads until the iterations or the
+// time run out. iterations counts the games started by all threads.
+template <GameState State>
+void compute_shared_tree(const State& root_state,
+                         const ComputeOptions& options,
+                         SharedNode<State>* root,
+                         std::atomic<long long>* iterations,
+                         double start_time,
+                         std::mt19937_64* random_engine) {
+	const long long max_iterations =
+	    (long long)(options.max_iterations) * options.number_of_threads;
+	const int virtual_loss = options.virtual_loss;
+
+	while (true) {
+		if (options.max_iterations >= 0 && iterations->fetch_add(1) >= max_iterations) {
+			break;
+		}
+
+		auto node = root;
+		State state = root_state;
+		node->visits += virtual_loss;
+
+		// Select a path through the tree to a leaf node, adding a new
+		// node if possible.
+		while (true) {
+			if (!node->is_fully_expanded()) {
+				auto child = node->expand(&state, random_engine);
+				if (child != nullptr) {
+					node = child;
+					node->visits += virtual_loss;
+					break;
+				}
+			}
+			auto child = node->select_child_UCT();
+			if (child == nullptr) {
+				break;
+			}
+			state.do_move(child->move);
+			node = child;
+			node->visits += virtual_loss;
+		}
+
+		// We now play randomly until the game ends.
+		while (state.has_moves()) {
+			state.do_random_move(random_engine);
+		}
+
+		// Replace the virtual losses with the result.
+		while (node != nullptr) {
+			node->visits += 1 - virtual_loss;
+			node->wins += state.get_result(node->player_to_move);
+			node = node->parent;
+		}
+
+		if (options.max_time >= 0 && core::wall_time() - start_time >= options.max_time) {
+			break;
+		}
+	}
 }
 
+//
+// Searches for moves during a whole game. The search trees are kept
+// between moves; when a move is played, the subtree below it becomes
+// the new tree, so its games are not played again.
+//
 template <GameState State>
-typename State::Move compute_move(const State root_state, const ComputeOptions options) {
+class MonteCarloTreeSearch {
+   public:
+	typedef typename State::Move Move;
+
+	MonteCarloTreeSearch(const State& state, const ComputeOptions& options = ComputeOptions());
+
+	// Searches from the current state and returns the best move. The
+	// iteration and time limits of the options count new games only.
+	Move compute_move();
+
+	// Plays a move by any of the players.
+	void do_move(const Move& move);
+
+	const State& state() const { return current_state; }
+
+	// Number of games in the trees, including games kept from earlier
+	// searches.
+	long long games_played() const;
+
+   private:
+	struct Tree {
+		std::unique_ptr<Arena> arena;
+		// The kept subtree is copied here when a move is played.
+		std::unique_ptr<Arena> spare_arena;
+		Node<State>* root;
+	};
+
+	State current_state;
+	const ComputeOptions options;
+
+	// One tree per thread for root parallelization.
+	std::vector<Tree> trees;
+	// The tree for tree parallelization.
+	std::unique_ptr<SharedNode<State>> shared_root;
+
+	std::vector<std::mt19937_64> engines;
+	std::mt19937_64 root_engine;
+};
+
+template <GameState State>
+MonteCarloTreeSearch<State>::MonteCarloTreeSearch(const State& state,
+                                                  const ComputeOptions& options_)
+    : current_state(state), options(options_), root_engine(12515) {
+	minimum_core_assert(options.number_of_threads >= 1);
+	for (int t = 0; t < options.number_of_threads; ++t) {
+		engines.emplace_back(1012411 * t + 12515);
+	}
+
+	const Move no_move = State::no_move;
+	if (options.parallelization == ComputeOptions::Parallelization::TREE) {
+		shared_root.reset(new SharedNode<State>(current_state, no_move, nullptr, &root_engine));
+	} else {
+		for (int t = 0; t < options.number_of_threads; ++t) {
+			Tree tree;
+			tree.arena.reset(new Arena);
+			tree.spare_arena.reset(new Arena);
+			tree.root = Node<State>::create(current_state, tree.arena.get());
+			trees.push_back(std::move(tree));
+		}
+	}
+}
+
+template <GameState State>
+void MonteCarloTreeSearch<State>::do_move(const Move& move) {
+	current_state.do_move(move);
+
+	for (auto& tree : trees) {
+		tree.spare_arena->clear();
+		auto child = tree.root->find_child(move);
+		if (child != nullptr) {
+			tree.root = child->copy_to(tree.spare_arena.get());
+		} else {
+			tree.root = Node<State>::create(current_state, tree.spare_arena.get());
+		}
+		std::swap(tree.arena, tree.spare_arena);
+	}
+
+	if (shared_root) {
+		shared_root = shared_root->release_child(move);
+		if (!shared_root) {
+			const Move no_move = State::no_move;
+			shared_root.reset(
+			    new SharedNode<State>(current_state, no_move, nullptr, &root_engine));
+		}
+	}
+}
+
+template <GameState State>
+long long MonteCarloTreeSearch<State>::games_played() const {
+	long long games = 0;
+	for (auto& tree : trees) {
+		games += tree.root->visits;
+	}
+	if (shared_root) {
+		games += shared_root->visits;
+	}
+	return games;
+}
+
+template <GameState State>
+typename State::Move MonteCarloTreeSearch<State>::compute_move() {
 	using namespace std;
 
 	// Will support more players later.
-	minimum_core_assert(root_state.player_to_move == 1 || root_state.player_to_move == 2);
+	minimum_core_assert(current_state.player_to_move == 1 || current_state.player_to_move == 2);
 
-	auto moves = root_state.get_moves();
+	auto moves = current_state.get_moves();
 	minimum_core_assert(moves.size() > 0);
 	if (moves.size() == 1) {
 		return moves[0];
 	}
 
 	double start_time = core::wall_time();
+	long long games_kept = games_played();
+
+	map<Move, int> visits;
+	map<Move, double> wins;
+
+	if (options.parallelization == ComputeOptions::Parallelization::TREE) {
+		minimum_core_assert(options.max_iterations >= 0 || options.max_time >= 0);
+		minimum_core_assert(options.virtual_loss >= 0);
+
+		std::atomic<long long> iterations(0);
+		vector<std::thread> threads;
+		for (int t = 0; t < options.number_of_threads; ++t) {
+			threads.emplace_back([this, t, &iterations, start_time]() {
+				compute_shared_tree(current_state,
+				                    options,
+				                    shared_root.get(),
+				                    &iterations,
+				                    start_time,
+				                    &engines[t]);
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
 
-	// Start all jobs to compute trees.
-	vector<future<unique_ptr<Node<State>>>> root_futures;
-	ComputeOptions job_options = options;
-	job_options.verbose = false;
-	for (int t = 0; t < options.number_of_threads; ++t) {
-		auto func = [t, &root_state, &job_options]() -> std::unique_ptr<Node<State>> {
-			return compute_tree(root_state, job_options, 1012411 * t + 12515);
-		};
-
-		root_futures.push_back(std::async(std::launch::async, func));
-	}
-
-	// Collect the results.
-	vector<unique_ptr<Node<State>>> roots;
-	for (int t = 0; t < options.number_of_threads; ++t) {
-		roots.push_back(std::move(root_futures[t].get()));
-	}
+		shared_root->for_each_child([&](SharedNode<State>* child) {
+			visits[child->move] += child->visits;
+			wins[child->move] += child->wins;
+		});
+	} else {
+		// Start all jobs to grow the trees.
+		vector<future<void>> futures;
+		ComputeOptions job_options = options;
+		job_options.verbose = false;
+		for (int t = 0; t < options.number_of_threads; ++t) {
+			auto func = [this, t, &job_options]() {
+				auto& tree = trees[t];
+				compute_tree(
+				    current_state, job_options, tree.root, tree.arena.get(), &engines[t]);
+			};
+			futures.push_back(std::async(std::launch::async, func));
+		}
+		for (auto& future : futures) {
+			future.get();
+		}
 
-	// Merge the children of all root nodes.
-	map<typename State::Move, int> visits;
-	map<typename State::Move, double> wins;
-	long long games_played = 0;
-	for (int t = 0; t < options.number_of_threads; ++t) {
-		auto root = roots[t].get();
-		games_played += root->visits;
-		for (auto child = root->children.cbegin(); child != root->children.cend(); ++child) {
-			visits[(*child)->move] += (*child)->visits;
-			wins[(*child)->move] += (*child)->wins;
+		// Merge the children of all root nodes.
+		for (auto& tree : trees) {
+			for (auto& child : tree.root->children()) {
+				visits[child.move] += child.visits;
+				wins[child.move] += child.wins;
+			}
 		}
 	}
+	long long games = games_played();
 
 	// Find the node with the most visits.
 	double best_score = -1;
-	typename State::Move best_move = typename State::Move();
+	Move best_move = Move();
 	for (auto itr : visits) {
 		auto move = itr.first;
 		double v = itr.second;
@@ -406,7 +886,7 @@ typename State::Move compute_move(const State root_state, const ComputeOptions o
 
 		if (options.verbose) {
 			cerr << "Move: " << itr.first << " (" << setw(2) << right
-			     << int(100.0 * v / double(games_played) + 0.5) << "% visits)"
+			     << int(100.0 * v / double(games) + 0.5) << "% visits)"
 			     << " (" << setw(2) << right << int(100.0 * w / v + 0.5) << "% wins)" << endl;
 		}
 	}
@@ -415,20 +895,26 @@ typename State::Move compute_move(const State root_state, const ComputeOptions o
 		auto best_wins = wins[best_move];
 		auto best_visits = visits[best_move];
 		cerr << "----" << endl;
-		cerr << "Best: " << best_move << " (" << 100.0 * best_visits / double(games_played)
-		     << "% visits)"
+		cerr << "Best: " << best_move << " (" << 100.0 * best_visits / double(games) << "% visits)"
 		     << " (" << 100.0 * best_wins / best_visits << "% wins)" << endl;
 	}
 
 	if (options.verbose) {
 		double time = core::wall_time();
-		std::cerr << games_played << " games played in " << double(time - start_time) << " s. "
-		          << "(" << double(games_played) / (time - start_time) << " / second, "
-		          << options.number_of_threads << " parallel jobs)." << endl;
+		long long new_games = games - games_kept;
+		std::cerr << new_games << " games played in " << double(time - start_time) << " s. "
+		          << "(" << double(new_games) / (time - start_time) << " / second, "
+		          << options.number_of_threads << " parallel jobs, " << games_kept
+		          << " games kept)." << endl;
 	}
 
 	return best_move;
 }
+
+template <GameState State>
+typename State::Move compute_move(const State root_state, const ComputeOptions options) {
+	return MonteCarloTreeSearch<State>(root_state, options).compute_move();
+}
 }  // namespace ai
 }  // namespace minimum
 
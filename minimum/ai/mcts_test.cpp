@@ -1,6 +1,8 @@
 
 #include <catch.hpp>
 
+#include <minimum/ai/games/connect_four.h>
+#include <minimum/ai/games/connect_four_bitboard.h>
 #include <minimum/ai/games/nim.h>
 #include <minimum/ai/mcts.h>
 
@@ -122,3 +124,128 @@ TEST_CASE("Nim") {
 		}
 	}
 }
+
+TEST_CASE("dummy_tree_parallelization") {
+	minimum::ai::ComputeOptions options;
+	options.parallelization = minimum::ai::ComputeOptions::Parallelization::TREE;
+	CHECK(minimum::ai::compute_move(TestGame(1), options) == 2);
+	CHECK(minimum::ai::compute_move(TestGame(2), options) == 1);
+}
+
+TEST_CASE("Nim_tree_parallelization") {
+	minimum::ai::ComputeOptions options;
+	options.max_iterations = 100000;
+	options.parallelization = minimum::ai::ComputeOptions::Parallelization::TREE;
+
+	for (int chips = 4; chips <= 21; ++chips) {
+		if (chips % 4 != 0) {
+			NimState state(chips);
+			auto move = minimum::ai::compute_move(state, options);
+			INFO(chips);
+			CHECK(move == chips % 4);
+		}
+	}
+}
+
+TEST_CASE("Nim_tree_parallelization_time") {
+	minimum::ai::ComputeOptions options;
+	options.max_iterations = -1;
+	options.max_time = 0.1;
+	options.number_of_threads = 4;
+	options.virtual_loss = 3;
+	options.parallelization = minimum::ai::ComputeOptions::Parallelization::TREE;
+	CHECK(minimum::ai::compute_move(NimState(10), options) == 2);
+}
+
+namespace {
+void play_nim_with_tree_reuse(minimum::ai::ComputeOptions options) {
+	int chips = 21;
+	minimum::ai::MonteCarloTreeSearch<NimState> search(NimState(chips), options);
+	CHECK(search.games_played() == 0);
+	while (search.state().has_moves()) {
+		auto move = search.compute_move();
+		INFO(chips);
+		if (chips % 4 != 0) {
+			CHECK(move == chips % 4);
+		}
+		search.do_move(move);
+		chips -= move;
+		// The games below the move are kept.
+		if (chips > 3) {
+			CHECK(search.games_played() > 0);
+		}
+	}
+	CHECK(chips == 0);
+}
+}  // namespace
+
+TEST_CASE("Nim_tree_reuse") {
+	minimum::ai::ComputeOptions options;
+	options.max_iterations = 100000;
+	play_nim_with_tree_reuse(options);
+}
+
+TEST_CASE("Nim_tree_reuse_tree_parallelization") {
+	minimum::ai::ComputeOptions options;
+	options.max_iterations = 100000;
+	options.parallelization = minimum::ai::ComputeOptions::Parallelization::TREE;
+	play_nim_with_tree_reuse(options);
+}
+
+TEST_CASE("tree_reuse_unexplored_move") {
+	minimum::ai::ComputeOptions options;
+	options.max_iterations = 1;
+	options.number_of_threads = 1;
+	minimum::ai::MonteCarloTreeSearch<TestGame> search(TestGame(1), options);
+	search.compute_move();
+	CHECK(search.games_played() == 1);
+	// At most one of the two moves has been explored.
+	search.do_move(1);
+	search.do_move(2);
+	CHECK(search.games_played() == 0);
+	CHECK_FALSE(search.state().has_moves());
+}
+
+TEST_CASE("connect_four_bitboard") {
+	std::mt19937_64 engine(0);
+	for (int game = 0; game < 1000; ++game) {
+		ConnectFourState state;
+		BitboardConnectFourState bitboard;
+		while (state.has_moves()) {
+			REQUIRE(bitboard.has_moves());
+			auto moves = state.get_moves();
+			REQUIRE(bitboard.get_moves() == moves);
+			CHECK(bitboard.player_to_move == state.player_to_move);
+			std::uniform_int_distribution<std::size_t> index(0, moves.size() - 1);
+			auto move = moves[index(engine)];
+			state.do_move(move);
+			bitboard.do_move(move);
+		}
+		CHECK_FALSE(bitboard.has_moves());
+		CHECK(bitboard.get_moves().empty());
+		CHECK(bitboard.get_result(1) == state.get_result(1));
+		CHECK(bitboard.get_result(2) == state.get_result(2));
+	}
+
+	// Random games end with a full board or four in a row.
+	for (int game = 0; game < 1000; ++game) {
+		BitboardConnectFourState bitboard;
+		int moves = 0;
+		while (bitboard.has_moves()) {
+			bitboard.do_random_move(&engine);
+			moves++;
+		}
+		CHECK(moves <= 42);
+		CHECK((moves == 42 || bitboard.get_winner() != 0));
+	}
+}
+
+TEST_CASE("connect_four_bitboard_mcts") {
+	BitboardConnectFourState state;
+	for (auto move : {0, 1, 0, 1, 0, 6}) {
+		state.do_move(move);
+	}
+	minimum::ai::ComputeOptions options;
+	options.max_iterations = 1000;
+	CHECK(minimum::ai::compute_move(state, options) == 0);
+}
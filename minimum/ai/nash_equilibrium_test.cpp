@@ -1,7 +1,10 @@
 #include <catch.hpp>
 
 #include <minimum/ai/compute_equilibrium.h>
+#include <minimum/ai/compute_equilibrium_cfr.h>
+#include <minimum/ai/compute_equilibrium_saddle_point.h>
 #include <minimum/ai/compute_equilibrium_sequential.h>
+#include <minimum/ai/imperfect_games/goofspiel.h>
 #include <minimum/ai/imperfect_games/kuhn_poker.h>
 #include <minimum/ai/imperfect_games/leduc_holdem.h>
 #include <minimum/ai/imperfect_games/rock_paper_scissors.h>
@@ -137,3 +140,162 @@ TEST_CASE("leduc_holdem") {
 	// Assertion from the paper “Heads-up Limit Hold’em Poker is Solved.”
 	CHECK((result.player_strategies[0].size() + result.player_strategies[0].size()) == 288);
 }
+
+TEST_CASE("kuhn_poker_cfr_plus") {
+	typedef kuhn_poker::State<> State;
+	equilibrium_cfr::Options options;
+	options.max_iterations = 2000;
+	options.number_of_threads = 2;
+	equilibrium_cfr::Solver<State> solver(options);
+	CHECK(solver.information_sets().size() == 12);
+	auto result = solver.solve();
+	CHECK(result.iterations == 2000);
+	CHECK(result.exploitability < 1e-3);
+	CHECK(std::abs(result.value + 1.0 / 18.0) < 1e-3);
+	CHECK(result.player_strategies[0].size() == 6);
+	CHECK(result.player_strategies[1].size() == 6);
+
+	// The exploitability decreases.
+	REQUIRE(result.exploitability_curve.size() >= 1);
+	CHECK(result.exploitability_curve.back().exploitability == result.exploitability);
+	options.max_iterations = 10;
+	auto early = equilibrium_cfr::compute<State>(options);
+	CHECK(early.exploitability > result.exploitability);
+	options.max_iterations = 0;
+	auto none = equilibrium_cfr::compute<State>(options);
+	CHECK(none.iterations == 0);
+
+	// Second player's unique strategy, as in the linear program test.
+	State state(2, 1);
+	state.move(State::Move::check);
+	for (auto move : result.player_strategies[1].at(kuhn_poker::InformationSet<State>(state))) {
+		if (move.first == State::Move::bet) {
+			CHECK(std::abs(move.second - 1.0 / 3.0) < 1e-2);
+		}
+	}
+}
+
+TEST_CASE("kuhn_poker_external_sampling") {
+	equilibrium_cfr::Options options;
+	options.algorithm = equilibrium_cfr::Options::Algorithm::EXTERNAL_SAMPLING;
+	options.max_iterations = 200000;
+	options.number_of_threads = 4;
+	auto result = equilibrium_cfr::compute<kuhn_poker::State<>>(options);
+	CHECK(result.iterations == 200000);
+	CHECK(result.exploitability < 0.01);
+	CHECK(std::abs(result.value + 1.0 / 18.0) < 0.01);
+}
+
+TEST_CASE("leduc_holdem_cfr_plus") {
+	equilibrium_cfr::Options options;
+	options.max_iterations = 200;
+	auto result = equilibrium_cfr::compute<leduc_holdem::State>(options);
+	CHECK(result.player_strategies[0].size() + result.player_strategies[1].size() == 288);
+	CHECK(result.exploitability < 0.01);
+	auto lp_result = equilibrium_sequential::compute<leduc_holdem::State>();
+	INFO(result.value << " " << lp_result.value);
+	CHECK(std::abs(result.value - lp_result.value) < 0.01);
+}
+
+TEST_CASE("stengel_cfr_plus") {
+	equilibrium_cfr::Options options;
+	options.max_iterations = 5000;
+	auto result = equilibrium_cfr::compute<stengel::State>(options);
+	CHECK(std::abs(result.value - 13) < 1e-2);
+	CHECK(result.exploitability < 1e-2);
+}
+
+TEST_CASE("goofspiel_cfr_plus") {
+	// The information sets of the two players compare equal here.
+	equilibrium_cfr::Options options;
+	options.max_iterations = 500;
+	auto result = equilibrium_cfr::compute<goofspiel::State<4>>(options);
+	CHECK(result.player_strategies[0].size() == 161);
+	CHECK(result.player_strategies[1].size() == 161);
+	CHECK(result.exploitability < 0.02);
+	// Symmetric game with value 0.
+	CHECK(std::abs(result.value) <= result.exploitability);
+}
+
+TEST_CASE("kuhn_poker_saddle_point") {
+	typedef kuhn_poker::State<> State;
+	equilibrium_saddle_point::Options options;
+	options.target_gap = 1e-6;
+	auto result = equilibrium_saddle_point::compute<State>(options);
+	CHECK(result.gap <= 1e-6);
+	CHECK(std::abs(result.value + 1.0 / 18.0) < 1e-6);
+	CHECK(result.player_strategies[0].size() == 6);
+	CHECK(result.player_strategies[1].size() == 6);
+
+	// Second player's unique strategy, as in the linear program test.
+	State state(2, 1);
+	state.move(State::Move::check);
+	for (auto move : result.player_strategies[1].at(kuhn_poker::InformationSet<State>(state))) {
+		if (move.first == State::Move::bet) {
+			CHECK(std::abs(move.second - 1.0 / 3.0) < 1e-3);
+		}
+	}
+
+	// The same measure as CFR.
+	equilibrium_cfr::Options cfr_options;
+	cfr_options.max_iterations = 2000;
+	auto cfr_result = equilibrium_cfr::compute<State>(cfr_options);
+	CHECK(result.exploitability == result.gap / 2);
+	CHECK(result.exploitability < cfr_result.exploitability);
+
+	options.max_iterations = 0;
+	auto none = equilibrium_saddle_point::compute<State>(options);
+	CHECK(none.iterations == 0);
+	CHECK(std::isfinite(none.gap));
+}
+
+TEST_CASE("stengel_saddle_point") {
+	auto result = equilibrium_saddle_point::compute<stengel::State>();
+	CHECK(result.gap <= 1e-6);
+	CHECK(std::abs(result.value - 13) < 1e-6);
+}
+
+TEST_CASE("leduc_holdem_saddle_point") {
+	equilibrium_saddle_point::Options options;
+	options.target_gap = 1e-4;
+	options.number_of_threads = 2;
+	auto result = equilibrium_saddle_point::compute<leduc_holdem::State>(options);
+	CHECK(result.player_strategies[0].size() + result.player_strategies[1].size() == 288);
+	CHECK(result.gap <= 1e-4);
+	auto lp_result = equilibrium_sequential::compute<leduc_holdem::State>();
+	INFO(result.value << " " << lp_result.value);
+	CHECK(std::abs(result.value - lp_result.value) < 1e-4);
+}
+
+TEST_CASE("goofspiel_saddle_point") {
+	equilibrium_saddle_point::Options options;
+	options.target_gap = 1e-3;
+	auto result = equilibrium_saddle_point::compute<goofspiel::State<4>>(options);
+	CHECK(result.gap <= 1e-3);
+	CHECK(std::abs(result.value) <= result.gap);
+}
+
+TEST_CASE("saddle_point_matrix_game") {
+	// Rock paper scissors with the matrices written out. Each player
+	// has the empty sequence and one information set.
+	Eigen::SparseMatrix<double> E(2, 4);
+	E.insert(0, 0) = 1;
+	for (int j = 1; j <= 3; ++j) {
+		E.insert(1, j) = 1;
+	}
+	E.insert(1, 0) = -1;
+	Eigen::SparseMatrix<double> A(4, 4);
+	A.insert(1, 2) = -1;
+	A.insert(1, 3) = 1;
+	A.insert(2, 1) = 1;
+	A.insert(2, 3) = -1;
+	A.insert(3, 1) = -1;
+	A.insert(3, 2) = 1;
+	auto solution = equilibrium_saddle_point::solve(A, E, E);
+	CHECK(solution.gap <= 1e-6);
+	CHECK(std::abs(solution.value) <= 1e-6);
+	for (int j = 1; j <= 3; ++j) {
+		CHECK(std::abs(solution.x(j) - 1.0 / 3.0) < 1e-5);
+		CHECK(std::abs(solution.y(j) - 1.0 / 3.0) < 1e-5);
+	}
+}
@@ -1,11 +1,14 @@
 #pragma once
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <random>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -507,18 +510,82 @@ T resource_constrained_shortest_path(SortedDAG<T, num_weights, 0> dag,
 
 namespace internal {
 template <typename T>
-struct WeightedEntry {
-	std::tuple<int, int> prev = std::make_tuple(-1, -1);
-	T cost = std::numeric_limits<T>::max() / 2;
-	bool valid() { return get<0>(prev) >= 0; }
+struct Entry {
+	std::tuple<int, int, int> prev = std::make_tuple(-1, -1, -1);
+	T cost = std::numeric_limits<T>::max();
+	bool reached() const { return cost != std::numeric_limits<T>::max(); }
 };
 }  // namespace internal
 
+// Memory for resource_constrained_shortest_path that can be reused between
+// calls in order to avoid allocating a table for every node and resource
+// state each time.
+//
+// For every node, the workspace keeps a list of the states (resource and
+// consecutive counts) that have been reached, so that unreachable states
+// are never visited. Only the states reached in the previous call are reset.
+//
+// A workspace can not be used from several threads at the same time.
+template <typename T>
+class ResourceConstrainedShortestPathWorkspace {
+   public:
+	// Prepares the workspace for a graph with the given number of nodes and
+	// states per node.
+	void reset(int num_nodes, int num_states_) {
+		for (auto i : minimum::core::range(labels.size())) {
+			for (auto state : labels[i]) {
+				entries[std::size_t(i) * num_states + state] = internal::Entry<T>();
+			}
+			labels[i].clear();
+		}
+		if (labels.size() < num_nodes) {
+			labels.resize(num_nodes);
+		}
+		num_states = num_states_;
+		auto size = std::size_t(num_nodes) * num_states;
+		if (entries.size() < size) {
+			entries.resize(size);
+		}
+	}
+
+	internal::Entry<T>& entry(int i, int state) {
+		return entries[std::size_t(i) * num_states + state];
+	}
+
+	// Updates the entry for the state if the cost is lower than the current
+	// one. Returns true if the entry was changed.
+	bool update(int i, int state, T cost, const std::tuple<int, int, int>& prev) {
+		auto& e = entry(i, state);
+		if (cost < e.cost) {
+			if (!e.reached()) {
+				labels[i].push_back(state);
+			}
+			e.cost = cost;
+			e.prev = prev;
+			return true;
+		}
+		return false;
+	}
+
+	// The reached states of node i in increasing order. The labels of a node
+	// are final once all nodes before it have been processed.
+	const std::vector<int>& reached_states(int i) {
+		std::sort(labels[i].begin(), labels[i].end());
+		return labels[i];
+	}
+
+   private:
+	std::vector<internal::Entry<T>> entries;
+	std::vector<std::vector<int>> labels;
+	int num_states = 0;
+};
+
 template <typename T, int num_weights, int num_edge_weights>
 T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_weights>& dag,
                                      int lower_bound,
                                      int upper_bound,
-                                     std::vector<int>* solution_ptr) {
+                                     std::vector<int>* solution_ptr,
+                                     ResourceConstrainedShortestPathWorkspace<T>* workspace) {
 	static_assert(num_weights >= 1, "Need weights for resource constraints.");
 	static_assert(num_edge_weights <= 1,
 	              "Edge weights for consecutive constraint is not supported.");
@@ -537,18 +604,19 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 		return dag.get_node(0).cost;
 	}
 
-	// partial[i][c] is the smallest cost to reach node i consuming c
+	// The entry for (i, c) has the smallest cost to reach node i consuming c
 	// resource.
-	minimum::core::Grid2D<internal::WeightedEntry<T>, int> partial(dag.size(), upper_bound + 1);
+	auto& partial = *workspace;
+	partial.reset(dag.size(), upper_bound + 1);
 
-	partial(0, dag.get_node(0).weights[0]).cost = dag.get_node(0).cost;
+	auto start_weight = dag.get_node(0).weights[0];
+	if (start_weight <= upper_bound) {
+		partial.update(0, start_weight, dag.get_node(0).cost, std::make_tuple(-1, -1, -1));
+	}
 
 	for (auto i : range(dag.size())) {
-		for (auto c : range(upper_bound + 1)) {
-			if (i > 0 && !partial(i, c).valid()) {
-				// We cannot reach node i with c weight.
-				continue;
-			}
+		for (auto c : partial.reached_states(i)) {
+			auto partial_cost = partial.entry(i, c).cost;
 			for (auto& edge : dag.get_node(i).edges) {
 				// Weight of the path up to and including the edge’s destination.
 				auto weight = c + dag.get_node(edge.to).weights[0];
@@ -561,26 +629,22 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 					continue;
 				}
 				// Cost of the path up to and including the edge’s destination.
-				auto cost = partial(i, c).cost + dag.get_node(edge.to).cost + edge.cost;
-				if (cost < partial(edge.to, weight).cost) {
-					partial(edge.to, weight).cost = cost;
-					partial(edge.to, weight).prev = std::make_tuple(i, c);
-				}
+				auto cost = partial_cost + dag.get_node(edge.to).cost + edge.cost;
+				partial.update(edge.to, weight, cost, std::make_tuple(i, c, 0));
 			}
 		}
 	}
 
 	T best = std::numeric_limits<T>::max();
 	int best_c = -1;
-	for (auto c : range(lower_bound, upper_bound + 1)) {
-		if (partial(dag.size() - 1, c).valid()) {
-			// std::cerr << "-- There is a path with cost " << partial.back()[c].cost
-			//           << " and " << c << " weight.\n";
-			auto cost = partial(dag.size() - 1, c).cost;
-			if (cost < best) {
-				best = cost;
-				best_c = c;
-			}
+	for (auto c : partial.reached_states(dag.size() - 1)) {
+		if (c < lower_bound) {
+			continue;
+		}
+		auto cost = partial.entry(dag.size() - 1, c).cost;
+		if (cost < best) {
+			best = cost;
+			best_c = c;
 		}
 	}
 	check(best_c >= 0, "Could not find a feasible path.");
@@ -589,24 +653,25 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 	solution.push_back(i);
 	int c = best_c;
 	while (true) {
-		std::tie(i, c) = partial(i, c).prev;
+		std::tie(i, c, std::ignore) = partial.entry(i, c).prev;
 		if (i < 0) {
 			break;
 		}
 		solution.push_back(i);
 	}
 	reverse(solution.begin(), solution.end());
-	return partial(dag.size() - 1, best_c).cost;
+	return best;
 }
 
-namespace internal {
-template <typename T>
-struct Entry {
-	std::tuple<int, int, int> prev = std::make_tuple(-1, -1, -1);
-	T cost = std::numeric_limits<T>::max();
-	bool valid() { return get<0>(prev) >= 0; }
-};
-}  // namespace internal
+template <typename T, int num_weights, int num_edge_weights>
+T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_weights>& dag,
+                                     int lower_bound,
+                                     int upper_bound,
+                                     std::vector<int>* solution_ptr) {
+	ResourceConstrainedShortestPathWorkspace<T> workspace;
+	return resource_constrained_shortest_path(
+	    dag, lower_bound, upper_bound, solution_ptr, &workspace);
+}
 
 template <typename T, int num_weights, int num_edge_weights>
 T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_weights>& dag,
@@ -614,7 +679,8 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
                                      int upper_bound,
                                      int min_consecutive,
                                      int max_consecutive,
-                                     std::vector<int>* solution_ptr) {
+                                     std::vector<int>* solution_ptr,
+                                     ResourceConstrainedShortestPathWorkspace<T>* workspace) {
 	static_assert(num_weights >= 2, "Need weights for resource and consecutive constraints.");
 	static_assert(num_edge_weights <= 1,
 	              "Edge weights for consecutive constraint is not supported.");
@@ -636,66 +702,70 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 	lower_bound = std::max(lower_bound, 0);
 	minimum_core_assert(max_consecutive >= 1);
 
-	// partial(i, c, d) is the smallest cost to reach node i consuming c
-	// resource ending in d consecutive active nodes.
-	minimum::core::Grid3D<internal::Entry<T>, int> partial(
-	    dag.size(), upper_bound + 1, max_consecutive + 1);
-
-	partial(0, dag.get_node(0).weights[0], 0).cost = dag.get_node(0).cost;
+	// The entry for (i, c, d) has the smallest cost to reach node i consuming c
+	// resource ending in d consecutive active nodes. The state is c * (max_consecutive + 1) + d.
+	const int num_consecutive = max_consecutive + 1;
+	auto& partial = *workspace;
+	partial.reset(dag.size(), (upper_bound + 1) * num_consecutive);
+
+	auto start_weight = dag.get_node(0).weights[0];
+	if (start_weight <= upper_bound) {
+		partial.update(0,
+		               start_weight * num_consecutive,
+		               dag.get_node(0).cost,
+		               std::make_tuple(-1, -1, -1));
+	}
 
 	for (auto i : range(dag.size())) {
-		for (auto c : range(upper_bound + 1)) {
-			for (auto d : range(max_consecutive + 1)) {
-				if (i > 0 && !partial(i, c, d).valid()) {
-					// We cannot reach node i with c weight and d consecutive.
+		for (auto state : partial.reached_states(i)) {
+			const int c = state / num_consecutive;
+			const int d = state % num_consecutive;
+			auto partial_cost = partial.entry(i, state).cost;
+			for (auto& edge : dag.get_node(i).edges) {
+				auto& to_node = dag.get_node(edge.to);
+
+				// Weight of the path up to and including the edge’s destination.
+				auto weight = c + to_node.weights[0];
+				if constexpr (num_edge_weights > 0) {
+					weight += edge.weights[0];
+				}
+				if (weight < 0) {
+					throw std::runtime_error("Negative resource encountered along path.");
+				}
+				if (weight > upper_bound) {
+					// This path is not allowed.
 					continue;
 				}
-				for (auto& edge : dag.get_node(i).edges) {
-					auto& to_node = dag.get_node(edge.to);
 
-					// Weight of the path up to and including the edge’s destination.
-					auto weight = c + to_node.weights[0];
-					if constexpr (num_edge_weights > 0) {
-						weight += edge.weights[0];
-					}
-					if (weight < 0) {
-						throw std::runtime_error("Negative resource encountered along path.");
-					}
-					if (weight > upper_bound) {
+				auto this_consecutive = to_node.weights[1];
+				// Number of consecutive costs up to and including the edge’s
+				// destination.
+				auto consecutive = d + this_consecutive;
+				if (this_consecutive == 0) {
+					// If this node stops a segment with consecutive cost, we
+					// should make sure the minimum is fulfilled.
+					if (consecutive > 0 && consecutive < min_consecutive) {
 						// This path is not allowed.
 						continue;
 					}
-
-					auto this_consecutive = to_node.weights[1];
-					// Number of consecutive costs up to and including the edge’s
-					// destination.
-					auto consecutive = d + this_consecutive;
-					if (this_consecutive == 0) {
-						// If this node stops a segment with consecutive cost, we
-						// should make sure the minimum is fulfilled.
-						if (consecutive > 0 && consecutive < min_consecutive) {
-							// This path is not allowed.
-							continue;
-						}
-						consecutive = 0;
-					} else if (this_consecutive > 0) {
-						if (consecutive > max_consecutive) {
-							// This path is not allowed.
-							continue;
-						}
-					} else {
-						// Reset the consecutive counter and always allow
-						// this path.
-						consecutive = 0;
-					}
-
-					// Cost of the path up to and including the edge’s destination.
-					auto cost = partial(i, c, d).cost + to_node.cost + edge.cost;
-					if (cost < partial(edge.to, weight, consecutive).cost) {
-						partial(edge.to, weight, consecutive).cost = cost;
-						partial(edge.to, weight, consecutive).prev = std::make_tuple(i, c, d);
+					consecutive = 0;
+				} else if (this_consecutive > 0) {
+					if (consecutive > max_consecutive) {
+						// This path is not allowed.
+						continue;
 					}
+				} else {
+					// Reset the consecutive counter and always allow
+					// this path.
+					consecutive = 0;
 				}
+
+				// Cost of the path up to and including the edge’s destination.
+				auto cost = partial_cost + to_node.cost + edge.cost;
+				partial.update(edge.to,
+				               weight * num_consecutive + consecutive,
+				               cost,
+				               std::make_tuple(i, c, d));
 			}
 		}
 	}
@@ -704,16 +774,16 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 	T best = std::numeric_limits<T>::max();
 	int best_c = -1;
 	int best_d = -1;
-	for (auto c : range(lower_bound, upper_bound + 1)) {
-		for (auto d : range(max_consecutive + 1)) {
-			if (partial(dag.size() - 1, c, d).valid()) {
-				auto cost = partial(dag.size() - 1, c, d).cost;
-				if (cost < best) {
-					best = cost;
-					best_c = c;
-					best_d = d;
-				}
-			}
+	for (auto state : partial.reached_states(dag.size() - 1)) {
+		const int c = state / num_consecutive;
+		if (c < lower_bound) {
+			continue;
+		}
+		auto cost = partial.entry(dag.size() - 1, state).cost;
+		if (cost < best) {
+			best = cost;
+			best_c = c;
+			best_d = state % num_consecutive;
 		}
 	}
 	check(best_c >= 0, "Could not find a feasible path.");
@@ -724,7 +794,7 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 	int c = best_c;
 	int d = best_d;
 	while (true) {
-		std::tie(i, c, d) = partial(i, c, d).prev;
+		std::tie(i, c, d) = partial.entry(i, c * num_consecutive + d).prev;
 		if (i < 0) {
 			break;
 		}
@@ -734,6 +804,23 @@ T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_we
 	return best;
 }
 
+template <typename T, int num_weights, int num_edge_weights>
+T resource_constrained_shortest_path(const SortedDAG<T, num_weights, num_edge_weights>& dag,
+                                     int lower_bound,
+                                     int upper_bound,
+                                     int min_consecutive,
+                                     int max_consecutive,
+                                     std::vector<int>* solution_ptr) {
+	ResourceConstrainedShortestPathWorkspace<T> workspace;
+	return resource_constrained_shortest_path(dag,
+	                                          lower_bound,
+	                                          upper_bound,
+	                                          min_consecutive,
+	                                          max_consecutive,
+	                                          solution_ptr,
+	                                          &workspace);
+}
+
 template <typename T, int num_weights, int num_edge_weights>
 void resource_constrained_shortest_path_partial(
     const SortedDAG<T, num_weights, num_edge_weights>& dag,
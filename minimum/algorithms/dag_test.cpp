@@ -266,6 +266,52 @@ TEST_CASE("shortest_path_resource_and_consecutive") {
 	CHECK_FALSE(translator.made_changes);
 }
 
+TEST_CASE("shortest_path_workspace_reuse") {
+	// One workspace used for problems of different sizes and bounds gives
+	// the same results as fresh workspaces.
+	ResourceConstrainedShortestPathWorkspace<double> workspace;
+	for (int num_days : {10, 4, 15, 10}) {
+		for (int upper_bound : {3, 8, 5}) {
+			CAPTURE(num_days);
+			CAPTURE(upper_bound);
+			ScheduleGraph schedule(num_days);
+			for (int i : range(num_days)) {
+				schedule.dag.set_node_cost(schedule.working_node[i], i % 3 == 0 ? 5.0 : -1.0);
+				schedule.dag.set_node_weight(schedule.working_node[i], 0, 1);
+				schedule.dag.set_node_weight(schedule.working_node[i], 1, 1);
+			}
+
+			vector<int> expected;
+			vector<int> solution;
+			auto expected_cost = resource_constrained_shortest_path(
+			    schedule.dag, 1, upper_bound, 1, 3, &expected);
+			CHECK(resource_constrained_shortest_path(
+			          schedule.dag, 1, upper_bound, 1, 3, &solution, &workspace)
+			      == expected_cost);
+			CHECK(solution == expected);
+
+			expected_cost =
+			    resource_constrained_shortest_path(schedule.dag, 1, upper_bound, &expected);
+			CHECK(resource_constrained_shortest_path(
+			          schedule.dag, 1, upper_bound, &solution, &workspace)
+			      == expected_cost);
+			CHECK(solution == expected);
+		}
+	}
+
+	// The workspace is still usable after an infeasible problem.
+	SortedDAG<double, 2> dag(10);
+	for (int i : range(10)) {
+		dag.set_node_weight(i, 0, 1);
+		if (i > 0) {
+			dag.add_edge(i - 1, i, 1.0);
+		}
+	}
+	vector<int> solution;
+	CHECK_THROWS(resource_constrained_shortest_path(dag, 5, 7, 1, 3, &solution, &workspace));
+	CHECK(resource_constrained_shortest_path(dag, 5, 10, 1, 3, &solution, &workspace) == 9);
+}
+
 TEST_CASE("shortest_path_min_consecutive_endpoints") {
 	int num_days = 10;
 	ScheduleGraph schedule(num_days);
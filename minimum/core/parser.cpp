@@ -1,5 +1,10 @@
+#include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <tuple>
 #include <string_view>
 #include <unordered_map>
 #include <variant>
@@ -7,8 +12,10 @@
 
 #include <minimum/core/check.h>
 #include <minimum/core/parser.h>
+#include <minimum/core/range.h>
 #include <minimum/core/variant.h>
 using minimum::core::check;
+using minimum::core::range;
 using minimum::core::switch_;
 
 namespace minimum::core {
@@ -209,6 +216,232 @@ bool Parser::consume(std::string_view expected) {
 	return false;
 }
 
+CompiledExpression::CompiledExpression(const Expression& expression,
+                                       const std::vector<std::string>& identifiers) {
+	number_of_arguments = static_cast<int>(identifiers.size());
+
+	// The expression is first converted to a graph where every node
+	// is unique. Operands always have lower indices than the node.
+	struct Node {
+		Code code;
+		int left;
+		int right;
+		double constant;
+	};
+	std::vector<Node> nodes;
+	std::map<std::tuple<Code, int, int, std::uint64_t>, int> node_index;
+	auto add_node = [&](Code code, int left, int right, double constant) -> int {
+		if (code == Code::ADD || code == Code::MULTIPLY) {
+			// Commutative.
+			if (left > right) {
+				std::swap(left, right);
+			}
+		}
+		std::uint64_t constant_bits;
+		std::memcpy(&constant_bits, &constant, sizeof(constant));
+		auto key = std::make_tuple(code, left, right, constant_bits);
+		auto itr = node_index.find(key);
+		if (itr != node_index.end()) {
+			return itr->second;
+		}
+		nodes.push_back({code, left, right, constant});
+		int index = static_cast<int>(nodes.size()) - 1;
+		node_index[key] = index;
+		return index;
+	};
+	auto is_constant = [&](int node) { return nodes[node].code == Code::CONSTANT; };
+	auto add_constant = [&](double constant) { return add_node(Code::CONSTANT, -1, -1, constant); };
+
+	for (auto i : range(identifiers.size())) {
+		add_node(Code::ARGUMENT, static_cast<int>(i), -1, 0);
+	}
+
+	// Adds an operation on one node. Folds constants.
+	auto add_unary = [&](Code code, int operand, double constant) -> int {
+		if (is_constant(operand)) {
+			double value = nodes[operand].constant;
+			return add_constant(apply<double>(code, value, value, constant));
+		}
+		return add_node(code, operand, operand, constant);
+	};
+
+	// Adds a binary operation. Folds constants and uses the instructions
+	// with a constant operand when possible.
+	auto add_binary = [&](Code code, int left, int right) -> int {
+		if (is_constant(left) && is_constant(right)) {
+			return add_constant(
+			    apply<double>(code, nodes[left].constant, nodes[right].constant, 0));
+		}
+		if (is_constant(right)) {
+			double c = nodes[right].constant;
+			switch (code) {
+				case Code::ADD:
+					return c == 0 ? left : add_unary(Code::ADD_CONSTANT, left, c);
+				case Code::SUBTRACT:
+					return c == 0 ? left : add_unary(Code::ADD_CONSTANT, left, -c);
+				case Code::MULTIPLY:
+					return c == 1 ? left : add_unary(Code::MULTIPLY_CONSTANT, left, c);
+				case Code::DIVIDE:
+					return c == 1 ? left : add_unary(Code::DIVIDE_BY_CONSTANT, left, c);
+				case Code::POW:
+					if (c == 1) {
+						return left;
+					} else if (c == 2) {
+						return add_node(Code::MULTIPLY, left, left, 0);
+					}
+					return add_unary(Code::POW_CONSTANT, left, c);
+				default:
+					break;
+			}
+		} else if (is_constant(left)) {
+			double c = nodes[left].constant;
+			switch (code) {
+				case Code::ADD:
+					return c == 0 ? right : add_unary(Code::ADD_CONSTANT, right, c);
+				case Code::SUBTRACT:
+					return add_unary(Code::CONSTANT_MINUS, right, c);
+				case Code::MULTIPLY:
+					return c == 1 ? right : add_unary(Code::MULTIPLY_CONSTANT, right, c);
+				case Code::DIVIDE:
+					return add_unary(Code::CONSTANT_DIVIDE, right, c);
+				default:
+					break;
+			}
+		}
+		return add_node(code, left, right, 0);
+	};
+
+	std::vector<int> stack;
+	auto pop = [&stack]() {
+		int node = stack.back();
+		stack.pop_back();
+		return node;
+	};
+	for (auto& command : expression.get_commands()) {
+		switch_(
+		    command,
+		    [&](double constant) { stack.push_back(add_constant(constant)); },
+		    [&](Operation op) {
+			    if (num_function_arguments(op) == 2) {
+				    int right = pop();
+				    int left = pop();
+				    Code code = Code::ADD;
+				    if (op == Operation::SUBTRACT) {
+					    code = Code::SUBTRACT;
+				    } else if (op == Operation::MULTIPLY) {
+					    code = Code::MULTIPLY;
+				    } else if (op == Operation::DIVIDE) {
+					    code = Code::DIVIDE;
+				    } else if (op == Operation::POW) {
+					    code = Code::POW;
+				    }
+				    stack.push_back(add_binary(code, left, right));
+				    return;
+			    }
+
+			    int operand = pop();
+			    Code code = Code::NEGATE;
+			    switch (op) {
+				    case Operation::NEGATE:
+					    code = Code::NEGATE;
+					    break;
+				    case Operation::EXP:
+					    code = Code::EXP;
+					    break;
+				    case Operation::LOG:
+					    code = Code::LOG;
+					    break;
+				    case Operation::LOG10:
+					    code = Code::LOG10;
+					    break;
+				    case Operation::SIN:
+					    code = Code::SIN;
+					    break;
+				    case Operation::COS:
+					    code = Code::COS;
+					    break;
+				    case Operation::TAN:
+					    code = Code::TAN;
+					    break;
+				    case Operation::SQRT:
+					    code = Code::SQRT;
+					    break;
+				    default:
+					    minimum_core_assert(false, "Unknown opcode ", to_string(op));
+			    }
+			    stack.push_back(add_unary(code, operand, 0));
+		    },
+		    [&](const std::string& identifier) {
+			    auto itr = std::find(identifiers.begin(), identifiers.end(), identifier);
+			    check(itr != identifiers.end(), "Unknown identifier: ", identifier);
+			    stack.push_back(static_cast<int>(itr - identifiers.begin()));
+		    });
+	}
+	// The commands have already been validated by Expression.
+	minimum_core_assert(stack.size() == 1);
+	int root = stack.back();
+
+	// Find the nodes needed for the result and where they are last used.
+	// Folded constants and unused arguments are not needed.
+	std::vector<int> last_use(nodes.size(), -1);
+	last_use[root] = root;
+	for (int i = root; i >= 0; --i) {
+		if (last_use[i] < 0 || nodes[i].code == Code::ARGUMENT || nodes[i].code == Code::CONSTANT) {
+			continue;
+		}
+		last_use[nodes[i].left] = std::max(last_use[nodes[i].left], i);
+		last_use[nodes[i].right] = std::max(last_use[nodes[i].right], i);
+	}
+
+	// Arguments are stored in the first registers. Intermediate results
+	// reuse registers when they are no longer needed.
+	std::vector<int> node_register(nodes.size(), -1);
+	std::vector<int> free_registers;
+	number_of_registers = number_of_arguments;
+	for (int i = 0; i <= root; ++i) {
+		if (last_use[i] < 0) {
+			continue;
+		}
+		if (nodes[i].code == Code::ARGUMENT) {
+			node_register[i] = nodes[i].left;
+			continue;
+		}
+
+		Instruction instruction;
+		instruction.code = nodes[i].code;
+		instruction.constant = nodes[i].constant;
+		if (instruction.code == Code::CONSTANT) {
+			instruction.left = -1;
+			instruction.right = -1;
+		} else {
+			instruction.left = node_register[nodes[i].left];
+			instruction.right = node_register[nodes[i].right];
+			for (int operand : {nodes[i].left, nodes[i].right}) {
+				if (last_use[operand] == i && nodes[operand].code != Code::ARGUMENT
+				    && node_register[operand] >= 0) {
+					free_registers.push_back(node_register[operand]);
+					node_register[operand] = -1;
+				}
+			}
+		}
+
+		if (free_registers.empty()) {
+			instruction.result = number_of_registers++;
+		} else {
+			instruction.result = free_registers.back();
+			free_registers.pop_back();
+		}
+		if (instruction.code == Code::CONSTANT) {
+			instruction.left = instruction.result;
+			instruction.right = instruction.result;
+		}
+		node_register[i] = instruction.result;
+		instructions.push_back(instruction);
+	}
+	result_register = node_register[root];
+	number_of_registers = std::max(number_of_registers, 1);
+}
+
 std::ostream& operator<<(std::ostream& out, const Command& command) {
 	switch_(command,
 	        [&out](double constant) { out << constant; },
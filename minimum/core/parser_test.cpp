@@ -14,6 +14,7 @@
 #include <minimum/core/variant.h>
 using Catch::Contains;
 using Catch::Detail::Approx;
+using minimum::core::CompiledExpression;
 using minimum::core::Expression;
 using minimum::core::Parser;
 
@@ -145,3 +146,44 @@ TEST_CASE("complex") {
 	realvars["i"] = 1;
 	CHECK(expr.evaluate<double>(realvars) == 3);
 }
+
+TEST_CASE("compiled_expression") {
+	const std::vector<std::string> names = {"x", "y", "z"};
+	const std::unordered_map<std::string, double> identifiers = {{"x", 0.5}, {"y", 2}, {"z", 3}};
+	const double arguments[] = {0.5, 2, 3};
+	for (auto expr : {"x",
+	                  "2 + 3 * 4",
+	                  "x + y * z",
+	                  "(x + 1) - (2 - y) + 2*z/4",
+	                  "x^2 + y^0.5 + 2^z + x^1 + (1 - z)^3",
+	                  "exp(x) * log(y) - sin(z) / cos(x) + tan(y) + sqrt(z) + log10(y)",
+	                  "-(x + y) * -(x + y) + pow(x + y, x)",
+	                  "1 / x + 3 - y / 2 + 0 + z * 1 - x / 1",
+	                  "((((x + 1) * (x + 2)) * ((x + 3) * (x + 4))) * (((y + 1) * (y + 2)) "
+	                  "* ((y + 3) * (y + 4)))) * ((((z + 1) * (z + 2)) * ((z + 3) * (z + 4))) "
+	                  "* (((x + y) * (y + z)) * ((z + x) * (x + y + z))))"}) {
+		INFO(expr);
+		Expression expression = Parser(expr).parse();
+		CompiledExpression compiled(expression, names);
+		CHECK(compiled.evaluate(arguments) == Approx(expression.evaluate(identifiers)));
+	}
+
+	// Constants are folded.
+	CHECK(CompiledExpression(Parser("2 + 3 * exp(4) - 1").parse(), names).size() == 1);
+	CHECK(CompiledExpression(Parser("x * (2 + 3)").parse(), names).size() == 1);
+	CHECK(CompiledExpression(Parser("x").parse(), names).size() == 0);
+	// Common subexpressions are computed once.
+	CHECK(CompiledExpression(Parser("(x + y) * (y + x)").parse(), names).size() == 2);
+	CHECK(CompiledExpression(Parser("exp(x + 1) + exp(x + 1)").parse(), names).size() == 3);
+
+	CHECK_THROWS_WITH(CompiledExpression(Parser("x + a").parse(), names),
+	                  Contains("Unknown identifier"));
+
+	const double* pointers[] = {&arguments[0], &arguments[1], &arguments[2]};
+	CompiledExpression compiled(Parser("x * y + z").parse(), names);
+	CHECK(compiled.evaluate_scalars(pointers) == Approx(4));
+
+	const std::complex<double> complex_arguments[] = {{1, 0}, {0, 1}, {0, 0}};
+	CompiledExpression complex_compiled(Parser("x + 2*y").parse(), names);
+	CHECK(complex_compiled.evaluate(complex_arguments) == std::complex<double>(1, 2));
+}
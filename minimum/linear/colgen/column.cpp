@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cmath>
 #include <vector>
 using namespace std;
 
 #include <minimum/core/check.h>
+#include <minimum/core/hash.h>
 #include <minimum/linear/colgen/column.h>
 using namespace minimum::core;
 
@@ -10,104 +12,188 @@ namespace minimum {
 namespace linear {
 namespace colgen {
 
-class Column::Implementation {
-   public:
-	vector<RowEntry> rows;
-	double cost = 0;
-	double lower_bound = 0;
-	double upper_bound = 1e100;
-	int fixed_value = -1;
-	bool is_integer = true;
-};
+size_t ColumnStorage::add(double cost_, double lower_bound_, double upper_bound_) {
+	cost.push_back(cost_);
+	lower_bound.push_back(lower_bound_);
+	upper_bound.push_back(upper_bound_);
+	fixed_value.push_back(-1);
+	is_integer.push_back(1);
+	hash.push_back(0);
+	offsets.push_back(entries.size());
+	return size() - 1;
+}
+
+size_t ColumnStorage::add(const ColumnStorage& other, size_t i) {
+	cost.push_back(other.cost[i]);
+	lower_bound.push_back(other.lower_bound[i]);
+	upper_bound.push_back(other.upper_bound[i]);
+	fixed_value.push_back(other.fixed_value[i]);
+	is_integer.push_back(other.is_integer[i]);
+	hash.push_back(other.hash[i]);
+	entries.insert(entries.end(),
+	               other.entries.begin() + other.offsets[i],
+	               other.entries.begin() + other.offsets[i + 1]);
+	offsets.push_back(entries.size());
+	return size() - 1;
+}
+
+void ColumnStorage::add_coefficient(size_t i, int row, double coef) {
+	check(i + 1 == size(), "Can only add coefficients to the last column in a storage.");
+	entries.emplace_back(row, coef);
+	offsets.back() = entries.size();
+	hash[i] = hash_combine(hash[i], hasher(row, coef));
+}
+
+double ColumnStorage::reduced_cost(size_t i, const vector<double>& dual_variables) const {
+	const RowEntry* entry = entries.data() + offsets[i];
+	const RowEntry* end = entries.data() + offsets[i + 1];
+	const double* dual = dual_variables.data();
+
+	// Four independent accumulators break the dependency chain of the sum and
+	// allow the compiler to vectorize the gathers from the dual vector.
+	double sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+	for (; entry + 4 <= end; entry += 4) {
+		sum0 += entry[0].coef * dual[entry[0].row];
+		sum1 += entry[1].coef * dual[entry[1].row];
+		sum2 += entry[2].coef * dual[entry[2].row];
+		sum3 += entry[3].coef * dual[entry[3].row];
+	}
+	for (; entry < end; ++entry) {
+		sum0 += entry->coef * dual[entry->row];
+	}
+	return cost[i] - ((sum0 + sum1) + (sum2 + sum3));
+}
+
+void ColumnStorage::reserve(size_t columns, size_t entries_) {
+	entries.reserve(entries_);
+	offsets.reserve(columns + 1);
+	cost.reserve(columns);
+	lower_bound.reserve(columns);
+	upper_bound.reserve(columns);
+	fixed_value.reserve(columns);
+	is_integer.reserve(columns);
+	hash.reserve(columns);
+}
 
-Column::Column() : impl(nullptr) {}
+void ColumnStorage::clear() {
+	entries.clear();
+	offsets.assign(1, 0);
+	cost.clear();
+	lower_bound.clear();
+	upper_bound.clear();
+	fixed_value.clear();
+	is_integer.clear();
+	hash.clear();
+}
+
+Column::Column() : storage(nullptr), index(0), owns_storage(false) {}
 
-Column::Column(double cost, double lower_bound, double upper_bound) : impl(new Implementation) {
-	impl->cost = cost;
-	impl->lower_bound = lower_bound;
-	impl->upper_bound = upper_bound;
+Column::Column(double cost, double lower_bound, double upper_bound)
+    : storage(new ColumnStorage), index(0), owns_storage(true) {
+	storage->add(cost, lower_bound, upper_bound);
 }
 
+Column::Column(ColumnStorage* storage_, size_t i)
+    : storage(storage_), index(i), owns_storage(false) {}
+
 Column::Column(Column&& rhs) noexcept {
-	impl = rhs.impl;
+	storage = rhs.storage;
+	index = rhs.index;
+	owns_storage = rhs.owns_storage;
 	solution_value = rhs.solution_value;
-	rhs.impl = nullptr;
+	rhs.storage = nullptr;
+	rhs.owns_storage = false;
 }
 
-Column::~Column() { delete impl; }
+Column::~Column() {
+	if (owns_storage) {
+		delete storage;
+	}
+}
 
 Column& Column::operator=(Column&& rhs) {
-	delete impl;
-	impl = rhs.impl;
+	if (owns_storage) {
+		delete storage;
+	}
+	storage = rhs.storage;
+	index = rhs.index;
+	owns_storage = rhs.owns_storage;
 	solution_value = rhs.solution_value;
-	rhs.impl = nullptr;
+	rhs.storage = nullptr;
+	rhs.owns_storage = false;
 	return *this;
 }
 
 double Column::lower_bound() const {
 	if (is_fixed()) {
-		return impl->fixed_value;
+		return storage->fixed_value[index];
 	}
-	return impl->lower_bound;
+	return storage->lower_bound[index];
 }
 
 double Column::upper_bound() const {
 	if (is_fixed()) {
-		return impl->fixed_value;
+		return storage->fixed_value[index];
 	}
-	return impl->upper_bound;
+	return storage->upper_bound[index];
 }
 
-double Column::cost() const { return impl->cost; }
+double Column::cost() const { return storage->cost[index]; }
 
-void Column::add_coefficient(int row, double coef) { impl->rows.emplace_back(row, coef); }
+void Column::add_coefficient(int row, double coef) {
+	check(owns_storage, "Can not add coefficients to a column in a pool.");
+	storage->add_coefficient(index, row, coef);
+}
 
 void Column::set_integer(bool is_integer) {
 	check(!(is_fixed() && !is_integer), "Can not set a fixed column to be real-valued.");
-	impl->is_integer = is_integer;
+	storage->is_integer[index] = is_integer;
 }
 
-bool Column::is_integer() const { return impl->is_integer; }
+bool Column::is_integer() const { return storage->is_integer[index] != 0; }
 
 void Column::fix(int value) {
 	check(value >= 0, "Can not fix column to negative value.");
-	check(impl->is_integer, "Can not fix real-valued column.");
+	check(is_integer(), "Can not fix real-valued column.");
 	solution_value = value;
-	impl->fixed_value = value;
+	storage->fixed_value[index] = value;
 }
 
-void Column::unfix() { impl->fixed_value = -1; }
+void Column::unfix() { storage->fixed_value[index] = -1; }
 
-bool Column::is_fixed() const { return impl->fixed_value >= 0; }
+bool Column::is_fixed() const { return storage->fixed_value[index] >= 0; }
 
 double Column::reduced_cost(const std::vector<double>& dual_variables) const {
-	double value = impl->cost;
-	for (auto& entry : impl->rows) {
-		value -= entry.coef * dual_variables[entry.row];
-	}
-	return value;
+	return storage->reduced_cost(index, dual_variables);
 }
 
-RowEntry* Column::begin() { return impl->rows.data(); }
+size_t Column::hash() const { return storage->hash[index]; }
 
-RowEntry* Column::end() { return impl->rows.data() + impl->rows.size(); }
+RowEntry* Column::begin() { return storage->entries.data() + storage->offsets[index]; }
 
-const RowEntry* Column::begin() const { return impl->rows.data(); }
+RowEntry* Column::end() { return storage->entries.data() + storage->offsets[index + 1]; }
 
-const RowEntry* Column::end() const { return impl->rows.data() + impl->rows.size(); }
+const RowEntry* Column::begin() const {
+	return storage->entries.data() + storage->offsets[index];
+}
+
+const RowEntry* Column::end() const {
+	return storage->entries.data() + storage->offsets[index + 1];
+}
 
 bool Column::operator==(const Column& rhs) const {
-	return abs(impl->cost - rhs.impl->cost) < 1e-9
-	       && abs(impl->upper_bound - rhs.impl->upper_bound) < 1e-9
-	       && abs(impl->lower_bound - rhs.impl->lower_bound) < 1e-9 && impl->rows == rhs.impl->rows;
+	return abs(cost() - rhs.cost()) < 1e-9
+	       && abs(storage->upper_bound[index] - rhs.storage->upper_bound[rhs.index]) < 1e-9
+	       && abs(storage->lower_bound[index] - rhs.storage->lower_bound[rhs.index]) < 1e-9
+	       && hash() == rhs.hash() && equal(begin(), end(), rhs.begin(), rhs.end());
 }
 
 proto::Column Column::to_proto() const {
 	proto::Column proto_column;
-	proto_column.set_cost(impl->cost);
-	proto_column.set_lower_bound(impl->lower_bound);
-	proto_column.set_upper_bound(impl->upper_bound);
-	for (auto& entry : impl->rows) {
+	proto_column.set_cost(cost());
+	proto_column.set_lower_bound(storage->lower_bound[index]);
+	proto_column.set_upper_bound(storage->upper_bound[index]);
+	for (auto& entry : *this) {
 		auto proto_entry = proto_column.add_entry();
 		proto_entry->set_row(entry.row);
 		proto_entry->set_value(entry.coef);
@@ -15,7 +15,42 @@ struct RowEntry {
 	bool operator==(const RowEntry& rhs) const { return row == rhs.row && coef == rhs.coef; }
 };
 
+// Contiguous storage for many columns, similar to a CSC matrix. The row
+// entries of all columns are stored in one array with per-column offsets
+// and every other property is stored in an array of its own.
+//
+// Only the last column may have coefficients added to it.
+class MINIMUM_LINEAR_COLGEN_API ColumnStorage {
+   public:
+	std::vector<RowEntry> entries;
+	// Column i has the entries [offsets[i], offsets[i + 1]).
+	std::vector<std::size_t> offsets = {0};
+	std::vector<double> cost;
+	std::vector<double> lower_bound;
+	std::vector<double> upper_bound;
+	std::vector<int> fixed_value;
+	std::vector<char> is_integer;
+	std::vector<std::size_t> hash;
+
+	std::size_t size() const { return cost.size(); }
+
+	// Adds an empty column and returns its index.
+	std::size_t add(double cost, double lower_bound, double upper_bound);
+	// Copies column i of another storage to the end of this one and returns
+	// its index.
+	std::size_t add(const ColumnStorage& other, std::size_t i);
+	void add_coefficient(std::size_t i, int row, double coef);
+
+	double reduced_cost(std::size_t i, const std::vector<double>& dual_variables) const;
+
+	void reserve(std::size_t columns, std::size_t entries);
+	void clear();
+};
+
 // Holds one column in a column generation problem.
+//
+// A column created with the public constructor owns its data. Columns
+// in a ColumnPool are lightweight views into the storage of the pool.
 class MINIMUM_LINEAR_COLGEN_API Column {
    public:
 	double solution_value = 0;
@@ -34,6 +69,7 @@ class MINIMUM_LINEAR_COLGEN_API Column {
 	double upper_bound() const;
 	double cost() const;
 
+	// Only allowed for columns that are not part of a pool.
 	void add_coefficient(int row, double coef);
 
 	// Whether this column should be an integer in the final
@@ -50,6 +86,11 @@ class MINIMUM_LINEAR_COLGEN_API Column {
 
 	double reduced_cost(const std::vector<double>& dual_variables) const;
 
+	// Fingerprint of the column entries in the system matrix. It is updated
+	// incrementally by add_coefficient, so equal columns always have equal
+	// hashes.
+	std::size_t hash() const;
+
 	RowEntry* begin();
 	RowEntry* end();
 	const RowEntry* begin() const;
@@ -65,8 +106,13 @@ class MINIMUM_LINEAR_COLGEN_API Column {
 	static Column from_proto(const proto::Column& proto_column);
 
    private:
-	class Implementation;
-	Implementation* impl;
+	friend class ColumnPool;
+	// Creates a view of column i in storage.
+	Column(ColumnStorage* storage, std::size_t i);
+
+	ColumnStorage* storage;
+	std::size_t index;
+	bool owns_storage;
 };
 }  // namespace colgen
 }  // namespace linear
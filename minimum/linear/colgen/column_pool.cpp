@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <iostream>
+#include <unordered_map>
 using namespace std;
 
 #include <minimum/core/check.h>
@@ -16,7 +17,30 @@ namespace colgen {
 class ColumnPool::Implementation {
    public:
 	vector<ColumnScore> column_scores;
+	vector<double> reduced_costs;
+	// All column data is stored here and columns is a vector of views into it.
+	ColumnStorage storage;
 	vector<Column> columns;
+	// Maps Column::hash to the indices of all columns with that hash.
+	unordered_multimap<size_t, size_t> column_index;
+	size_t duplicates_rejected = 0;
+
+	bool contains(const Column& column) const {
+		auto [first, last] = column_index.equal_range(column.hash());
+		for (auto itr = first; itr != last; ++itr) {
+			if (columns[itr->second] == column) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Whether column i is not fixed to zero.
+	bool is_allowed(size_t i) const {
+		double upper_bound =
+		    storage.fixed_value[i] >= 0 ? storage.fixed_value[i] : storage.upper_bound[i];
+		return upper_bound > 1e-9;
+	}
 };
 
 ColumnPool::ColumnPool() : impl(new Implementation) {}
@@ -32,20 +56,36 @@ ColumnPool::ColumnPool(std::istream* in) : impl(new Implementation) {
 		}
 		proto::Column column;
 		check(column.ParseFromArray(tmp.data(), tmp.size()), "Could not parse column.");
-		impl->columns.emplace_back(Column::from_proto(column));
+		push_back(Column::from_proto(column));
 	}
 }
 
 ColumnPool::~ColumnPool() { delete impl; }
 
-void ColumnPool::add(Column&& column) {
-	// TODO: Check if the columns exists in a smarter way.
-	if (find(impl->columns.begin(), impl->columns.end(), column) != impl->columns.end()) {
-		return;
+bool ColumnPool::add(Column&& column) {
+	if (impl->contains(column)) {
+		impl->duplicates_rejected++;
+		return false;
 	}
-	impl->columns.emplace_back(move(column));
+	push_back(move(column));
+	return true;
 }
 
+void ColumnPool::push_back(Column&& column) {
+	auto i = impl->storage.add(*column.storage, column.index);
+	impl->column_index.emplace(column.hash(), i);
+	impl->columns.emplace_back(Column(&impl->storage, i));
+	impl->columns.back().solution_value = column.solution_value;
+}
+
+void ColumnPool::reserve(size_t columns, size_t entries) {
+	impl->storage.reserve(columns, entries);
+	impl->columns.reserve(columns);
+	impl->column_index.reserve(columns);
+}
+
+size_t ColumnPool::duplicates_rejected() const { return impl->duplicates_rejected; }
+
 size_t ColumnPool::size() const { return impl->columns.size(); }
 
 const Column& ColumnPool::at(size_t index) const { return impl->columns.at(index); }
@@ -56,7 +96,7 @@ size_t ColumnPool::allowed_size() const {
 	size_t num = 0;
 	for (auto i : range(size())) {
 		// Do not include columns that are fixed to zero.
-		if (impl->columns[i].upper_bound() > 1e-9) {
+		if (impl->is_allowed(i)) {
 			num++;
 		}
 	}
@@ -65,29 +105,47 @@ size_t ColumnPool::allowed_size() const {
 
 const vector<ColumnScore>& ColumnPool::get_sorted(const vector<double>& dual_variables,
                                                   std::size_t max_count) {
+	auto& storage = impl->storage;
+	auto& reduced_costs = impl->reduced_costs;
+	const ptrdiff_t n = size();
+	reduced_costs.resize(n);
+
+	// Scan the storage arrays directly instead of going through the column
+	// views. Columns fixed to zero get a non-negative reduced cost so that
+	// they are never returned.
+#pragma omp parallel for schedule(static) if (n >= 10'000)
+	for (ptrdiff_t i = 0; i < n; ++i) {
+		if (impl->is_allowed(i)) {
+			reduced_costs[i] = storage.reduced_cost(i, dual_variables);
+		} else {
+			reduced_costs[i] = 0;
+		}
+	}
+
 	impl->column_scores.clear();
-	for (auto i : range(size())) {
-		// Do not include columns that are fixed to zero.
-		if (impl->columns[i].upper_bound() > 1e-9) {
+	for (auto i : range(n)) {
+		if (reduced_costs[i] < 0) {
 			impl->column_scores.emplace_back();
 			impl->column_scores.back().index = i;
-			impl->column_scores.back().reduced_cost = impl->columns[i].reduced_cost(dual_variables);
+			impl->column_scores.back().reduced_cost = reduced_costs[i];
 		}
 	}
-	sort(impl->column_scores.begin(), impl->column_scores.end());
 
-	if (max_count > 0 && impl->column_scores.size() > max_count) {
-		impl->column_scores.resize(max_count);
-	}
-
-	for (auto i : range(impl->column_scores.size())) {
-		if (impl->column_scores[i].reduced_cost >= 0) {
-			impl->column_scores.resize(i);
-			break;
-		}
+	// Ties are broken by index so that the result does not depend on whether
+	// the full or the partial sort is used.
+	auto less = [](const ColumnScore& lhs, const ColumnScore& rhs) {
+		return lhs.reduced_cost < rhs.reduced_cost
+		       || (lhs.reduced_cost == rhs.reduced_cost && lhs.index < rhs.index);
+	};
+	auto& scores = impl->column_scores;
+	if (max_count > 0 && scores.size() > max_count) {
+		// Only the best max_count columns are needed.
+		nth_element(scores.begin(), scores.begin() + max_count, scores.end(), less);
+		scores.resize(max_count);
 	}
+	sort(scores.begin(), scores.end(), less);
 
-	return impl->column_scores;
+	return scores;
 }
 
 Column* ColumnPool::begin() { return impl->columns.data(); }
@@ -100,7 +158,10 @@ const Column* ColumnPool::end() const { return impl->columns.data() + impl->colu
 
 void ColumnPool::clear() {
 	impl->columns.clear();
+	impl->storage.clear();
 	impl->column_scores.clear();
+	impl->column_index.clear();
+	impl->duplicates_rejected = 0;
 }
 
 void ColumnPool::save_to_stream(std::ostream* out) const {
@@ -21,6 +21,9 @@ struct ColumnScore {
 
 // This container owns all columns for a complete run of column generation. No column is
 // ever purged from the pool.
+//
+// The data of all columns is stored contiguously in a ColumnStorage and the columns
+// returned by at() and begin() are views into it.
 class MINIMUM_LINEAR_COLGEN_API ColumnPool {
    public:
 	ColumnPool();
@@ -36,8 +39,17 @@ class MINIMUM_LINEAR_COLGEN_API ColumnPool {
 	std::size_t allowed_size() const;
 
 	// Adds a column to the pool. If an equal column already exists, a duplicate one
-	// will not be added.
-	void add(Column&& column);
+	// will not be added and false is returned.
+	//
+	// Duplicates are detected via Column::hash, so columns must not be modified
+	// with add_coefficient after they have been added.
+	bool add(Column&& column);
+
+	// Number of columns rejected by add() because they were already present.
+	std::size_t duplicates_rejected() const;
+
+	// Preallocates storage for the given number of columns and row entries.
+	void reserve(std::size_t columns, std::size_t entries);
 
 	// Returns the columns with negative reduced costs, sorted with the most negative
 	// reduced cost first.
@@ -57,6 +69,9 @@ class MINIMUM_LINEAR_COLGEN_API ColumnPool {
 	void save_to_stream(std::ostream* out) const;
 
    private:
+	// Adds a column without checking for duplicates.
+	void push_back(Column&& column);
+
 	class Implementation;
 	Implementation* impl;
 };
@@ -71,15 +71,31 @@ TEST_CASE("duplicates") {
 	Column column_different_upper_bound(0, 0, 0.5);
 	column_different_upper_bound.add_coefficient(0, 1);
 
+	CHECK(column0.hash() == column00.hash());
+	CHECK(column0.hash() != column1.hash());
+
 	ColumnPool pool;
-	pool.add(move(column0));
-	pool.add(move(column1));
-	pool.add(move(column00));
-	pool.add(move(column_different_cost));
-	pool.add(move(column_different_lower_bound));
-	pool.add(move(column_different_upper_bound));
+	CHECK(pool.add(move(column0)));
+	CHECK(pool.add(move(column1)));
+	CHECK_FALSE(pool.add(move(column00)));
+	CHECK(pool.add(move(column_different_cost)));
+	CHECK(pool.add(move(column_different_lower_bound)));
+	CHECK(pool.add(move(column_different_upper_bound)));
 
 	REQUIRE(pool.size() == 5);
+	CHECK(pool.duplicates_rejected() == 1);
+
+	// Duplicates are detected for columns loaded from a stream as well.
+	stringstream str;
+	pool.save_to_stream(&str);
+	ColumnPool loaded_pool(&str);
+	Column column01(0, 0, 1);
+	column01.add_coefficient(1, 1);
+	CHECK_FALSE(loaded_pool.add(move(column01)));
+	CHECK(loaded_pool.size() == 5);
+
+	pool.clear();
+	CHECK(pool.duplicates_rejected() == 0);
 }
 
 TEST_CASE("const_member_functions") {
@@ -102,3 +118,70 @@ TEST_CASE("can_not_set_fixed_column_to_be_read_valued") {
 	column.fix(1);
 	CHECK_THROWS(column.set_integer(false));
 }
+
+TEST_CASE("columns_in_pool_are_views") {
+	Column column0(1, 0, 1);
+	column0.add_coefficient(0, 1);
+	column0.add_coefficient(2, 3);
+	column0.fix(1);
+	Column column1(2, 0, 5);
+	column1.add_coefficient(1, -1);
+	column1.set_integer(false);
+
+	ColumnPool pool;
+	pool.reserve(2, 3);
+	pool.add(move(column0));
+	pool.add(move(column1));
+
+	CHECK(pool.at(0).is_fixed());
+	CHECK(pool.at(0).solution_value == 1);
+	CHECK(pool.at(0).lower_bound() == 1);
+	CHECK(pool.at(0).upper_bound() == 1);
+	CHECK_FALSE(pool.at(1).is_integer());
+	CHECK(pool.at(1).cost() == 2);
+	CHECK(pool.at(1).upper_bound() == 5);
+
+	REQUIRE(pool.at(0).end() - pool.at(0).begin() == 2);
+	CHECK(pool.at(0).begin()[1] == RowEntry(2, 3));
+	REQUIRE(pool.at(1).end() - pool.at(1).begin() == 1);
+	CHECK(*pool.at(1).begin() == RowEntry(1, -1));
+
+	vector<double> dual = {1, 1, 1};
+	CHECK(pool.at(0).reduced_cost(dual) == -3);
+
+	pool.at(0).unfix();
+	CHECK(pool.at(0).upper_bound() == 1);
+	CHECK_THROWS(pool.at(0).add_coefficient(1, 1));
+}
+
+TEST_CASE("get_sorted_large") {
+	// Large enough to use the parallel scan. The cost makes every column
+	// distinct so that none of them are rejected as duplicates.
+	const int n = 20'000;
+	ColumnPool pool;
+	for (int i = 0; i < n; ++i) {
+		Column column(i % 7 + 1e-4 * i, 0, 1);
+		for (int r = 0; r < 1 + i % 9; ++r) {
+			column.add_coefficient((i + r) % 10, 1);
+		}
+		pool.add(move(column));
+	}
+	REQUIRE(pool.size() == n);
+	vector<double> dual = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+	auto all = pool.get_sorted(dual);
+	REQUIRE(!all.empty());
+	for (size_t i = 1; i < all.size(); ++i) {
+		CHECK(all[i - 1].reduced_cost <= all[i].reduced_cost);
+		CHECK(all[i].reduced_cost < 0);
+	}
+	for (auto& score : all) {
+		CHECK(score.reduced_cost == pool.at(score.index).reduced_cost(dual));
+	}
+
+	auto best = pool.get_sorted(dual, 100);
+	REQUIRE(best.size() == 100);
+	for (size_t i = 0; i < best.size(); ++i) {
+		CHECK(best[i] == all[i]);
+	}
+}
@@ -20,6 +20,7 @@ using namespace std;
 #include <minimum/core/scope_guard.h>
 #include <minimum/core/time.h>
 #include <minimum/linear/colgen/problem.h>
+#include <minimum/linear/colgen/restricted_master_problem.h>
 #include <minimum/linear/first_order_solver.h>
 #include <minimum/linear/ip.h>
 #include <minimum/linear/scs.h>
@@ -72,7 +73,8 @@ class Problem::Implementation {
 	      number_of_rows(number_of_rows_),
 	      row_lb(number_of_rows_, -1e100),
 	      row_ub(number_of_rows_, 1e100),
-	      dual_solution(number_of_rows, 0) {
+	      dual_solution(number_of_rows, 0),
+	      rmp(parent_.pool, row_lb, row_ub) {
 		if (!FLAGS_proto_log_file.empty()) {
 			iteration_data.emplace(FLAGS_proto_log_file, ios::binary);
 		}
@@ -88,6 +90,7 @@ class Problem::Implementation {
 	vector<double> dual_solution;
 	vector<int> column_inactive_count;
 	double objective_constant = 0;
+	RestrictedMasterProblem rmp;
 
 	std::optional<std::ofstream> iteration_data;
 	std::vector<proto::Event> current_events;
@@ -200,55 +203,59 @@ class Problem::Implementation {
 		return ip;
 	}
 
-	double solve_lp(bool use_integer_variables = false) {
-		FLAMEGRAPH_LOG_FUNCTION;
+	// SCS does not support warm-starting from a persistent problem, so a
+	// new IP is created every iteration.
+	double solve_lp_with_scs() {
 		vector<Variable> column_variables;
 		vector<DualVariable> row_variables;
-		auto ip = create_ip(use_integer_variables, &column_variables, &row_variables);
-
-		check(!FLAGS_use_scs || FLAGS_use_first_order_solver,
-		      "--scs requires --use_first_order_solver.");
-		if (FLAGS_use_first_order_solver) {
-			if (FLAGS_use_scs) {
-				ScsSolver solver;
-				solver.set_convergence_tolerance(1e-3);
-				solver.set_silent(true);
-				solver.set_max_iterations(5'000);
-
-				solver.solutions(ip.get())->get();
-			} else {
-				PrimalDualSolver solver;
-				solver.options().maximum_iterations = 5000;
-				solver.options().tolerance = 1e-6;
-				solver.options().rescale_c = !FLAGS_disable_rescale_c;
-
-				solver.solutions(ip.get())->get();
-			}
-		} else {
-			IPSolver solver;
-			// GlopSolver solver;
-
-			solver.set_silent(true);
-			if (!solver.solutions(ip.get())->get()) {
-				return numeric_limits<double>::quiet_NaN();
-			}
-		}
+		auto ip = create_ip(false, &column_variables, &row_variables);
 
-		double objective = ip->get_entire_objective();
+		ScsSolver solver;
+		solver.set_convergence_tolerance(1e-3);
+		solver.set_silent(true);
+		solver.set_max_iterations(5'000);
+		solver.solutions(ip.get())->get();
 
 		for (int i = 0; i < number_of_rows; ++i) {
 			dual_solution[i] = row_variables[i].value();
 		}
-
 		for (auto j : range(active_columns.size())) {
 			auto i = active_columns.at(j);
 			auto lb = parent.pool.at(i).lower_bound();
 			auto ub = parent.pool.at(i).upper_bound();
 			parent.pool.at(i).solution_value = min(ub, max(lb, column_variables[j].value()));
 		}
+		return ip->get_entire_objective();
+	}
+
+	double solve_lp() {
+		FLAMEGRAPH_LOG_FUNCTION;
+
+		check(!FLAGS_use_scs || FLAGS_use_first_order_solver,
+		      "--scs requires --use_first_order_solver.");
+		double objective;
+		if (FLAGS_use_first_order_solver && FLAGS_use_scs) {
+			objective = solve_lp_with_scs();
+		} else {
+			// The restricted master problem is kept between iterations and
+			// only updated with the changes to the active columns.
+			rmp.set_columns(active_columns);
+			if (FLAGS_use_first_order_solver) {
+				FirstOrderOptions options;
+				options.maximum_iterations = 5000;
+				options.tolerance = 1e-6;
+				options.rescale_c = !FLAGS_disable_rescale_c;
+				objective = rmp.solve_first_order(options, &dual_solution);
+			} else {
+				objective = rmp.solve_simplex(&dual_solution);
+			}
+		}
 
 		if (!FLAGS_save_ip_directory.empty()) {
 			static int ip_count = 0;
+			vector<Variable> column_variables;
+			vector<DualVariable> row_variables;
+			auto ip = create_ip(false, &column_variables, &row_variables);
 
 			Timer t("Saving IP proto");
 			ofstream fout(to_string(FLAGS_save_ip_directory, "/", ip_count, ".ip"), ios::binary);
@@ -314,6 +321,7 @@ double Problem::solve() {
 
 	for (int iteration = 1; iteration <= 100'000; ++iteration) {
 		int generated_columns = 0;
+		int duplicate_columns = 0;
 		int fixed_columns = 0;
 
 		double fix_time = numeric_limits<double>::quiet_NaN();
@@ -332,8 +340,10 @@ double Problem::solve() {
 		if (iteration >= 2) {
 			double start_time = wall_time();
 			auto old_size = pool.size();
+			auto old_duplicates = pool.duplicates_rejected();
 			generate(impl->dual_solution);
 			generated_columns = pool.size() - old_size;
+			duplicate_columns = pool.duplicates_rejected() - old_duplicates;
 			generate_time = wall_time() - start_time;
 		}
 
@@ -367,8 +377,8 @@ double Problem::solve() {
 
 		if (iteration % 100 == 1) {
 			// clang-format off
-			cerr << "  Iter |       Objective      |    Problem   |    Pool   | Fixed  |                  Time                  | Frac. |\n";
-			cerr << "       |    frac.     rounded |   size  diff | size gen. |        |    fix       gen     solve   tot. cum. |       |\n";
+			cerr << "  Iter |       Objective      |    Problem   |       Pool      | Fixed  |                  Time                  | Frac. |\n";
+			cerr << "       |    frac.     rounded |   size  diff | size gen. dupl. |        |    fix       gen     solve   tot. cum. |       |\n";
 			// clang-format on
 		}
 
@@ -387,6 +397,7 @@ double Problem::solve() {
 		log_entry.set_active_size_change(active_size_change);
 		log_entry.set_pool_size(pool.allowed_size());
 		log_entry.set_pool_size_change(generated_columns);
+		log_entry.set_duplicate_columns(duplicate_columns);
 		log_entry.set_fixed_columns(fixed_columns);
 		log_entry.set_cumulative_time(wall_time() - global_start_time);
 
@@ -397,6 +408,7 @@ double Problem::solve() {
 		     << to_string(setw(4), right, log_entry.active_size_change()) << " "
 		     << to_string(setw(7), right, log_entry.pool_size()) << " "
 		     << to_string(setw(4), right, log_entry.pool_size_change()) << " "
+		     << to_string(setw(5), right, log_entry.duplicate_columns()) << " "
 		     << to_string(setw(6), right, log_entry.fixed_columns()) << " "
 		     << to_string(setw(11), right, setprecision(1), scientific, fix_time) << " "
 		     << to_string(setw(9), right, setprecision(2), scientific, generate_time) << " "
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+using namespace std;
+
+#include <coin/OsiClpSolverInterface.hpp>
+
+#include <minimum/core/check.h>
+#include <minimum/core/flamegraph.h>
+#include <minimum/core/range.h>
+#include <minimum/linear/colgen/restricted_master_problem.h>
+#include <minimum/linear/first_order_solver.h>
+using namespace minimum::core;
+
+namespace minimum {
+namespace linear {
+namespace colgen {
+
+class RestrictedMasterProblem::Implementation {
+   public:
+	Implementation(ColumnPool& pool_, const vector<double>& row_lb_, const vector<double>& row_ub_)
+	    : pool(pool_), row_lb(row_lb_), row_ub(row_ub_) {
+		check(row_lb.size() == row_ub.size(), "Row bounds need to have the same size.");
+	}
+
+	ColumnPool& pool;
+	const vector<double>& row_lb;
+	const vector<double>& row_ub;
+
+	// Pool indices of the columns in the problem, in problem order.
+	vector<size_t> columns;
+	// The problem index of every pool column, or -1 if not in the problem.
+	vector<int> problem_index;
+
+	// The constraint matrix in compressed column format.
+	vector<int> column_start = {0};
+	vector<int> row_index;
+	vector<double> values;
+	// Cost and bounds of the columns as they were last given to the solver.
+	vector<double> cost;
+	vector<double> column_lb;
+	vector<double> column_ub;
+
+	// Row bounds as they were last given to Clp.
+	vector<double> clp_row_lb;
+	vector<double> clp_row_ub;
+	unique_ptr<OsiClpSolverInterface> clp;
+	bool clp_has_solution = false;
+
+	// Storage for the first-order solver.
+	Matrix A;
+
+	int number_of_rows() const { return static_cast<int>(row_lb.size()); }
+
+	void append_column(size_t i) {
+		const auto& column = pool.at(i);
+		problem_index.at(i) = static_cast<int>(columns.size());
+		columns.push_back(i);
+		for (auto& entry : column) {
+			row_index.push_back(entry.row);
+			values.push_back(entry.coef);
+		}
+		column_start.push_back(static_cast<int>(row_index.size()));
+		cost.push_back(column.cost());
+		column_lb.push_back(column.lower_bound());
+		column_ub.push_back(column.upper_bound());
+	}
+
+	// Removes the columns with the given (sorted) problem indices.
+	void remove_columns(const vector<int>& to_remove) {
+		size_t next_remove = 0;
+		int new_j = 0;
+		int new_entry = 0;
+		for (auto j : range(int(columns.size()))) {
+			if (next_remove < to_remove.size() && to_remove[next_remove] == j) {
+				problem_index[columns[j]] = -1;
+				next_remove++;
+				continue;
+			}
+			int start = column_start[j];
+			int end = column_start[j + 1];
+			column_start[new_j] = new_entry;
+			for (int k = start; k < end; ++k) {
+				row_index[new_entry] = row_index[k];
+				values[new_entry] = values[k];
+				new_entry++;
+			}
+			columns[new_j] = columns[j];
+			problem_index[columns[j]] = new_j;
+			cost[new_j] = cost[j];
+			column_lb[new_j] = column_lb[j];
+			column_ub[new_j] = column_ub[j];
+			new_j++;
+		}
+		column_start[new_j] = new_entry;
+		column_start.resize(new_j + 1);
+		row_index.resize(new_entry);
+		values.resize(new_entry);
+		columns.resize(new_j);
+		cost.resize(new_j);
+		column_lb.resize(new_j);
+		column_ub.resize(new_j);
+	}
+
+	// Makes the cached bounds agree with the pool. Returns the problem indices
+	// of the columns that changed.
+	vector<int> update_bounds() {
+		vector<int> changed;
+		for (auto j : range(int(columns.size()))) {
+			const auto& column = pool.at(columns[j]);
+			check(column.lower_bound() >= 0, "Columns can not be allowed to be negative.");
+			if (column.lower_bound() != column_lb[j] || column.upper_bound() != column_ub[j]) {
+				column_lb[j] = column.lower_bound();
+				column_ub[j] = column.upper_bound();
+				changed.push_back(j);
+			}
+		}
+		return changed;
+	}
+
+	void create_clp() {
+		clp = make_unique<OsiClpSolverInterface>();
+		clp->messageHandler()->setLogLevel(0);
+		// Columns are added between solves, so the previous basis is
+		// primal feasible but not dual feasible.
+		clp->setHintParam(OsiDoDualInResolve, false, OsiHintDo);
+		clp_row_lb = row_lb;
+		clp_row_ub = row_ub;
+		clp->loadProblem(int(columns.size()),
+		                 number_of_rows(),
+		                 column_start.data(),
+		                 row_index.data(),
+		                 values.data(),
+		                 column_lb.data(),
+		                 column_ub.data(),
+		                 cost.data(),
+		                 clp_row_lb.data(),
+		                 clp_row_ub.data());
+		clp_has_solution = false;
+	}
+
+	void set_solution(const double* x) {
+		for (auto j : range(columns.size())) {
+			auto& column = pool.at(columns[j]);
+			column.solution_value = min(column.upper_bound(), max(column.lower_bound(), x[j]));
+		}
+	}
+
+	double objective() const {
+		double objective = 0;
+		for (auto j : range(columns.size())) {
+			objective += cost[j] * pool.at(columns[j]).solution_value;
+		}
+		return objective;
+	}
+};
+
+RestrictedMasterProblem::RestrictedMasterProblem(ColumnPool& pool,
+                                                 const std::vector<double>& row_lb,
+                                                 const std::vector<double>& row_ub)
+    : impl(new Implementation(pool, row_lb, row_ub)) {}
+
+RestrictedMasterProblem::~RestrictedMasterProblem() { delete impl; }
+
+size_t RestrictedMasterProblem::size() const { return impl->columns.size(); }
+
+void RestrictedMasterProblem::set_columns(const std::vector<std::size_t>& new_columns) {
+	FLAMEGRAPH_LOG_FUNCTION;
+	impl->problem_index.resize(impl->pool.size(), -1);
+
+	vector<char> wanted(impl->pool.size(), 0);
+	for (auto i : new_columns) {
+		wanted.at(i) = 1;
+	}
+
+	vector<int> to_remove;
+	for (auto j : range(int(impl->columns.size()))) {
+		if (!wanted[impl->columns[j]]) {
+			to_remove.push_back(j);
+		}
+	}
+	if (!to_remove.empty()) {
+		impl->remove_columns(to_remove);
+		if (impl->clp) {
+			impl->clp->deleteCols(int(to_remove.size()), to_remove.data());
+		}
+	}
+
+	auto first_new = impl->columns.size();
+	for (auto i : new_columns) {
+		if (impl->problem_index[i] < 0) {
+			impl->append_column(i);
+		}
+	}
+	auto added = impl->columns.size() - first_new;
+	if (added > 0 && impl->clp) {
+		// Column starts relative to the first added column.
+		vector<int> starts(impl->column_start.begin() + first_new, impl->column_start.end());
+		int offset = starts[0];
+		for (auto& start : starts) {
+			start -= offset;
+		}
+		impl->clp->addCols(int(added),
+		                   starts.data(),
+		                   impl->row_index.data() + offset,
+		                   impl->values.data() + offset,
+		                   impl->column_lb.data() + first_new,
+		                   impl->column_ub.data() + first_new,
+		                   impl->cost.data() + first_new);
+	}
+}
+
+double RestrictedMasterProblem::solve_simplex(std::vector<double>* dual_solution) {
+	FLAMEGRAPH_LOG_FUNCTION;
+	auto changed = impl->update_bounds();
+
+	if (!impl->clp) {
+		impl->create_clp();
+	} else {
+		for (auto j : changed) {
+			impl->clp->setColBounds(j, impl->column_lb[j], impl->column_ub[j]);
+		}
+		for (auto i : range(impl->number_of_rows())) {
+			if (impl->row_lb[i] != impl->clp_row_lb[i] || impl->row_ub[i] != impl->clp_row_ub[i]) {
+				impl->clp_row_lb[i] = impl->row_lb[i];
+				impl->clp_row_ub[i] = impl->row_ub[i];
+				impl->clp->setRowBounds(i, impl->row_lb[i], impl->row_ub[i]);
+			}
+		}
+	}
+
+	if (impl->clp_has_solution) {
+		impl->clp->resolve();
+	} else {
+		impl->clp->initialSolve();
+	}
+
+	if (!impl->clp->isProvenOptimal()) {
+		// Start from scratch next time.
+		impl->clp_has_solution = false;
+		return numeric_limits<double>::quiet_NaN();
+	}
+	impl->clp_has_solution = true;
+
+	impl->set_solution(impl->clp->getColSolution());
+	dual_solution->resize(impl->number_of_rows());
+	const double* row_price = impl->clp->getRowPrice();
+	for (auto i : range(impl->number_of_rows())) {
+		(*dual_solution)[i] = row_price[i];
+	}
+	return impl->objective();
+}
+
+double RestrictedMasterProblem::solve_first_order(const FirstOrderOptions& options,
+                                                  std::vector<double>* dual_solution) {
+	using namespace Eigen;
+	FLAMEGRAPH_LOG_FUNCTION;
+	impl->update_bounds();
+
+	const auto n = impl->columns.size();
+	const auto m = impl->number_of_rows();
+
+	// The compressed column storage is converted to the row-major format of
+	// the solver without sorting.
+	Map<const SparseMatrix<double, ColMajor, int>> A_columns(m,
+	                                                         n,
+	                                                         impl->row_index.size(),
+	                                                         impl->column_start.data(),
+	                                                         impl->row_index.data(),
+	                                                         impl->values.data());
+	impl->A = A_columns;
+
+	// An extra column fixed to zero with a one in every row is appended,
+	// just like in the IP used by the other solvers. It does not change
+	// the LP, but it is part of the diagonal preconditioning of the
+	// solver and keeps empty rows from getting infinite step sizes.
+	impl->A.conservativeResize(m, n + 1);
+	impl->A.reserve(VectorXi::Constant(m, 1));
+	for (auto i : range(m)) {
+		impl->A.insert(i, n) = 1.0;
+	}
+	impl->A.makeCompressed();
+
+	VectorXd c(n + 1);
+	VectorXd lb(n + 1);
+	VectorXd ub(n + 1);
+	VectorXd x(n + 1);
+	for (auto j : range(n)) {
+		c[j] = impl->cost[j];
+		lb[j] = impl->column_lb[j];
+		ub[j] = impl->column_ub[j];
+		x[j] = impl->pool.at(impl->columns[j]).solution_value;
+	}
+	c[n] = 0;
+	lb[n] = 0;
+	ub[n] = 0;
+	x[n] = 0;
+
+	VectorXd b(m);
+	VectorXd y(m);
+	vector<LinearConstraintType> constraint_types(m);
+	dual_solution->resize(m, 0);
+	for (auto i : range(m)) {
+		auto lb = impl->row_lb[i];
+		auto ub = impl->row_ub[i];
+		if (lb == ub) {
+			b[i] = lb;
+			constraint_types[i] = LinearConstraintType::Equality;
+		} else if (ub < 1e100) {
+			check(lb <= -1e100, "Rows with both lower and upper bounds are not supported.");
+			b[i] = ub;
+			constraint_types[i] = LinearConstraintType::LessThan;
+		} else {
+			check(lb > -1e100, "Rows need to have a bound.");
+			b[i] = lb;
+			constraint_types[i] = LinearConstraintType::GreaterThan;
+		}
+		// Negative sign for the duals in order to match the linear programming
+		// duals.
+		y[i] = -(*dual_solution)[i];
+	}
+
+	first_order_primal_dual_solve(&x, &y, c, lb, ub, impl->A, b, constraint_types, options);
+
+	impl->set_solution(x.data());
+	for (auto i : range(m)) {
+		(*dual_solution)[i] = -y[i];
+	}
+	return impl->objective();
+}
+}  // namespace colgen
+}  // namespace linear
+}  // namespace minimum
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+
+#include <minimum/linear/colgen/column_pool.h>
+#include <minimum/linear/colgen/export.h>
+
+namespace minimum {
+namespace linear {
+struct FirstOrderOptions;
+namespace colgen {
+
+// The linear program over the active columns that is solved in every column
+// generation iteration.
+//
+// The problem is kept between iterations. Only changes to the set of active
+// columns and to their bounds are applied before solving, and the LP solver is
+// warm-started from the previous solution (the basis for Clp and the primal and
+// dual variables for the first-order solver).
+class MINIMUM_LINEAR_COLGEN_API RestrictedMasterProblem {
+   public:
+	// The row bounds are referenced and may change between solves.
+	RestrictedMasterProblem(ColumnPool& pool,
+	                        const std::vector<double>& row_lb,
+	                        const std::vector<double>& row_ub);
+	RestrictedMasterProblem(const RestrictedMasterProblem&) = delete;
+	~RestrictedMasterProblem();
+
+	// Makes the problem contain exactly the given columns of the pool.
+	// Columns already in the problem are kept and new ones are appended.
+	void set_columns(const std::vector<std::size_t>& columns);
+
+	// Number of columns currently in the problem.
+	std::size_t size() const;
+
+	// Solves the problem with simplex (Clp). Sets the solution_value of every
+	// column in the problem and writes the dual variables of the rows to
+	// dual_solution.
+	//
+	// Returns the objective value or NaN if the problem could not be solved.
+	double solve_simplex(std::vector<double>* dual_solution);
+
+	// As solve_simplex, but uses first_order_primal_dual_solve. The current
+	// solution values of the columns and dual_solution are used as the
+	// starting point.
+	double solve_first_order(const FirstOrderOptions& options,
+	                         std::vector<double>* dual_solution);
+
+   private:
+	class Implementation;
+	Implementation* impl;
+};
+}  // namespace colgen
+}  // namespace linear
+}  // namespace minimum
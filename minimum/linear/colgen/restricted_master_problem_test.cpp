@@ -0,0 +1,79 @@
+#include <cmath>
+#include <vector>
+using namespace std;
+
+#include <catch.hpp>
+
+#include <minimum/linear/colgen/restricted_master_problem.h>
+#include <minimum/linear/first_order_solver.h>
+using namespace minimum::linear;
+using namespace minimum::linear::colgen;
+
+namespace {
+// Covering problem: each of the four rows needs to be covered at least once.
+void create_pool(ColumnPool* pool) {
+	vector<vector<int>> rows = {{0, 1}, {2, 3}, {0, 2}, {1, 3}, {0}, {1}, {2}, {3}};
+	vector<double> costs = {3, 3, 1, 1, 2, 2, 2, 2};
+	for (size_t i = 0; i < rows.size(); ++i) {
+		Column column(costs[i], 0, 1);
+		for (auto row : rows[i]) {
+			column.add_coefficient(row, 1);
+		}
+		pool->add(move(column));
+	}
+}
+}  // namespace
+
+TEST_CASE("simplex_updates") {
+	ColumnPool pool;
+	create_pool(&pool);
+	vector<double> row_lb(4, 1);
+	vector<double> row_ub(4, 1e100);
+	RestrictedMasterProblem rmp(pool, row_lb, row_ub);
+	vector<double> dual;
+
+	rmp.set_columns({4, 5, 6, 7});
+	CHECK(rmp.solve_simplex(&dual) == Approx(8));
+	REQUIRE(dual.size() == 4);
+	CHECK(dual[0] == Approx(2));
+
+	// Appending columns warm-starts from the previous basis.
+	rmp.set_columns({0, 1, 4, 5, 6, 7});
+	CHECK(rmp.size() == 6);
+	CHECK(rmp.solve_simplex(&dual) == Approx(6));
+
+	rmp.set_columns({2, 3, 4, 5, 6, 7});
+	CHECK(rmp.size() == 6);
+	CHECK(rmp.solve_simplex(&dual) == Approx(2));
+	CHECK(pool.at(2).solution_value == Approx(1));
+	CHECK(pool.at(3).solution_value == Approx(1));
+
+	// Bound changes in the pool are picked up.
+	pool.at(2).fix(0);
+	CHECK(rmp.solve_simplex(&dual) == Approx(5));
+	pool.at(2).unfix();
+	CHECK(rmp.solve_simplex(&dual) == Approx(2));
+
+	// Row bound changes are picked up.
+	row_lb[0] = 2;
+	CHECK(rmp.solve_simplex(&dual) == Approx(4));
+}
+
+TEST_CASE("first_order") {
+	ColumnPool pool;
+	create_pool(&pool);
+	vector<double> row_lb(4, 1);
+	vector<double> row_ub(4, 1e100);
+	RestrictedMasterProblem rmp(pool, row_lb, row_ub);
+	vector<double> dual(4, 0);
+
+	FirstOrderOptions options;
+	options.maximum_iterations = 100'000;
+	options.tolerance = 1e-9;
+
+	rmp.set_columns({0, 1, 4, 5, 6, 7});
+	CHECK(rmp.solve_first_order(options, &dual) == Approx(6).epsilon(1e-4));
+
+	rmp.set_columns({2, 3, 4, 5, 6, 7});
+	CHECK(rmp.solve_first_order(options, &dual) == Approx(2).epsilon(1e-4));
+}
@@ -343,13 +343,16 @@ bool create_roster_graph(const RetailProblem& problem,
 	GraphBuilder builder(problem);
 	auto dag = builder.build(duals, staff_index, fixes, rng);
 
+	// The memory for the shortest path problems is kept between calls.
+	thread_local minimum::algorithms::ResourceConstrainedShortestPathWorkspace<double> workspace;
 	vector<int> graph_solution;
 	bool feasible = false;
 	for (int attempts = 1; attempts <= 10; ++attempts) {
 		resource_constrained_shortest_path(dag,
 		                                   problem.staff.at(staff_index).min_minutes / 15,
 		                                   problem.staff.at(staff_index).max_minutes / 15,
-		                                   &graph_solution);
+		                                   &graph_solution,
+		                                   &workspace);
 		feasible = true;
 
 		//
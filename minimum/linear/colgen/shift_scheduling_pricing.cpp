@@ -1,4 +1,5 @@
 #include <fstream>
+#include <memory>
 #include <random>
 #include <vector>
 using namespace std;
@@ -203,13 +204,15 @@ class ScheduleGraphBuilder {
 	vector<int> day_off_node;
 };
 
-bool create_roster_cspp(const minimum::linear::proto::SchedulingProblem& problem,
-                        const vector<double>& dual_variables,
-                        int p,
-                        const vector<vector<int>>& fixes,
-                        vector<vector<int>>* solution_for_staff,
-                        std::mt19937_64* rng,
-                        const std::string& graph_output_file_name) {
+namespace {
+// Builds the graph for staff member p. Everything except the node costs
+// depends only on the problem and the fixes, so the graph can be reused as
+// long as the fixes stay the same.
+ScheduleGraph build_roster_graph(const minimum::linear::proto::SchedulingProblem& problem,
+                                 int p,
+                                 const vector<vector<int>>& fixes,
+                                 int* time_limit_min,
+                                 int* time_limit_max) {
 	auto& staff = problem.worker(p);
 
 	ScheduleGraphBuilder graph_builder(problem);
@@ -257,32 +260,6 @@ bool create_roster_cspp(const minimum::linear::proto::SchedulingProblem& problem
 		}
 	}
 
-	// Cover costs from dual variables.
-	int r = problem.worker_size();
-	for (const auto& requirement : problem.requirement()) {
-		auto i = graph.node(requirement.day(), requirement.shift());
-		if (i >= 0) {
-			graph.dag.set_node_cost(i, -dual_variables.at(r));
-		}
-		++r;
-	}
-
-	// Shift preferences.
-	for (const auto& pref : staff.shift_preference()) {
-		auto i = graph.node(pref.day(), pref.shift());
-		if (i >= 0) {
-			graph.dag.change_node_cost(i, pref.cost());
-		}
-	}
-
-	// Day-off preferences.
-	for (const auto& pref : staff.day_off_preference()) {
-		auto i = graph.day_off_node(pref.day());
-		if (i >= 0) {
-			graph.dag.change_node_cost(i, pref.cost());
-		}
-	}
-
 	// Connect source and sink.
 	graph.dag.add_edge(graph.source_node(), graph.day_off_node(0));
 	graph.dag.add_edge(graph.day_off_node(problem.num_days() - 1), graph.sink_node());
@@ -368,11 +345,110 @@ bool create_roster_cspp(const minimum::linear::proto::SchedulingProblem& problem
 
 	minimum_core_assert(staff.has_time_limit(),
 	                    "This code currently assumes this limit to be set.");
-	int time_limit_min = staff.time_limit().min();
-	int time_limit_max = staff.time_limit().max();
-	graph.optimize_time_limit(fixes, &time_limit_min, &time_limit_max);
+	*time_limit_min = staff.time_limit().min();
+	*time_limit_max = staff.time_limit().max();
+	graph.optimize_time_limit(fixes, time_limit_min, time_limit_max);
 
 	graph.optimize_size();
+	return graph;
+}
+
+// Sets all node costs of the graph from the dual variables and the
+// preferences of staff member p.
+void set_roster_costs(const minimum::linear::proto::SchedulingProblem& problem,
+                      const vector<double>& dual_variables,
+                      int p,
+                      ScheduleGraph* graph_ptr) {
+	auto& graph = *graph_ptr;
+	auto& staff = problem.worker(p);
+	for (auto i : range(graph.dag.size())) {
+		graph.dag.set_node_cost(i, 0);
+	}
+
+	// Cover costs from dual variables.
+	int r = problem.worker_size();
+	for (const auto& requirement : problem.requirement()) {
+		auto i = graph.node(requirement.day(), requirement.shift());
+		if (i >= 0) {
+			graph.dag.set_node_cost(i, -dual_variables.at(r));
+		}
+		++r;
+	}
+
+	// Shift preferences.
+	for (const auto& pref : staff.shift_preference()) {
+		auto i = graph.node(pref.day(), pref.shift());
+		if (i >= 0) {
+			graph.dag.change_node_cost(i, pref.cost());
+		}
+	}
+
+	// Day-off preferences.
+	for (const auto& pref : staff.day_off_preference()) {
+		auto i = graph.day_off_node(pref.day());
+		if (i >= 0) {
+			graph.dag.change_node_cost(i, pref.cost());
+		}
+	}
+}
+}  // namespace
+
+class RosterGraphCache::Implementation {
+   public:
+	const minimum::linear::proto::SchedulingProblem* problem = nullptr;
+	int p = -1;
+	vector<vector<int>> fixes;
+	unique_ptr<ScheduleGraph> graph;
+	int time_limit_min = 0;
+	int time_limit_max = 0;
+	int graphs_built = 0;
+};
+
+RosterGraphCache::RosterGraphCache() : impl(new Implementation) {}
+
+RosterGraphCache::RosterGraphCache(RosterGraphCache&& other) noexcept : impl(other.impl) {
+	other.impl = nullptr;
+}
+
+RosterGraphCache::~RosterGraphCache() { delete impl; }
+
+int RosterGraphCache::graphs_built() const { return impl->graphs_built; }
+
+bool create_roster_cspp(const minimum::linear::proto::SchedulingProblem& problem,
+                        const vector<double>& dual_variables,
+                        int p,
+                        const vector<vector<int>>& fixes,
+                        vector<vector<int>>* solution_for_staff,
+                        std::mt19937_64* rng,
+                        const std::string& graph_output_file_name,
+                        RosterGraphCache* cache) {
+	auto& staff = problem.worker(p);
+
+	unique_ptr<ScheduleGraph> uncached_graph;
+	ScheduleGraph* graph_ptr = nullptr;
+	int time_limit_min = 0;
+	int time_limit_max = 0;
+	if (cache != nullptr) {
+		auto& cached = *cache->impl;
+		if (!cached.graph || cached.problem != &problem || cached.p != p
+		    || cached.fixes != fixes) {
+			cached.graph = make_unique<ScheduleGraph>(build_roster_graph(
+			    problem, p, fixes, &cached.time_limit_min, &cached.time_limit_max));
+			cached.problem = &problem;
+			cached.p = p;
+			cached.fixes = fixes;
+			cached.graphs_built++;
+		}
+		graph_ptr = cached.graph.get();
+		time_limit_min = cached.time_limit_min;
+		time_limit_max = cached.time_limit_max;
+	} else {
+		uncached_graph = make_unique<ScheduleGraph>(
+		    build_roster_graph(problem, p, fixes, &time_limit_min, &time_limit_max));
+		graph_ptr = uncached_graph.get();
+	}
+	auto& graph = *graph_ptr;
+	set_roster_costs(problem, dual_variables, p, &graph);
 
 	if (!graph_output_file_name.empty()) {
 		ofstream fout(graph_output_file_name);
@@ -381,6 +457,8 @@ bool create_roster_cspp(const minimum::linear::proto::SchedulingProblem& problem
 
 	// The shortest path problem does not model everything. Solve it and iterate
 	// until feasible.
+	// The memory for the shortest path problems is kept between calls.
+	thread_local minimum::algorithms::ResourceConstrainedShortestPathWorkspace<double> workspace;
 	vector<int> solution;
 	bool is_feasible = false;
 	std::uniform_int_distribution<int> coin(0, 1);
@@ -395,7 +473,8 @@ bool create_roster_cspp(const minimum::linear::proto::SchedulingProblem& problem
 		    time_limit_max,
 		    staff.consecutive_shifts_limit().min(),
 		    staff.consecutive_shifts_limit().max(),
-		    &solution);
+		    &solution,
+		    &workspace);
 		minimum_core_assert(!solution.empty());
 
 		for (auto d : range(problem.num_days())) {
@@ -9,6 +9,35 @@
 namespace minimum {
 namespace linear {
 namespace colgen {
+
+// Keeps the pricing graph of one staff member between calls to
+// create_roster_cspp. Only the node costs are updated when the dual
+// variables change; the graph is rebuilt when the fixes change. The
+// problem must not be modified while the cache is in use.
+class MINIMUM_LINEAR_COLGEN_API RosterGraphCache {
+   public:
+	RosterGraphCache();
+	RosterGraphCache(RosterGraphCache&&) noexcept;
+	RosterGraphCache(const RosterGraphCache&) = delete;
+	~RosterGraphCache();
+
+	// Number of times the graph has been built.
+	int graphs_built() const;
+
+   private:
+	friend MINIMUM_LINEAR_COLGEN_API bool create_roster_cspp(
+	    const minimum::linear::proto::SchedulingProblem&,
+	    const std::vector<double>&,
+	    int,
+	    const std::vector<std::vector<int>>&,
+	    std::vector<std::vector<int>>*,
+	    std::mt19937_64*,
+	    const std::string&,
+	    RosterGraphCache*);
+	class Implementation;
+	Implementation* impl;
+};
+
 MINIMUM_LINEAR_COLGEN_API bool create_roster_cspp(
     const minimum::linear::proto::SchedulingProblem& problem,
     const std::vector<double>& dual_variables,
@@ -16,7 +45,8 @@ MINIMUM_LINEAR_COLGEN_API bool create_roster_cspp(
     const std::vector<std::vector<int>>& fixes,
     std::vector<std::vector<int>>* solution_for_staff,
     std::mt19937_64* rng,
-    const std::string& graph_output_file_name = "");
+    const std::string& graph_output_file_name = "",
+    RosterGraphCache* cache = nullptr);
 }
 }  // namespace linear
 }  // namespace minimum
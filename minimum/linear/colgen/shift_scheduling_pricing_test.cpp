@@ -175,3 +175,32 @@ TEST_CASE("shift_limit") {
 	}
 	CHECK(assigned == 5);
 }
+
+TEST_CASE("cached_graph") {
+	auto problem = basic_problem();
+	problem.mutable_worker(0)->mutable_working_weekends_limit()->set_max(1);
+	problem.mutable_worker(0)->mutable_shift_limit(0)->set_max(8);
+	auto fixes = make_grid<int>(problem.num_days(), 1, []() { return -1; });
+	auto solution = make_grid<int>(problem.num_days(), 1);
+	auto cached_solution = make_grid<int>(problem.num_days(), 1);
+	vector<double> duals(problem.worker_size() + problem.num_days(), 0);
+
+	RosterGraphCache cache;
+	std::mt19937_64 dual_engine(0);
+	std::uniform_real_distribution<double> dual(-1, 3);
+	for (int iteration = 0; iteration < 20; ++iteration) {
+		CAPTURE(iteration);
+		for (auto& d : duals) {
+			d = dual(dual_engine);
+		}
+		if (iteration == 10) {
+			fixes[3][0] = 1;
+			fixes[4][0] = 0;
+		}
+		REQUIRE(create_roster_cspp(problem, duals, 0, fixes, &solution, &rng));
+		REQUIRE(create_roster_cspp(problem, duals, 0, fixes, &cached_solution, &rng, "", &cache));
+		CHECK(cached_solution == solution);
+	}
+	// Built once before and once after the fixes changed.
+	CHECK(cache.graphs_built() == 2);
+}
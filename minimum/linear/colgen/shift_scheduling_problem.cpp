@@ -122,6 +122,7 @@ ShiftShedulingColgenProblem::ShiftShedulingColgenProblem(
 
 	for (auto i : range(problem.worker_size())) {
 		random_engines.emplace_back(repeatably_seeded_engine<std::mt19937_64>(i));
+		roster_graphs.emplace_back();
 	}
 
 	timer.OK();
@@ -145,8 +146,14 @@ ShiftShedulingColgenProblem::ShiftShedulingColgenProblem(
 #pragma omp parallel for
 	for (int p = 0; p < problem.worker_size(); ++p) {
 		try {
-			minimum_core_assert(create_roster_cspp(
-			    problem, initial_duals[p], p, no_fixes, &solution[p], &random_engines[p]));
+			minimum_core_assert(create_roster_cspp(problem,
+			                                       initial_duals[p],
+			                                       p,
+			                                       no_fixes,
+			                                       &solution[p],
+			                                       &random_engines[p],
+			                                       "",
+			                                       &roster_graphs[p]));
 
 		} catch (...) {
 			exception_store.store();
@@ -190,8 +197,14 @@ bool ShiftShedulingColgenProblem::generate_for_staff(
 		graph_file_name = file_name_itr->second;
 	}
 
-	return create_roster_cspp(
-	    problem, dual_variables, p, fixes, solution_for_staff, &random_engines[p], graph_file_name);
+	return create_roster_cspp(problem,
+	                          dual_variables,
+	                          p,
+	                          fixes,
+	                          solution_for_staff,
+	                          &random_engines[p],
+	                          graph_file_name,
+	                          &roster_graphs[p]);
 }
 
 double ShiftShedulingColgenProblem::integral_solution_value() {
@@ -7,6 +7,7 @@
 #include <minimum/linear/colgen/column.h>
 #include <minimum/linear/colgen/export.h>
 #include <minimum/linear/colgen/set_partitioning_problem.h>
+#include <minimum/linear/colgen/shift_scheduling_pricing.h>
 #include <minimum/linear/proto.h>
 
 DECLARE_string(pool_file_name);
@@ -69,6 +70,8 @@ class MINIMUM_LINEAR_COLGEN_API ShiftShedulingColgenProblem : public SetPartitio
 	std::vector<std::vector<std::vector<int>>> solution;
 
 	mutable std::vector<std::mt19937_64> random_engines;
+	// The pricing graph of every staff member.
+	mutable std::vector<RosterGraphCache> roster_graphs;
 
 	std::vector<std::vector<int>> day_shift_to_constraint;
 
@@ -9,23 +9,34 @@
 //     order primal-dual algorithms in convex optimization. In Computer Vision (ICCV),
 //     2011 IEEE International Conference on (pp. 1762-1769). IEEE.
 //
+// [3] Applegate, D., Díaz, M., Hinder, O., Lu, H., Lubin, M., O'Donoghue, B., &
+//     Schudy, W. (2021). Practical large-scale linear programming using primal-dual
+//     hybrid gradient. Advances in Neural Information Processing Systems, 34.
+//
 
 #include <cstdio>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <random>
 #include <string>
+#include <type_traits>
 
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include <minimum/core/check.h>
 #include <minimum/core/range.h>
 #include <minimum/core/string.h>
 #include <minimum/core/time.h>
 #include <minimum/linear/first_order_solver.h>
+using minimum::core::check;
 using minimum::core::range;
 using minimum::core::to_string;
 using minimum::core::to_string_with_separator;
@@ -87,6 +98,69 @@ double get_feasibility_error(const Eigen::VectorXd& x,
 	return feasibility_error / denominator;
 }
 
+struct ConvergenceInfo {
+	double objective = 0;
+	double relative_change_x = 0;
+	double relative_change_y = 0;
+	double feasibility_error = 0;
+};
+
+double get_relative_change(std::ptrdiff_t iteration,
+                           double change_norm,
+                           double norm,
+                           double prev_norm) {
+	double relative_change;
+	if (iteration <= 0) {
+		relative_change = std::numeric_limits<double>::quiet_NaN();
+	} else {
+		relative_change = change_norm / (norm + prev_norm);
+		if (relative_change != relative_change) {
+			// Both x and x_prev were null vectors.
+			relative_change = 0;
+		}
+	}
+	return relative_change;
+}
+
+double get_relative_change(std::ptrdiff_t iteration,
+                           const Eigen::VectorXd& x,
+                           const Eigen::VectorXd& x_prev) {
+	if (iteration <= 0) {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	return get_relative_change(iteration, (x - x_prev).norm(), x.norm(), x_prev.norm());
+}
+
+bool is_converged(const ConvergenceInfo& info, bool objective_is_zero, double tolerance) {
+	if (objective_is_zero && info.feasibility_error < 100 * tolerance) {
+		// If there is no objective function, only feasibility is important.
+		return true;
+	}
+	return info.relative_change_x < tolerance && info.relative_change_y < tolerance;
+}
+
+void log_iteration(std::ptrdiff_t iteration,
+                   const ConvergenceInfo& info,
+                   const FirstOrderOptions& options,
+                   double start_time) {
+	using namespace std;
+	double elapsed_time = wall_time() - start_time;
+
+	ostringstream message;
+	message << setw(9);
+	if (iteration == -1) {
+		message << "end";
+	} else {
+		message << iteration;
+	}
+	message << "   " << setw(15) << setprecision(6) << scientific << info.objective << " "
+	        << setw(12) << setprecision(3) << scientific << info.relative_change_x << " "
+	        << setw(12) << setprecision(3) << scientific << info.relative_change_y << " "
+	        << setw(15) << setprecision(6) << scientific << info.feasibility_error << " "
+	        << setw(8) << setprecision(1) << scientific << elapsed_time;
+	options.log_function(message.str());
+}
+
 // Will use x_prev as a temporary storage after
 // examining it.
 bool check_convergence_and_log(std::ptrdiff_t iteration,
@@ -101,72 +175,413 @@ bool check_convergence_and_log(std::ptrdiff_t iteration,
                                const Eigen::VectorXd& b,
                                const std::vector<LinearConstraintType>& constraint_types,
                                const FirstOrderOptions& options,
-                               double start_time) {
-	using namespace Eigen;
-	using namespace std;
+                               double start_time,
+                               bool should_log = true) {
+	ConvergenceInfo info;
+	info.objective = c.dot(x);
+	info.relative_change_x = get_relative_change(iteration, x, *x_prev);
+	info.relative_change_y = get_relative_change(iteration, y, y_prev);
+	info.feasibility_error = get_feasibility_error(x, x_prev, lb, ub, A, b, constraint_types);
+
+	if (options.log_function && should_log) {
+		log_iteration(iteration, info, options, start_time);
+	}
 
-	bool is_converged = false;
+	return is_converged(info, c.isZero(1e-30), options.tolerance);
+}
 
-	// cerr << "x      = " << (*x).transpose() << endl;
-	// cerr << "Ax     = " << (A*(*x)).transpose() << endl;
-	// cerr << "Ax - b = " << (A*(*x) - b).transpose() << endl;
+namespace {
+// Splits the rows of A into parts with roughly the same number of non-zeros.
+template <typename SparseMatrix>
+std::vector<std::ptrdiff_t> partition_rows(const SparseMatrix& A, int parts) {
+	std::vector<std::ptrdiff_t> partition(parts + 1, A.rows());
+	partition[0] = 0;
+	const double nnz = A.nonZeros();
+	double row_start_nnz = 0;
+	int part = 1;
+	for (std::ptrdiff_t i = 0; i < A.rows() && part < parts; ++i) {
+		for (typename SparseMatrix::InnerIterator it(A, i); it; ++it) {
+			row_start_nnz++;
+		}
+		while (part < parts && row_start_nnz >= part * nnz / parts) {
+			partition[part++] = i + 1;
+		}
+	}
+	return partition;
+}
+
+// Sums over the variables of one iteration, computed by PrimalDualKernel in
+// the same passes as the iteration itself. The norms are of the unscaled
+// variables.
+struct IterationStatistics {
+	double x_change2 = 0;
+	double x_norm2 = 0;
+	double x_prev_norm2 = 0;
+	double x_max = 0;
+	double y_change2 = 0;
+	double y_norm2 = 0;
+	double y_prev_norm2 = 0;
+	double infeasibility = 0;
+	// c·x, in the scaling of the kernel.
+	double objective = 0;
+
+	void add(const IterationStatistics& other) {
+		x_change2 += other.x_change2;
+		x_norm2 += other.x_norm2;
+		x_prev_norm2 += other.x_prev_norm2;
+		x_max = std::max(x_max, other.x_max);
+		y_change2 += other.y_change2;
+		y_norm2 += other.y_norm2;
+		y_prev_norm2 += other.y_prev_norm2;
+		infeasibility = std::max(infeasibility, other.infeasibility);
+		objective += other.objective;
+	}
+};
 
-	auto get_relative_change = [iteration](const Eigen::VectorXd& x,
-	                                       const Eigen::VectorXd& x_prev) -> double {
-		double relative_change;
-		if (iteration <= 0) {
-			relative_change = std::numeric_limits<double>::quiet_NaN();
+// Performs the iterations of eq. (18) from [2] with one pass over the rows of
+// A^T (the primal update) and one pass over the rows of A (the dual update).
+// Both passes are partitioned between threads by the number of non-zeros.
+//
+// The kernel keeps A*x up to date from the products with 2 * x - x_prev that
+// the dual update needs anyway, so the convergence statistics do not require
+// any additional matrix-vector products.
+class PrimalDualKernel {
+   public:
+	virtual ~PrimalDualKernel() = default;
+
+	// The statistics are computed for x * column_scale and y * row_scale.
+	// The scale vectors are referenced.
+	virtual void set_scaling(const Eigen::VectorXd* row_scale,
+	                         const Eigen::VectorXd* column_scale) = 0;
+
+	// Has to be called when x has been changed outside of iterate.
+	virtual void reset(const Eigen::VectorXd& x) = 0;
+
+	// Updates x and y and stores the previous x in x_prev. Computes the
+	// statistics of the iteration if requested.
+	virtual void iterate(Eigen::VectorXd* x,
+	                     Eigen::VectorXd* x_prev,
+	                     Eigen::VectorXd* y,
+	                     IterationStatistics* statistics) = 0;
+};
+
+// Stores the constraint matrix with Scalar values. All vectors and sums are
+// in double precision, so with Scalar = float only the matrix entries are
+// rounded while the memory traffic of the passes over the matrix is reduced.
+template <typename Scalar>
+class PrimalDualKernelImplementation : public PrimalDualKernel {
+   public:
+	using KernelMatrix = Eigen::SparseMatrix<Scalar, Eigen::RowMajor>;
+
+	PrimalDualKernelImplementation(const Matrix& A_,
+	                 const Matrix& AT_,
+	                 const Eigen::VectorXd& c_,
+	                 const Eigen::VectorXd& lb_,
+	                 const Eigen::VectorXd& ub_,
+	                 const Eigen::VectorXd& b_,
+	                 const std::vector<LinearConstraintType>& constraint_types_,
+	                 const Eigen::VectorXd& Tvec_,
+	                 const Eigen::VectorXd& Svec_,
+	                 int number_of_threads_)
+	    : c(c_),
+	      lb(lb_),
+	      ub(ub_),
+	      b(b_),
+	      constraint_types(constraint_types_),
+	      Tvec(Tvec_),
+	      Svec(Svec_),
+	      x_bar(AT_.rows()),
+	      Ax(A_.rows()),
+	      number_of_threads(number_of_threads_) {
+		if (number_of_threads <= 0) {
+#ifdef USE_OPENMP
+			number_of_threads = omp_get_max_threads();
+#else
+			number_of_threads = 1;
+#endif
+		}
+		if constexpr (std::is_same_v<KernelMatrix, Matrix>) {
+			A = &A_;
+			AT = &AT_;
 		} else {
-			relative_change = (x - x_prev).norm() / (x.norm() + x_prev.norm());
-			if (relative_change != relative_change) {
-				// Both x and x_prev were null vectors.
-				relative_change = 0;
-			}
+			A_storage = A_.template cast<Scalar>();
+			AT_storage = AT_.template cast<Scalar>();
+			A = &A_storage;
+			AT = &AT_storage;
 		}
-		return relative_change;
-	};
+		column_partition = partition_rows(*AT, number_of_threads);
+		row_partition = partition_rows(*A, number_of_threads);
+		partial_statistics.resize(number_of_threads);
+		Ax.setZero();
+	}
 
-	double relative_change_x = get_relative_change(x, *x_prev);
-	double relative_change_y = get_relative_change(y, y_prev);
-	double feasibility_error = get_feasibility_error(x, x_prev, lb, ub, A, b, constraint_types);
+	void set_scaling(const Eigen::VectorXd* row_scale_,
+	                 const Eigen::VectorXd* column_scale_) override {
+		row_scale = row_scale_;
+		column_scale = column_scale_;
+	}
 
-	if (c.isZero(1e-30) && feasibility_error < 100 * options.tolerance) {
-		// If there is no objective function, only feasibility is important.
-		is_converged = true;
-	} else if (relative_change_x < options.tolerance && relative_change_y < options.tolerance) {
-		is_converged = true;
+	void reset(const Eigen::VectorXd& x) override {
+		for (std::ptrdiff_t i = 0; i < A->rows(); ++i) {
+			double sum = 0;
+			for (typename KernelMatrix::InnerIterator it(*A, i); it; ++it) {
+				sum += double(it.value()) * x(it.col());
+			}
+			Ax(i) = sum;
+		}
 	}
 
-	if (options.log_function) {
-		double elapsed_time = wall_time() - start_time;
+	void iterate(Eigen::VectorXd* x_ptr,
+	             Eigen::VectorXd* x_prev_ptr,
+	             Eigen::VectorXd* y_ptr,
+	             IterationStatistics* statistics) override {
+		using namespace std;
+		auto& x = *x_ptr;
+		auto& x_prev = *x_prev_ptr;
+		auto& y = *y_ptr;
+		// x_prev is used as temporary storage when checking convergence.
+		x_prev.resize(x.size());
+		const bool compute_statistics = statistics != nullptr;
+
+#pragma omp parallel num_threads(number_of_threads)
+		{
+#ifdef USE_OPENMP
+			const int thread = omp_get_thread_num();
+			const int threads_in_team = omp_get_num_threads();
+#else
+			const int thread = 0;
+			const int threads_in_team = 1;
+#endif
+
+			for (int part = thread; part < number_of_threads; part += threads_in_team) {
+				IterationStatistics local;
+				for (auto j = column_partition[part]; j < column_partition[part + 1]; ++j) {
+					double gradient = 0;
+					for (typename KernelMatrix::InnerIterator it(*AT, j); it; ++it) {
+						gradient += double(it.value()) * y(it.col());
+					}
+					gradient += c(j);
+					double x_new = max(lb(j), min(ub(j), x(j) - Tvec(j) * gradient));
+					if (compute_statistics) {
+						double scale = column_scale ? (*column_scale)(j) : 1.0;
+						double change = scale * (x_new - x(j));
+						local.x_change2 += change * change;
+						local.x_norm2 += scale * scale * x_new * x_new;
+						local.x_prev_norm2 += scale * scale * x(j) * x(j);
+						local.x_max = max(local.x_max, abs(scale * x_new));
+						local.objective += c(j) * x_new;
+					}
+					x_prev(j) = x(j);
+					x_bar(j) = 2 * x_new - x(j);
+					x(j) = x_new;
+				}
+				partial_statistics[part] = local;
+			}
 
-		ostringstream message;
-		message << setw(9);
-		if (iteration == -1) {
-			message << "end";
-		} else {
-			message << iteration;
+#pragma omp barrier
+
+			for (int part = thread; part < number_of_threads; part += threads_in_team) {
+				IterationStatistics local;
+				for (auto i = row_partition[part]; i < row_partition[part + 1]; ++i) {
+					double Ax_bar = 0;
+					for (typename KernelMatrix::InnerIterator it(*A, i); it; ++it) {
+						Ax_bar += double(it.value()) * x_bar(it.col());
+					}
+					// A * x_bar = 2 * A * x - A * x_prev.
+					Ax(i) = 0.5 * (Ax_bar + Ax(i));
+					double residual = Ax_bar - b(i);
+					double y_new = y(i) + Svec(i) * residual;
+					if (constraint_types[i] == LinearConstraintType::LessThan) {
+						y_new = max(y_new, 0.0);
+					} else if (constraint_types[i] == LinearConstraintType::GreaterThan) {
+						y_new = min(y_new, 0.0);
+					}
+					if (compute_statistics) {
+						double scale = row_scale ? (*row_scale)(i) : 1.0;
+						double change = scale * (y_new - y(i));
+						local.y_change2 += change * change;
+						local.y_norm2 += scale * scale * y_new * y_new;
+						local.y_prev_norm2 += scale * scale * y(i) * y(i);
+						// The constraints of the unscaled problem are scaled
+						// by 1 / row_scale.
+						double error = (Ax(i) - b(i)) / scale;
+						if (constraint_types[i] == LinearConstraintType::LessThan) {
+							error = max(error, 0.0);
+						} else if (constraint_types[i] == LinearConstraintType::GreaterThan) {
+							error = max(-error, 0.0);
+						}
+						local.infeasibility = max(local.infeasibility, abs(error));
+					}
+					y(i) = y_new;
+				}
+				partial_statistics[part].add(local);
+			}
+		}
+
+		if (compute_statistics) {
+			*statistics = IterationStatistics();
+			for (auto& partial : partial_statistics) {
+				statistics->add(partial);
+			}
 		}
-		message << "   " << setw(15) << setprecision(6) << scientific << c.dot(x) << " " << setw(12)
-		        << setprecision(3) << scientific << relative_change_x << " " << setw(12)
-		        << setprecision(3) << scientific << relative_change_y << " " << setw(15)
-		        << setprecision(6) << scientific << feasibility_error << " " << setw(8)
-		        << setprecision(1) << scientific << elapsed_time;
-		options.log_function(message.str());
 	}
 
-	return is_converged;
+   private:
+	// Points to the matrices given to the constructor if they already have
+	// the right type, otherwise to the converted copies.
+	const KernelMatrix* A = nullptr;
+	const KernelMatrix* AT = nullptr;
+	KernelMatrix A_storage;
+	KernelMatrix AT_storage;
+	const Eigen::VectorXd& c;
+	const Eigen::VectorXd& lb;
+	const Eigen::VectorXd& ub;
+	const Eigen::VectorXd& b;
+	const std::vector<LinearConstraintType>& constraint_types;
+	const Eigen::VectorXd& Tvec;
+	const Eigen::VectorXd& Svec;
+	const Eigen::VectorXd* row_scale = nullptr;
+	const Eigen::VectorXd* column_scale = nullptr;
+
+	// 2 * x - x_prev.
+	Eigen::VectorXd x_bar;
+	// A * x for the current x.
+	Eigen::VectorXd Ax;
+	int number_of_threads;
+	std::vector<std::ptrdiff_t> column_partition;
+	std::vector<std::ptrdiff_t> row_partition;
+	std::vector<IterationStatistics> partial_statistics;
+};
+}  // namespace
+
+namespace {
+bool is_finite_bound(double bound) { return std::abs(bound) < 1e30; }
+
+// Scales the rows and columns of A so that the maximum absolute value in
+// every row and column approaches 1. Afterwards,
+//   A = diag(row_scale) * A_org * diag(column_scale).
+void ruiz_equilibrate(Matrix* A,
+                      Eigen::VectorXd* row_scale,
+                      Eigen::VectorXd* column_scale,
+                      int iterations) {
+	using namespace std;
+	row_scale->setOnes(A->rows());
+	column_scale->setOnes(A->cols());
+	Eigen::VectorXd row_max(A->rows());
+	Eigen::VectorXd column_max(A->cols());
+	for (int k = 0; k < iterations; ++k) {
+		row_max.setZero();
+		column_max.setZero();
+		for (int i = 0; i < A->outerSize(); ++i) {
+			for (Matrix::InnerIterator it(*A, i); it; ++it) {
+				row_max(it.row()) = max(row_max(it.row()), abs(it.value()));
+				column_max(it.col()) = max(column_max(it.col()), abs(it.value()));
+			}
+		}
+		for (auto i : range(A->rows())) {
+			row_max(i) = row_max(i) > 0 ? 1.0 / sqrt(row_max(i)) : 1.0;
+		}
+		for (auto j : range(A->cols())) {
+			column_max(j) = column_max(j) > 0 ? 1.0 / sqrt(column_max(j)) : 1.0;
+		}
+		for (int i = 0; i < A->outerSize(); ++i) {
+			for (Matrix::InnerIterator it(*A, i); it; ++it) {
+				it.valueRef() *= row_max(it.row()) * column_max(it.col());
+			}
+		}
+		row_scale->array() *= row_max.array();
+		column_scale->array() *= column_max.array();
+	}
 }
 
-bool first_order_primal_dual_solve(Eigen::VectorXd* x_ptr,        /// Primal variables (in/out).
-                                   Eigen::VectorXd* y_ptr,        /// Dual variables (in/out).
-                                   const Eigen::VectorXd& c_org,  /// Objective function.
-                                   const Eigen::VectorXd& lb,     /// Lower bound on x.
-                                   const Eigen::VectorXd& ub,     /// Upper bound on x.
-                                   const Matrix& A,               /// Equality constraint matrix.
-                                   const Eigen::VectorXd& b,  /// Right-hand side of constraints.
+struct KktError {
+	double primal_objective = 0;
+	double dual_objective = 0;
+	double primal_residual = 0;
+	double dual_residual = 0;
+	double relative_primal_residual = 0;
+	double relative_dual_residual = 0;
+	double relative_gap = 0;
+
+	double relative_error() const {
+		return std::max(relative_gap, std::max(relative_primal_residual, relative_dual_residual));
+	}
+};
+
+// Computes the KKT error of the linear program in first_order_primal_dual_solve,
+// whose dual is
+//
+//   maximize  -b·y + Σ_j min(r_j lb_j, r_j ub_j),  r = c + Aᵀy,
+//
+// where the part of r that can not be absorbed by finite bounds is the dual
+// residual.
+KktError compute_kkt_error(const Eigen::VectorXd& x,
+                           const Eigen::VectorXd& y,
+                           const Eigen::VectorXd& c,
+                           const Eigen::VectorXd& lb,
+                           const Eigen::VectorXd& ub,
+                           const Matrix& A,
+                           const Matrix& AT,
+                           const Eigen::VectorXd& b,
+                           const std::vector<LinearConstraintType>& constraint_types,
+                           Eigen::VectorXd* row_storage,
+                           Eigen::VectorXd* column_storage) {
+	using namespace std;
+	KktError error;
+
+	auto& residual = *row_storage;
+	residual.noalias() = A * x;
+	residual -= b;
+	double primal_residual2 = 0;
+	for (auto i : range(residual.size())) {
+		double violation = residual(i);
+		if (constraint_types[i] == LinearConstraintType::LessThan) {
+			violation = max(violation, 0.0);
+		} else if (constraint_types[i] == LinearConstraintType::GreaterThan) {
+			violation = min(violation, 0.0);
+		}
+		primal_residual2 += violation * violation;
+	}
+
+	auto& reduced_cost = *column_storage;
+	reduced_cost.noalias() = AT * y;
+	reduced_cost += c;
+	double dual_residual2 = 0;
+	error.dual_objective = -b.dot(y);
+	for (auto j : range(reduced_cost.size())) {
+		double r = reduced_cost(j);
+		double lambda = 0;
+		if (r > 0 && is_finite_bound(lb(j))) {
+			lambda = r;
+			error.dual_objective += r * lb(j);
+		} else if (r < 0 && is_finite_bound(ub(j))) {
+			lambda = r;
+			error.dual_objective += r * ub(j);
+		}
+		dual_residual2 += (r - lambda) * (r - lambda);
+	}
+
+	error.primal_objective = c.dot(x);
+	error.primal_residual = sqrt(primal_residual2);
+	error.dual_residual = sqrt(dual_residual2);
+	error.relative_primal_residual = error.primal_residual / (1 + b.norm());
+	error.relative_dual_residual = error.dual_residual / (1 + c.norm());
+	error.relative_gap = abs(error.primal_objective - error.dual_objective)
+	                     / (1 + abs(error.primal_objective) + abs(error.dual_objective));
+	return error;
+}
+}  // namespace
+
+bool first_order_primal_dual_solve(Eigen::VectorXd* x_ptr,         /// Primal variables (in/out).
+                                   Eigen::VectorXd* y_ptr,         /// Dual variables (in/out).
+                                   const Eigen::VectorXd& c_org,   /// Objective function.
+                                   const Eigen::VectorXd& lb_org,  /// Lower bound on x.
+                                   const Eigen::VectorXd& ub_org,  /// Upper bound on x.
+                                   const Matrix& A_org,            /// Equality constraint matrix.
+                                   const Eigen::VectorXd& b_org,   /// Right-hand side.
                                    const std::vector<LinearConstraintType>& constraint_types,
-                                   const FirstOrderOptions& options) {
+                                   const FirstOrderOptions& options,
+                                   FirstOrderStatistics* statistics) {
 	using namespace Eigen;
 	using namespace std;
 
@@ -178,23 +593,24 @@ bool first_order_primal_dual_solve(Eigen::VectorXd* x_ptr,        /// Primal var
 	const auto n = x.size();
 	const auto m = y.size();
 	minimum_core_assert(c_org.size() == n);
-	minimum_core_assert(b.size() == m);
-	minimum_core_assert(A.rows() == m);
-	minimum_core_assert(A.cols() == n);
+	minimum_core_assert(b_org.size() == m);
+	minimum_core_assert(A_org.rows() == m);
+	minimum_core_assert(A_org.cols() == n);
 	minimum_core_assert(constraint_types.size() == m);
+	check(options.kkt_check_interval >= 1, "kkt_check_interval must be at least 1.");
+	check(options.use_fused_kernel || options.precision == FirstOrderPrecision::Double,
+	      "Single and mixed precision require the fused kernel.");
 
 	VectorXd x_prev(n);
 	VectorXd y_prev(m);
 
-	const Matrix AT = A.transpose();
-
 	Eigen::VectorXd c = c_org;
 	double c_change_factor = 1.0;
 	if (options.rescale_c) {
-		auto bnorm = b.norm();
+		auto bnorm = b_org.norm();
 		auto cnorm = c.norm();
 		if (bnorm > 1e-6 && cnorm > 1e-6) {
-			c_change_factor = b.norm() / c.norm();
+			c_change_factor = b_org.norm() / c.norm();
 			c *= c_change_factor;
 			y *= c_change_factor;
 		}
@@ -204,14 +620,14 @@ bool first_order_primal_dual_solve(Eigen::VectorXd* x_ptr,        /// Primal var
 	double cnorm_2 = c.norm();
 	double cnorm_inf = c.cwiseAbs().maxCoeff();
 
-	double bnorm_1 = b.cwiseAbs().sum();
-	double bnorm_2 = b.norm();
-	double bnorm_inf = b.cwiseAbs().maxCoeff();
+	double bnorm_1 = b_org.cwiseAbs().sum();
+	double bnorm_2 = b_org.norm();
+	double bnorm_inf = b_org.cwiseAbs().maxCoeff();
 
 	if (options.log_function) {
-		options.log_function("Problem size: " + to_string_with_separator(A.rows()) + " x "
-		                     + to_string_with_separator(A.cols()) + " ("
-		                     + to_string_with_separator(A.nonZeros()) + " non-zeros)");
+		options.log_function("Problem size: " + to_string_with_separator(A_org.rows()) + " x "
+		                     + to_string_with_separator(A_org.cols()) + " ("
+		                     + to_string_with_separator(A_org.nonZeros()) + " non-zeros)");
 		options.log_function(
 		    to_string("|c|_1 = ", cnorm_1, ", |c|_2 = ", cnorm_2, ", |c|_∞ = ", cnorm_inf));
 		options.log_function(
@@ -222,9 +638,84 @@ bool first_order_primal_dual_solve(Eigen::VectorXd* x_ptr,        /// Primal var
 		    "------------------------------------------------------------------------------");
 		x_prev.setConstant(std::numeric_limits<double>::quiet_NaN());
 		y_prev.setConstant(std::numeric_limits<double>::quiet_NaN());
-		check_convergence_and_log(
-		    0, x, &x_prev, y, y_prev, c_org, lb, ub, A, b, constraint_types, options, start_time);
+		check_convergence_and_log(0,
+		                          x,
+		                          &x_prev,
+		                          y,
+		                          y_prev,
+		                          c_org,
+		                          lb_org,
+		                          ub_org,
+		                          A_org,
+		                          b_org,
+		                          constraint_types,
+		                          options,
+		                          start_time);
+	}
+
+	// With equilibration, the iterations work with the scaled problem
+	//
+	//   A = diag(row_scale) * A_org * diag(column_scale),
+	//   x = x_org / column_scale,
+	//   y = y_org / row_scale.
+	const bool equilibrate = options.ruiz_iterations > 0;
+	Matrix A_scaled;
+	VectorXd b_scaled, lb_scaled, ub_scaled;
+	VectorXd row_scale, column_scale;
+	if (equilibrate) {
+		A_scaled = A_org;
+		ruiz_equilibrate(&A_scaled, &row_scale, &column_scale, options.ruiz_iterations);
+		b_scaled = row_scale.cwiseProduct(b_org);
+		lb_scaled = lb_org.cwiseQuotient(column_scale);
+		ub_scaled = ub_org.cwiseQuotient(column_scale);
+		c = c.cwiseProduct(column_scale);
+		x = x.cwiseQuotient(column_scale);
+		y = y.cwiseQuotient(row_scale);
 	}
+	const Matrix& A = equilibrate ? A_scaled : A_org;
+	const VectorXd& b = equilibrate ? b_scaled : b_org;
+	const VectorXd& lb = equilibrate ? lb_scaled : lb_org;
+	const VectorXd& ub = equilibrate ? ub_scaled : ub_org;
+	Matrix AT = A.transpose();
+
+	// Storage for the unscaled variables when checking convergence.
+	VectorXd x_unscaled, x_prev_unscaled, y_unscaled, y_prev_unscaled;
+	auto check_convergence = [&](std::ptrdiff_t iteration, bool should_log) {
+		if (!equilibrate) {
+			return check_convergence_and_log(iteration,
+			                                 x,
+			                                 &x_prev,
+			                                 y,
+			                                 y_prev,
+			                                 c_org,
+			                                 lb_org,
+			                                 ub_org,
+			                                 A_org,
+			                                 b_org,
+			                                 constraint_types,
+			                                 options,
+			                                 start_time,
+			                                 should_log);
+		}
+		x_unscaled = x.cwiseProduct(column_scale);
+		x_prev_unscaled = x_prev.cwiseProduct(column_scale);
+		y_unscaled = y.cwiseProduct(row_scale);
+		y_prev_unscaled = y_prev.cwiseProduct(row_scale);
+		return check_convergence_and_log(iteration,
+		                                 x_unscaled,
+		                                 &x_prev_unscaled,
+		                                 y_unscaled,
+		                                 y_prev_unscaled,
+		                                 c_org,
+		                                 lb_org,
+		                                 ub_org,
+		                                 A_org,
+		                                 b_org,
+		                                 constraint_types,
+		                                 options,
+		                                 start_time,
+		                                 should_log);
+	};
 
 	// Compute preconditioners as in eq. (10) from [2], with alpha = 1.
 	VectorXd Tvec(n);
@@ -249,62 +740,276 @@ bool first_order_primal_dual_solve(Eigen::VectorXd* x_ptr,        /// Primal var
 		Svec(i) = 1.0 / Svec(i);
 	}
 
+	// The primal weight ω scales the step sizes to T/ω and Sω. This keeps
+	// the convergence condition of [2] satisfied.
+	const VectorXd Tvec_org = Tvec;
+	const VectorXd Svec_org = Svec;
+	double primal_weight = 1.0;
+
+	// State for restarts and KKT-based convergence, as in [3].
+	const bool use_kkt = options.adaptive_restarts || options.kkt_tolerance > 0;
+	VectorXd x_sum, y_sum;
+	VectorXd x_last_restart, y_last_restart;
+	VectorXd row_storage(m), column_storage(n);
+	size_t iterations_since_restart = 0;
+	double last_restart_kkt = numeric_limits<double>::infinity();
+	double previous_candidate_kkt = numeric_limits<double>::infinity();
+	size_t restarts = 0;
+	bool kkt_converged = false;
+	double kkt_error = numeric_limits<double>::quiet_NaN();
+	if (use_kkt) {
+		x_sum.setZero(n);
+		y_sum.setZero(m);
+		x_last_restart = x;
+		y_last_restart = y;
+	}
+	// The KKT error is always measured on the original problem, without the
+	// Ruiz scaling and the rescaling of c.
+	Matrix AT_org;
+	if (use_kkt && equilibrate) {
+		AT_org = A_org.transpose();
+	}
+	auto get_kkt_error = [&](const VectorXd& x, const VectorXd& y) {
+		if (!equilibrate) {
+			if (c_change_factor == 1.0) {
+				return compute_kkt_error(
+				    x, y, c, lb, ub, A, AT, b, constraint_types, &row_storage, &column_storage);
+			}
+			return compute_kkt_error(x,
+			                         y / c_change_factor,
+			                         c_org,
+			                         lb,
+			                         ub,
+			                         A,
+			                         AT,
+			                         b,
+			                         constraint_types,
+			                         &row_storage,
+			                         &column_storage);
+		}
+		return compute_kkt_error(x.cwiseProduct(column_scale),
+		                         y.cwiseProduct(row_scale) / c_change_factor,
+		                         c_org,
+		                         lb_org,
+		                         ub_org,
+		                         A_org,
+		                         AT_org,
+		                         b_org,
+		                         constraint_types,
+		                         &row_storage,
+		                         &column_storage);
+	};
+
+	std::unique_ptr<PrimalDualKernel> kernel;
+	bool single_precision = false;
+	auto create_kernel = [&](bool use_single_precision) {
+		if (use_single_precision) {
+			kernel = make_unique<PrimalDualKernelImplementation<float>>(
+			    A, AT, c, lb, ub, b, constraint_types, Tvec, Svec, options.number_of_threads);
+		} else {
+			if (AT.rows() != n) {
+				AT = A.transpose();
+			}
+			kernel = make_unique<PrimalDualKernelImplementation<double>>(
+			    A, AT, c, lb, ub, b, constraint_types, Tvec, Svec, options.number_of_threads);
+		}
+		if (equilibrate) {
+			kernel->set_scaling(&row_scale, &column_scale);
+		}
+		kernel->reset(x);
+		single_precision = use_single_precision;
+	};
+	if (options.use_fused_kernel) {
+		create_kernel(options.precision != FirstOrderPrecision::Double);
+		// The single precision kernel has its own copy of the transpose. The
+		// double one is only needed for the KKT error of the unscaled problem
+		// and is recomputed if Mixed switches to double precision.
+		if (single_precision && !(use_kkt && !equilibrate)) {
+			AT = Matrix();
+		}
+	}
+
+	// With the fused kernel, convergence is checked with the statistics
+	// computed during the iteration.
+	const bool objective_is_zero = c_org.isZero(1e-30);
+	IterationStatistics iteration_statistics;
+	auto check_kernel_convergence = [&](std::ptrdiff_t iteration, bool should_log) {
+		ConvergenceInfo info;
+		info.objective = iteration_statistics.objective / c_change_factor;
+		info.relative_change_x = get_relative_change(iteration,
+		                                             sqrt(iteration_statistics.x_change2),
+		                                             sqrt(iteration_statistics.x_norm2),
+		                                             sqrt(iteration_statistics.x_prev_norm2));
+		info.relative_change_y = get_relative_change(iteration,
+		                                             sqrt(iteration_statistics.y_change2),
+		                                             sqrt(iteration_statistics.y_norm2),
+		                                             sqrt(iteration_statistics.y_prev_norm2));
+		// x is always within its bounds.
+		double denominator = iteration_statistics.x_max;
+		if (denominator <= 1e-10) {
+			denominator = 1;
+		}
+		info.feasibility_error = iteration_statistics.infeasibility / denominator;
+		if (should_log) {
+			log_iteration(iteration, info, options, start_time);
+		}
+		double tolerance = options.tolerance;
+		if (single_precision && options.precision == FirstOrderPrecision::Mixed) {
+			tolerance = max(tolerance, options.single_precision_tolerance);
+		}
+		return is_converged(info, objective_is_zero, tolerance);
+	};
+
 	size_t iteration;
 	for (iteration = 1; iteration <= options.maximum_iterations; ++iteration) {
-		bool should_check_convergence = should_print(iteration, options);
+		const bool should_log = options.log_function && should_print(iteration, options);
+		bool should_check_convergence = should_log;
+		if (options.check_interval == 0) {
+			should_check_convergence |= should_print(iteration, options);
+		} else {
+			should_check_convergence |= iteration % options.check_interval == 0;
+		}
 
-		x_prev = x;
-		if (should_check_convergence) {
+		if (should_check_convergence && !kernel) {
 			y_prev = y;
 		}
 
 		// See eq. (18) from [2].
 
-		x = x - Tvec.asDiagonal() * (AT * y + c);
+		if (kernel) {
+			kernel->iterate(
+			    &x, &x_prev, &y, should_check_convergence ? &iteration_statistics : nullptr);
+		} else {
+			x_prev = x;
 
-		for (ptrdiff_t j = 0; j < n; ++j) {
-			x(j) = max(lb(j), min(ub(j), x(j)));
+			x = x - Tvec.asDiagonal() * (AT * y + c);
+
+			for (ptrdiff_t j = 0; j < n; ++j) {
+				x(j) = max(lb(j), min(ub(j), x(j)));
+			}
+
+			y = y + Svec.asDiagonal() * (A * (2 * x - x_prev) - b);
+
+			for (size_t i = 0; i < m; ++i) {
+				if (constraint_types[i] == LinearConstraintType::LessThan) {
+					y(i) = max(y(i), 0.0);
+				} else if (constraint_types[i] == LinearConstraintType::GreaterThan) {
+					y(i) = min(y(i), 0.0);
+				}
+			}
+		}
+
+		if (use_kkt) {
+			x_sum += x;
+			y_sum += y;
+			iterations_since_restart++;
 		}
 
-		y = y + Svec.asDiagonal() * (A * (2 * x - x_prev) - b);
+		if (use_kkt
+		    && (iteration % options.kkt_check_interval == 0
+		        || iteration == options.maximum_iterations)) {
+			// The restart candidate is the average or the current iterate,
+			// whichever has the lowest KKT error.
+			auto current_error = get_kkt_error(x, y);
+			VectorXd x_average = x_sum / double(iterations_since_restart);
+			VectorXd y_average = y_sum / double(iterations_since_restart);
+			auto average_error = get_kkt_error(x_average, y_average);
+			bool use_average = average_error.relative_error() < current_error.relative_error();
+			double candidate_kkt = use_average ? average_error.relative_error()
+			                                   : current_error.relative_error();
+			kkt_error = candidate_kkt;
+
+			if (options.kkt_tolerance > 0 && candidate_kkt <= options.kkt_tolerance) {
+				if (use_average) {
+					x = x_average;
+					y = y_average;
+				}
+				kkt_converged = true;
+				break;
+			}
 
-		for (size_t i = 0; i < m; ++i) {
-			if (constraint_types[i] == LinearConstraintType::LessThan) {
-				y(i) = max(y(i), 0.0);
-			} else if (constraint_types[i] == LinearConstraintType::GreaterThan) {
-				y(i) = min(y(i), 0.0);
+			// Restart criteria from [3] with β_sufficient = 0.2, β_necessary = 0.8
+			// and β_artificial = 0.36.
+			bool should_restart =
+			    options.adaptive_restarts
+			    && (candidate_kkt <= 0.2 * last_restart_kkt
+			        || (candidate_kkt <= 0.8 * last_restart_kkt
+			            && candidate_kkt > previous_candidate_kkt)
+			        || iterations_since_restart >= 0.36 * iteration);
+			previous_candidate_kkt = candidate_kkt;
+
+			if (should_restart) {
+				if (use_average) {
+					x = x_average;
+					y = y_average;
+					if (kernel) {
+						kernel->reset(x);
+					}
+					// The change of this iteration is not meaningful.
+					should_check_convergence = false;
+				}
+
+				if (options.primal_weight_updates) {
+					double delta_x = (x - x_last_restart).norm();
+					double delta_y = (y - y_last_restart).norm();
+					if (delta_x > 1e-10 && delta_y > 1e-10) {
+						primal_weight =
+						    exp(0.5 * log(delta_y / delta_x) + 0.5 * log(primal_weight));
+						Tvec = Tvec_org / primal_weight;
+						Svec = Svec_org * primal_weight;
+					}
+				}
+
+				x_last_restart = x;
+				y_last_restart = y;
+				x_sum.setZero();
+				y_sum.setZero();
+				iterations_since_restart = 0;
+				last_restart_kkt = candidate_kkt;
+				previous_candidate_kkt = numeric_limits<double>::infinity();
+				restarts++;
 			}
 		}
 
 		if (should_check_convergence) {
-			if (check_convergence_and_log(iteration,
-			                              x,
-			                              &x_prev,
-			                              y,
-			                              y_prev,
-			                              c_org,
-			                              lb,
-			                              ub,
-			                              A,
-			                              b,
-			                              constraint_types,
-			                              options,
-			                              start_time)) {
+			bool converged = kernel ? check_kernel_convergence(iteration, should_log)
+			                        : check_convergence(iteration, should_log);
+			if (converged && single_precision
+			    && options.precision == FirstOrderPrecision::Mixed) {
+				// Polish the solution in double precision.
+				if (options.log_function) {
+					options.log_function("Switching to double precision.");
+				}
+				create_kernel(false);
+			} else if (converged && options.kkt_tolerance <= 0) {
+				// With a KKT tolerance, the relative changes are only logged.
 				break;
 			}
 		}
 	}
 
-	check_convergence_and_log(
-	    -1, x, &x_prev, y, y_prev, c_org, lb, ub, A, b, constraint_types, options, start_time);
+	check_convergence(-1, true);
 
-	double feasibility_error = get_feasibility_error(x, &x_prev, lb, ub, A, b, constraint_types);
+	if (equilibrate) {
+		x = x.cwiseProduct(column_scale);
+		y = y.cwiseProduct(row_scale);
+	}
+
+	double feasibility_error =
+	    get_feasibility_error(x, &x_prev, lb_org, ub_org, A_org, b_org, constraint_types);
 
 	if (options.rescale_c) {
 		y /= c_change_factor;
 	}
 
-	return feasibility_error < 100 * options.tolerance;
+	if (statistics) {
+		statistics->iterations = min(iteration, options.maximum_iterations);
+		statistics->restarts = restarts;
+		statistics->kkt_error = kkt_error;
+		statistics->primal_weight = primal_weight;
+	}
+
+	return kkt_converged || feasibility_error < 100 * options.tolerance;
 }
 
 bool MINIMUM_LINEAR_API first_order_admm_solve(Eigen::VectorXd* x_ptr,
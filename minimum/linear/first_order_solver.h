@@ -1,5 +1,7 @@
 #pragma once
 
+#include <limits>
+
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 
@@ -10,7 +12,9 @@ namespace minimum {
 namespace linear {
 
 struct FirstOrderOptions;
+struct FirstOrderStatistics;
 enum class LinearConstraintType : char { Equality, LessThan, GreaterThan };
+enum class FirstOrderPrecision : char { Double, Single, Mixed };
 
 using Matrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
 
@@ -21,6 +25,9 @@ using Matrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
 //             l ≤ x ≤ u.
 //
 // Implements the first-order solver described in [1], with the preconditioner of [2].
+// Optionally, the enhancements of [3] can be enabled: Ruiz equilibration, adaptive
+// restarts to the average iterate, primal weight updates and termination based on
+// the relative KKT error. See FirstOrderOptions.
 //
 // [1] Chambolle, A., & Pock, T. (2011). A first-order primal-dual algorithm for convex
 //     problems with applications to imaging. Journal of Mathematical Imaging and Vision,
@@ -30,6 +37,10 @@ using Matrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
 //     order primal-dual algorithms in convex optimization. In Computer Vision (ICCV),
 //     2011 IEEE International Conference on (pp. 1762-1769). IEEE.
 //
+// [3] Applegate, D., Díaz, M., Hinder, O., Lu, H., Lubin, M., O'Donoghue, B., &
+//     Schudy, W. (2021). Practical large-scale linear programming using primal-dual
+//     hybrid gradient. Advances in Neural Information Processing Systems, 34.
+//
 bool MINIMUM_LINEAR_API
 first_order_primal_dual_solve(Eigen::VectorXd* x,         /// Primal variables (in/out).
                               Eigen::VectorXd* y,         /// Dual variables (in/out).
@@ -39,7 +50,8 @@ first_order_primal_dual_solve(Eigen::VectorXd* x,         /// Primal variables (
                               const Matrix& A,            /// Constraint matrix.
                               const Eigen::VectorXd& b,   /// Right-hand side of constraints.
                               const std::vector<LinearConstraintType>& constraint_types,
-                              const FirstOrderOptions& options);
+                              const FirstOrderOptions& options,
+                              FirstOrderStatistics* statistics = nullptr);
 
 // Solves the linear program
 //
@@ -63,6 +75,10 @@ struct MINIMUM_LINEAR_API FirstOrderOptions {
 	// If this value is 0, the print interval will be gradually increased
 	// as time goes by.
 	std::size_t print_interval = 0;
+	// If positive, convergence is checked this often instead, independently
+	// of logging. With the fused kernel, a check does not need any additional
+	// passes over the constraint matrix.
+	std::size_t check_interval = 0;
 	std::function<void(const std::string&)> log_function = nullptr;
 
 	// Stops the solver if the relative changes in the primal and dual
@@ -78,6 +94,59 @@ struct MINIMUM_LINEAR_API FirstOrderOptions {
 	// right-hand side of the constraints. This is done internally and the
 	// reported objective function values are not affected.
 	bool rescale_c = true;
+
+	// Uses a multi-threaded kernel for the primal-dual iterations. The matrix-
+	// vector products are computed row by row with the preconditioning and
+	// projections applied directly, without creating temporary vectors.
+	bool use_fused_kernel = true;
+
+	// Number of threads used by the fused kernel. 0 means the OpenMP default.
+	int number_of_threads = 0;
+
+	// Precision of the constraint matrix in the fused kernel. All vectors and
+	// sums are in double precision regardless. Requires use_fused_kernel.
+	//
+	// Single halves the memory traffic of the matrix values, but the matrix
+	// entries are rounded, so the solution can only be expected to be accurate
+	// to about 1e-6. Mixed starts in single precision and switches to double
+	// precision when the relative changes are below single_precision_tolerance
+	// in order to polish the solution.
+	//
+	// This reduces bandwidth, not memory. The kernel keeps single precision
+	// copies of A and its transpose while the double precision A (and its
+	// equilibrated copy) are still kept for the convergence checks.
+	FirstOrderPrecision precision = FirstOrderPrecision::Double;
+	double single_precision_tolerance = 1e-5;
+
+	// Number of Ruiz equilibration iterations applied to the constraint
+	// matrix before solving. 0 disables equilibration.
+	int ruiz_iterations = 0;
+
+	// Restarts the iterations from the average (or current) iterate when
+	// the relative KKT error has decreased sufficiently.
+	bool adaptive_restarts = false;
+
+	// Rebalances the primal and dual step sizes at every restart.
+	bool primal_weight_updates = false;
+
+	// If positive, the solver stops when the relative KKT error (the maximum
+	// of the relative primal residual, dual residual and duality gap) is
+	// lower than this value, instead of using the relative changes. The error
+	// is measured on the original problem, before equilibration and
+	// rescale_c.
+	double kkt_tolerance = 0;
+
+	// How often (in iterations) the KKT error is computed when restarts or
+	// KKT termination are enabled. Has to be at least 1.
+	std::size_t kkt_check_interval = 64;
+};
+
+struct MINIMUM_LINEAR_API FirstOrderStatistics {
+	std::size_t iterations = 0;
+	std::size_t restarts = 0;
+	// Relative KKT error at the last check. NaN if it was never computed.
+	double kkt_error = std::numeric_limits<double>::quiet_NaN();
+	double primal_weight = 1;
 };
 
 class MINIMUM_LINEAR_API PrimalDualSolver : public Solver {
@@ -1,5 +1,8 @@
 #include <cmath>
 #include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
 
 #include <catch.hpp>
 
@@ -9,17 +12,64 @@
 #include <minimum/linear/ip.h>
 using namespace minimum::linear;
 
+// The constraint matrix of Strange_convergence.
+static Eigen::MatrixXd strange_convergence_matrix() {
+	Eigen::MatrixXd A(4, 8);
+	A.row(0) << 1, 5, 6, 1, -5, 1, 6, 0;
+	A.row(1) << 2, 5, 5, -1, 5, 1, 6, 0;
+	A.row(2) << 3, 5, -4, -1, 5, 2, 0, 9;
+	A.row(3) << 4, 5, 1, 1, -5, 3, 0, 9;
+	return A;
+}
+
+struct RandomLP {
+	Matrix A;
+	Eigen::VectorXd b, c, lb, ub;
+	std::vector<LinearConstraintType> constraint_types;
+};
+
+// A random LP with five entries in every row, all constraint types and the
+// variables bounded by [-1, 1].
+static RandomLP create_random_lp(int m, int n, unsigned seed) {
+	using namespace Eigen;
+	using namespace std;
+
+	mt19937 engine(seed);
+	uniform_real_distribution<double> coefficient(-1, 1);
+	uniform_int_distribution<int> index(0, n - 1);
+	vector<Triplet<double>> triplets;
+	for (int i = 0; i < m; ++i) {
+		for (int k = 0; k < 5; ++k) {
+			triplets.emplace_back(i, index(engine), coefficient(engine));
+		}
+	}
+	RandomLP lp;
+	lp.A.resize(m, n);
+	lp.A.setFromTriplets(triplets.begin(), triplets.end());
+
+	lp.b.resize(m);
+	lp.c.resize(n);
+	lp.lb.resize(n);
+	lp.ub.resize(n);
+	for (int i = 0; i < m; ++i) {
+		lp.b(i) = coefficient(engine);
+		lp.constraint_types.push_back(LinearConstraintType(i % 3));
+	}
+	for (int j = 0; j < n; ++j) {
+		lp.c(j) = coefficient(engine);
+		lp.lb(j) = -1;
+		lp.ub(j) = 1;
+	}
+	return lp;
+}
+
 TEST_CASE("Strange_convergence") {
 	using namespace Eigen;
 	using namespace std;
 
 	int m = 4;
 	int n = 8;
-	MatrixXd Adense(m, n);
-	Adense.row(0) << 1, 5, 6, 1, -5, 1, 6, 0;
-	Adense.row(1) << 2, 5, 5, -1, 5, 1, 6, 0;
-	Adense.row(2) << 3, 5, -4, -1, 5, 2, 0, 9;
-	Adense.row(3) << 4, 5, 1, 1, -5, 3, 0, 9;
+	MatrixXd Adense = strange_convergence_matrix();
 	minimum::linear::Matrix A;
 	A = Adense.sparseView();
 
@@ -106,6 +156,232 @@ TEST_CASE("Strange_convergence") {
 	CHECK(abs(c.dot(x) - 2.0) <= 1e-6);
 }
 
+TEST_CASE("fused_kernel") {
+	using namespace Eigen;
+	using namespace std;
+
+	const int m = 40;
+	const int n = 60;
+	const auto lp = create_random_lp(m, n, 0);
+	const auto& A = lp.A;
+	const auto& b = lp.b;
+	const auto& c = lp.c;
+	const auto& lb = lp.lb;
+	const auto& ub = lp.ub;
+	const auto& constraint_types = lp.constraint_types;
+
+	FirstOrderOptions options;
+	options.maximum_iterations = 200;
+	options.use_fused_kernel = false;
+	VectorXd x_ref = VectorXd::Zero(n);
+	VectorXd y_ref = VectorXd::Zero(m);
+	first_order_primal_dual_solve(&x_ref, &y_ref, c, lb, ub, A, b, constraint_types, options);
+
+	options.use_fused_kernel = true;
+	for (int threads : {1, 2, 3}) {
+		CAPTURE(threads);
+		options.number_of_threads = threads;
+		VectorXd x = VectorXd::Zero(n);
+		VectorXd y = VectorXd::Zero(m);
+		first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options);
+		CHECK((x - x_ref).norm() <= 1e-10);
+		CHECK((y - y_ref).norm() <= 1e-10);
+	}
+}
+
+TEST_CASE("convergence_statistics") {
+	using namespace Eigen;
+	using namespace std;
+
+	const int m = 30;
+	const int n = 50;
+	const auto lp = create_random_lp(m, n, 1);
+	const auto& A = lp.A;
+	const auto& b = lp.b;
+	const auto& c = lp.c;
+	const auto& lb = lp.lb;
+	const auto& ub = lp.ub;
+	const auto& constraint_types = lp.constraint_types;
+
+	// The logged iterations as vectors of objective, relative changes and
+	// infeasibility.
+	auto solve = [&](bool use_fused_kernel, int ruiz_iterations) {
+		vector<vector<double>> log;
+		FirstOrderOptions options;
+		options.maximum_iterations = 500;
+		options.print_interval = 50;
+		options.check_interval = 10;
+		options.use_fused_kernel = use_fused_kernel;
+		options.ruiz_iterations = ruiz_iterations;
+		options.log_function = [&log](const string& str) {
+			istringstream in(str);
+			int iteration;
+			vector<double> values(4);
+			if (in >> iteration >> values[0] >> values[1] >> values[2] >> values[3]) {
+				log.push_back(values);
+			}
+		};
+		VectorXd x = VectorXd::Zero(n);
+		VectorXd y = VectorXd::Zero(m);
+		first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options);
+		return log;
+	};
+
+	for (int ruiz_iterations : {0, 5}) {
+		CAPTURE(ruiz_iterations);
+		auto expected = solve(false, ruiz_iterations);
+		auto log = solve(true, ruiz_iterations);
+		REQUIRE(log.size() == expected.size());
+		// The first line is before the first iteration.
+		for (size_t k = 1; k < log.size(); ++k) {
+			for (size_t i = 0; i < 4; ++i) {
+				CAPTURE(k);
+				CAPTURE(i);
+				CHECK(log[k][i] == Approx(expected[k][i]).epsilon(1e-3).margin(1e-12));
+			}
+		}
+	}
+}
+
+TEST_CASE("single_and_mixed_precision") {
+	using namespace Eigen;
+	using namespace std;
+
+	int m = 4;
+	int n = 8;
+	MatrixXd Adense = strange_convergence_matrix();
+	// Entries that can not be represented exactly in single precision.
+	Adense *= 1.0 / 3.0;
+	minimum::linear::Matrix A;
+	A = Adense.sparseView();
+
+	VectorXd x(n);
+	x << 1, 1, 0, 0, 1, 1, 0, 0;
+	VectorXd b(m);
+	b = A * x;
+
+	VectorXd c(n);
+	c << 1, -1, 2, -3, -5, 7, 9, -6;
+	VectorXd lb = VectorXd::Zero(n);
+	VectorXd ub = VectorXd::Ones(n);
+	vector<LinearConstraintType> constraint_types(m, LinearConstraintType::Equality);
+
+	FirstOrderOptions options;
+	options.maximum_iterations = 20000;
+	options.check_interval = 100;
+
+	bool switched = false;
+	options.log_function = [&switched](const string& str) {
+		if (str == "Switching to double precision.") {
+			switched = true;
+		}
+	};
+
+	VectorXd y;
+	SECTION("single") {
+		options.precision = FirstOrderPrecision::Single;
+		options.tolerance = 1e-6;
+		x.setZero();
+		y.setZero(m);
+		first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options);
+		CHECK(abs(c.dot(x) - 2.0) <= 1e-4);
+		CHECK_FALSE(switched);
+	}
+
+	SECTION("mixed") {
+		options.precision = FirstOrderPrecision::Mixed;
+		options.tolerance = 1e-9;
+		x.setZero();
+		y.setZero(m);
+		CHECK(first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options));
+		CHECK(abs(c.dot(x) - 2.0) <= 1e-6);
+		CHECK(switched);
+	}
+
+	SECTION("without fused kernel") {
+		options.precision = FirstOrderPrecision::Single;
+		options.use_fused_kernel = false;
+		y.setZero(m);
+		CHECK_THROWS(
+		    first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options));
+	}
+}
+
+TEST_CASE("restarts_and_equilibration") {
+	using namespace Eigen;
+	using namespace std;
+
+	// The problem from Strange_convergence with badly scaled rows and columns.
+	// The plain iterations do not converge within the iteration limit.
+	int m = 4;
+	int n = 8;
+	MatrixXd Adense = strange_convergence_matrix();
+	Adense.row(0) *= 100;
+	Adense.row(3) *= 0.1;
+	Adense.col(2) *= 20;
+	minimum::linear::Matrix A;
+	A = Adense.sparseView();
+
+	VectorXd x(n);
+	x << 1, 1, 0, 0, 1, 1, 0, 0;
+	VectorXd b(m);
+	b = A * x;
+
+	VectorXd c(n);
+	c << 1, -1, 2, -3, -5, 7, 9, -6;
+	VectorXd lb = VectorXd::Zero(n);
+	VectorXd ub = VectorXd::Ones(n);
+	vector<LinearConstraintType> constraint_types(m, LinearConstraintType::Equality);
+
+	auto solve = [&](const string& name,
+	                 int ruiz_iterations,
+	                 bool restarts,
+	                 bool rescale_c = true) {
+		FirstOrderOptions options;
+		options.maximum_iterations = 100'000;
+		options.kkt_tolerance = 1e-8;
+		options.rescale_c = rescale_c;
+		options.ruiz_iterations = ruiz_iterations;
+		options.adaptive_restarts = restarts;
+		options.primal_weight_updates = restarts;
+		FirstOrderStatistics statistics;
+		x.setZero();
+		VectorXd y = VectorXd::Zero(m);
+		bool result = first_order_primal_dual_solve(
+		    &x, &y, c, lb, ub, A, b, constraint_types, options, &statistics);
+		cerr << setw(20) << name << setw(10) << statistics.iterations << setw(6)
+		     << statistics.restarts << setw(14) << statistics.kkt_error << setw(12) << c.dot(x)
+		     << endl;
+		if (ruiz_iterations > 0 || restarts) {
+			CHECK(result);
+			CHECK(statistics.kkt_error <= 1e-8);
+			CHECK(abs(c.dot(x) - 2.0) <= 1e-6);
+		}
+		return statistics.iterations;
+	};
+
+	cerr << setw(20) << "" << setw(10) << "Iter." << setw(6) << "Rest." << setw(14) << "KKT"
+	     << setw(12) << "Objective" << endl;
+	auto baseline = solve("Baseline", 0, false);
+	auto ruiz = solve("Ruiz", 10, false);
+	auto restarts = solve("Restarts", 0, true);
+	auto all = solve("Ruiz and restarts", 10, true);
+	CHECK(ruiz < baseline);
+	CHECK(restarts < baseline);
+	CHECK(all < restarts);
+	// The KKT error does not include the rescaling of c.
+	solve("Without rescale_c", 10, true, false);
+
+	FirstOrderOptions options;
+	FirstOrderStatistics statistics;
+	VectorXd y = VectorXd::Zero(m);
+	first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options, &statistics);
+	CHECK(std::isnan(statistics.kkt_error));
+
+	options.kkt_check_interval = 0;
+	CHECK_THROWS(first_order_primal_dual_solve(&x, &y, c, lb, ub, A, b, constraint_types, options));
+}
+
 TEST_CASE("FirstOrderProblem/tiny") {
 	using namespace std;
 
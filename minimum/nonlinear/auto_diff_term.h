@@ -12,6 +12,7 @@
 
 #include <minimum/core/check.h>
 #include <minimum/core/string.h>
+#include <minimum/nonlinear/lanes.h>
 #include <minimum/nonlinear/term.h>
 
 namespace minimum {
@@ -163,11 +164,49 @@ T differentiate_functor(const Functor& functor, const T* x_in, T* df) {
 	return f.x();
 }
 
+// A functor can ask to be evaluated in SIMD lanes by declaring
+//
+//   static constexpr bool evaluate_in_lanes = true;
+//
+// Its operator() is then also called with fadbad::F<Lanes<double, W>, n>,
+// which differentiates W terms at once. This requires that the functor
+// has no data members, since one instance is used for all lanes, and that
+// it does not compare or branch on its arguments.
+template <typename Functor, typename = void>
+struct has_lane_evaluation : std::false_type {};
+
+template <typename Functor>
+struct has_lane_evaluation<Functor, std::void_t<decltype(Functor::evaluate_in_lanes)>>
+    : std::integral_constant<bool, Functor::evaluate_in_lanes> {};
+
+// Base class of all AutoDiffTerms. Evaluates batches of terms of the same
+// type by calling the functors directly, without a virtual call and dynamic
+// gradient storage per term. Functors with has_lane_evaluation are
+// evaluated default_lane_width terms at a time; the remaining terms and all
+// other functors are evaluated one term at a time.
+template <typename Derived, typename Functor, int... D>
+class BatchedSizedTerm : public SizedTerm<D...> {
+   public:
+	virtual double evaluate_batch(const Term* const* terms,
+	                              int number_of_terms,
+	                              double* const* const* variables,
+	                              double* gradients) const override;
+
+	// Forward-over-forward differentiation with a single inner direction.
+	// Costs about as much as two gradient evaluations.
+	virtual void hessian_vector_product(double* const* const variables,
+	                                    const double* const* directions,
+	                                    double* result) const override;
+};
+
 //
 // 1-variable specialization
 //
 template <typename Functor, int D0>
-class AutoDiffTerm<Functor, D0> : public SizedTerm<D0> {
+class AutoDiffTerm<Functor, D0>
+    : public BatchedSizedTerm<AutoDiffTerm<Functor, D0>, Functor, D0> {
+	friend class BatchedSizedTerm<AutoDiffTerm, Functor, D0>;
+
    public:
 	template <typename... Args>
 	AutoDiffTerm(Args&&... args) : functor(std::forward<Args>(args)...) {}
@@ -269,7 +308,10 @@ class Functor2_to_1 {
 // 2-variable specialization
 //
 template <typename Functor, int D0, int D1>
-class AutoDiffTerm<Functor, D0, D1> : public SizedTerm<D0, D1> {
+class AutoDiffTerm<Functor, D0, D1>
+    : public BatchedSizedTerm<AutoDiffTerm<Functor, D0, D1>, Functor, D0, D1> {
+	friend class BatchedSizedTerm<AutoDiffTerm, Functor, D0, D1>;
+
    public:
 	template <typename... Args>
 	AutoDiffTerm(Args&&... args) : functor(std::forward<Args>(args)...) {}
@@ -444,7 +486,10 @@ class Functor3_to_1 {
 // 3-variable specialization
 //
 template <typename Functor, int D0, int D1, int D2>
-class AutoDiffTerm<Functor, D0, D1, D2> : public SizedTerm<D0, D1, D2> {
+class AutoDiffTerm<Functor, D0, D1, D2>
+    : public BatchedSizedTerm<AutoDiffTerm<Functor, D0, D1, D2>, Functor, D0, D1, D2> {
+	friend class BatchedSizedTerm<AutoDiffTerm, Functor, D0, D1, D2>;
+
    public:
 	template <typename... Args>
 	AutoDiffTerm(Args&&... args) : functor(std::forward<Args>(args)...) {}
@@ -623,7 +668,10 @@ class Functor4_to_1 {
 };
 
 template <typename Functor, int D0, int D1, int D2, int D3>
-class AutoDiffTerm<Functor, D0, D1, D2, D3> : public SizedTerm<D0, D1, D2, D3> {
+class AutoDiffTerm<Functor, D0, D1, D2, D3>
+    : public BatchedSizedTerm<AutoDiffTerm<Functor, D0, D1, D2, D3>, Functor, D0, D1, D2, D3> {
+	friend class BatchedSizedTerm<AutoDiffTerm, Functor, D0, D1, D2, D3>;
+
    public:
 	template <typename... Args>
 	AutoDiffTerm(Args&&... args) : functor(std::forward<Args>(args)...) {}
@@ -920,6 +968,99 @@ struct DualFunctorCaller<Functor, R> {
 	}
 };
 
+// Calls functor with dual numbers that hold W terms in lanes. variables[l]
+// are the variables of the term in lane l.
+//
+template <typename Functor, typename R, int W, int... D>
+struct LaneDualFunctorCaller;
+
+template <typename Functor, typename R, int W, int D0, int... DN>
+struct LaneDualFunctorCaller<Functor, R, W, D0, DN...> {
+	R call(const Functor& functor, double* const* const* variables) {
+		return call_internal(functor, variables, 0, 0);
+	}
+
+	template <typename... T>
+	R call_internal(const Functor& functor,
+	                double* const* const* variables,
+	                int var,
+	                int offset,
+	                T&... previous_arguments) {
+		R x[D0];
+		for (int i = 0; i < D0; ++i) {
+			Lanes<double, W> value;
+			for (int l = 0; l < W; ++l) {
+				value[l] = variables[l][var][i];
+			}
+			x[i] = value;
+			x[i].diff(i + offset);
+		}
+
+		LaneDualFunctorCaller<Functor, R, W, DN...> next_caller;
+		return next_caller.call_internal(
+		    functor, variables, var + 1, offset + D0, previous_arguments..., x);
+	}
+};
+
+template <typename Functor, typename R, int W>
+struct LaneDualFunctorCaller<Functor, R, W> {
+	template <typename... T>
+	R call_internal(const Functor& functor,
+	                double* const* const* variables,
+	                int var,
+	                int offset,
+	                T&... arguments) {
+		return functor(arguments...);
+	}
+};
+
+// Calls functor with nested dual numbers. The outer derivatives are with
+// respect to the variables and the inner derivative is in the given
+// direction, so that f.d(i).d(0) is the ith element of the
+// Hessian-vector product.
+//
+template <typename Functor, typename R, int... D>
+struct DirectionalDualFunctorCaller;
+
+template <typename Functor, typename R, int D0, int... DN>
+struct DirectionalDualFunctorCaller<Functor, R, D0, DN...> {
+	R call(const Functor& functor,
+	       double* const* const variables,
+	       const double* const* directions) {
+		return call_internal(functor, variables, directions, 0);
+	}
+
+	template <typename... T>
+	R call_internal(const Functor& functor,
+	                double* const* const variables,
+	                const double* const* directions,
+	                int offset,
+	                T&... previous_arguments) {
+		R x[D0];
+		for (int i = 0; i < D0; ++i) {
+			x[i] = (*variables)[i];
+			x[i].x().diff(0) = (*directions)[i];
+			x[i].diff(i + offset);
+		}
+
+		DirectionalDualFunctorCaller<Functor, R, DN...> next_caller;
+		return next_caller.call_internal(
+		    functor, variables + 1, directions + 1, offset + D0, previous_arguments..., x);
+	}
+};
+
+template <typename Functor, typename R>
+struct DirectionalDualFunctorCaller<Functor, R> {
+	template <typename... T>
+	R call_internal(const Functor& functor,
+	                double* const* const variables,
+	                const double* const* directions,
+	                int offset,
+	                T&... arguments) {
+		return functor(arguments...);
+	}
+};
+
 //
 // Extracts gradient from a dual number.
 //
@@ -945,10 +1086,78 @@ struct DualGradientExtractor<R> {
 	}
 };
 
+template <typename Derived, typename Functor, int... D>
+double BatchedSizedTerm<Derived, Functor, D...>::evaluate_batch(const Term* const* terms,
+                                                                 int number_of_terms,
+                                                                 double* const* const* variables,
+                                                                 double* gradients) const {
+	// Classes deriving from an AutoDiffTerm may have overloaded evaluate.
+	if (typeid(*this) != typeid(Derived)) {
+		return Term::evaluate_batch(terms, number_of_terms, variables, gradients);
+	}
+
+	constexpr int dimension = IntSum<D...>::value;
+	double value = 0;
+	int k = 0;
+
+	if constexpr (has_lane_evaluation<Functor>::value) {
+		static_assert(std::is_empty<Functor>::value,
+		              "Functors evaluated in lanes can not have data members.");
+		constexpr int W = default_lane_width;
+		typedef fadbad::F<Lanes<double, W>, dimension> LaneDual;
+		LaneDualFunctorCaller<Functor, LaneDual, W, D...> lane_caller;
+
+		// All terms have equal functors, so the first one is used for all lanes.
+		const auto& functor = static_cast<const Derived*>(terms[0])->functor;
+		for (; k + W <= number_of_terms; k += W) {
+			auto f = lane_caller.call(functor, variables + k);
+			for (int i = 0; i < dimension; ++i) {
+				const auto& derivative = f.d(i);
+				for (int l = 0; l < W; ++l) {
+					gradients[(k + l) * dimension + i] = derivative[l];
+				}
+			}
+			value += f.x().sum();
+		}
+	}
+
+	typedef fadbad::F<double, dimension> Dual;
+	DualFunctorCaller<Functor, Dual, D...> caller;
+	for (; k < number_of_terms; ++k) {
+		const auto& functor = static_cast<const Derived*>(terms[k])->functor;
+		auto f = caller.call(functor, variables[k]);
+		double* term_gradient = gradients + k * dimension;
+		for (int i = 0; i < dimension; ++i) {
+			term_gradient[i] = f.d(i);
+		}
+		value += f.x();
+	}
+	return value;
+}
+
+template <typename Derived, typename Functor, int... D>
+void BatchedSizedTerm<Derived, Functor, D...>::hessian_vector_product(
+    double* const* const variables, const double* const* directions, double* result) const {
+	// Classes deriving from an AutoDiffTerm may have overloaded evaluate.
+	if (typeid(*this) != typeid(Derived)) {
+		Term::hessian_vector_product(variables, directions, result);
+		return;
+	}
+
+	constexpr int dimension = IntSum<D...>::value;
+	typedef fadbad::F<fadbad::F<double, 1>, dimension> Dual;
+	DirectionalDualFunctorCaller<Functor, Dual, D...> caller;
+	auto f = caller.call(static_cast<const Derived*>(this)->functor, variables, directions);
+	for (int i = 0; i < dimension; ++i) {
+		result[i] = f.d(i).d(0);
+	}
+}
+
 template <typename Functor, int... D>
-class AutoDiffTerm : public SizedTerm<D...> {
+class AutoDiffTerm : public BatchedSizedTerm<AutoDiffTerm<Functor, D...>, Functor, D...> {
 	static_assert(sizeof...(D) > 0,
 	              "D cannot be empty. Sizes are required when creating AutoDiffTerm.");
+	friend class BatchedSizedTerm<AutoDiffTerm, Functor, D...>;
 
    public:
 	template <typename... Args>
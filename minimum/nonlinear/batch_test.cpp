@@ -0,0 +1,132 @@
+// Petter Strandmark.
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <catch.hpp>
+
+#include <minimum/nonlinear/auto_diff_term.h>
+#include <minimum/nonlinear/solver.h>
+#include <minimum/nonlinear/transformations.h>
+
+using namespace minimum::nonlinear;
+
+namespace {
+// Negative log-likelihood of the current data set for a
+// one-dimensional Gaussian distribution.
+struct NegLogLikelihood {
+	const std::vector<std::vector<double>>* data_sets;
+	const int* problem;
+
+	template <typename R>
+	R operator()(const R* const mu, const R* const sigma) const {
+		R value = 0;
+		for (auto sample : (*data_sets)[*problem]) {
+			R diff = (*mu - sample) / *sigma;
+			value += 0.5 * diff * diff + log(*sigma);
+		}
+		return value;
+	}
+};
+
+std::vector<std::vector<double>> create_data_sets(int number_of_problems) {
+	std::mt19937 engine(0);
+	std::normal_distribution<double> normal;
+	std::vector<std::vector<double>> data_sets(number_of_problems);
+	for (int i = 0; i < number_of_problems; ++i) {
+		double mu = i % 10 - 5.0;
+		double sigma = 1.0 + i % 3;
+		for (int j = 0; j < 50; ++j) {
+			data_sets[i].push_back(mu + sigma * normal(engine));
+		}
+	}
+	return data_sets;
+}
+
+BatchSolver create_solver(const std::vector<std::vector<double>>& data_sets) {
+	return BatchSolver(2, [&data_sets](Function* f, double* parameters, const int* problem) {
+		f->add_variable(&parameters[0], 1);
+		f->add_variable_with_change<GreaterThanZero>(&parameters[1], 1, 1);
+		f->add_term(std::make_shared<AutoDiffTerm<NegLogLikelihood, 1, 1>>(
+		                NegLogLikelihood{&data_sets, problem}),
+		            &parameters[0],
+		            &parameters[1]);
+	});
+}
+}  // namespace
+
+TEST_CASE("batch/gaussian") {
+	const int number_of_problems = 200;
+	auto data_sets = create_data_sets(number_of_problems);
+	auto batch = create_solver(data_sets);
+
+	LBFGSSolver solver;
+	solver.log_function = nullptr;
+	solver.maximum_iterations = 1000;
+
+	std::vector<double> x;
+	for (int i = 0; i < number_of_problems; ++i) {
+		x.push_back(0.0);
+		x.push_back(1.0);
+	}
+	auto initial_x = x;
+
+	batch.number_of_threads = 4;
+	auto results = batch.solve(solver, number_of_problems, &x);
+	REQUIRE(results.size() == number_of_problems);
+
+	for (int i = 0; i < number_of_problems; ++i) {
+		INFO("Problem " << i);
+		CHECK(results[i].exit_success());
+
+		// The maximum likelihood estimates.
+		double mean = 0;
+		for (auto sample : data_sets[i]) {
+			mean += sample;
+		}
+		mean /= data_sets[i].size();
+		double variance = 0;
+		for (auto sample : data_sets[i]) {
+			variance += (sample - mean) * (sample - mean);
+		}
+		variance /= data_sets[i].size();
+
+		CHECK(x[2 * i] == Approx(mean).epsilon(1e-6));
+		CHECK(x[2 * i + 1] == Approx(std::sqrt(variance)).epsilon(1e-6));
+		double value = data_sets[i].size() * (0.5 + 0.5 * std::log(variance));
+		CHECK(results[i].objective_value == Approx(value));
+	}
+
+	// One thread gives the same solutions.
+	auto serial_x = initial_x;
+	batch.number_of_threads = 1;
+	auto serial_results = batch.solve(solver, number_of_problems, &serial_x);
+	for (int i = 0; i < number_of_problems; ++i) {
+		CHECK(serial_results[i].exit_condition == results[i].exit_condition);
+		CHECK(serial_results[i].objective_value == results[i].objective_value);
+	}
+	CHECK(serial_x == x);
+}
+
+TEST_CASE("batch/empty") {
+	std::vector<std::vector<double>> data_sets;
+	auto batch = create_solver(data_sets);
+	LBFGSSolver solver;
+	std::vector<double> x;
+	CHECK(batch.solve(solver, 0, &x).empty());
+
+	x.resize(3);
+	CHECK_THROWS(batch.solve(solver, 1, &x));
+}
+
+TEST_CASE("batch/exception") {
+	BatchSolver batch(1, [](Function*, double*, const int*) {
+		throw std::runtime_error("Failure.");
+	});
+	batch.number_of_threads = 3;
+	LBFGSSolver solver;
+	std::vector<double> x(10, 1.0);
+	CHECK_THROWS_AS(batch.solve(solver, 10, &x), std::runtime_error);
+}
@@ -241,6 +241,11 @@ int main(int argc, char** argv) {
 		solver.maximum_iterations = 10;
 		// solver.lbfgs_history_size = 100;
 		solver.sparsity_mode = NewtonSolver::SparsityMode::SPARSE;
+		// Eliminate the points. Only the cameras are factorized.
+		solver.factorization_method = NewtonSolver::FactorizationMethod::SCHUR;
+		for (int i = 0; i < bal_problem.number_of_points(); ++i) {
+			solver.schur_eliminated_variables.push_back(bal_problem.mutable_points() + 3 * i);
+		}
 		solver.function_improvement_tolerance = 1e-5;
 		SolverResults results;
 		solver.solve(function, &results);
@@ -0,0 +1,97 @@
+// Measures gradient evaluations per second of a Lennard-Jones potential
+// whose terms are evaluated one at a time and in SIMD lanes, and checks
+// that both give the same gradient.
+//
+// The lane width depends on the instruction set the library is compiled
+// for, e.g. cmake -DCMAKE_CXX_FLAGS="-march=native".
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <minimum/core/check.h>
+#include <minimum/core/time.h>
+#include <minimum/nonlinear/auto_diff_term.h>
+#include <minimum/nonlinear/function.h>
+
+using namespace minimum::nonlinear;
+
+template <bool lanes>
+struct LennardJonesTerm {
+	static constexpr bool evaluate_in_lanes = lanes;
+
+	template <typename R>
+	R operator()(const R* const p1, const R* const p2) const {
+		R dx = p1[0] - p2[0];
+		R dy = p1[1] - p2[1];
+		R dz = p1[2] - p2[2];
+		R r2 = dx * dx + dy * dy + dz * dz;
+		R r6 = r2 * r2 * r2;
+		R r12 = r6 * r6;
+		return 1.0 / r12 - 2.0 / r6;
+	}
+};
+
+// Returns the gradient of the potential and prints the number of
+// evaluations per second.
+template <bool lanes>
+Eigen::VectorXd benchmark(vector<Eigen::Vector3d> points, int evaluations) {
+	Function potential;
+	potential.set_number_of_threads(1);
+	for (auto& point : points) {
+		potential.add_variable(&point[0], 3);
+	}
+	for (int i = 0; i < points.size(); ++i) {
+		for (int j = i + 1; j < points.size(); ++j) {
+			potential.add_term<AutoDiffTerm<LennardJonesTerm<lanes>, 3, 3>>(&points[i][0],
+			                                                                &points[j][0]);
+		}
+	}
+
+	Eigen::VectorXd x(potential.get_number_of_scalars());
+	potential.copy_user_to_global(&x);
+	Eigen::VectorXd gradient;
+	// The first evaluation allocates the storage.
+	potential.evaluate(x, &gradient);
+
+	double start_time = minimum::core::wall_time();
+	for (int i = 0; i < evaluations; ++i) {
+		potential.evaluate(x, &gradient);
+	}
+	double elapsed = minimum::core::wall_time() - start_time;
+
+	cout << setw(8) << (lanes ? "lanes" : "scalar") << ": " << setw(10) << fixed
+	     << setprecision(1) << evaluations * potential.get_number_of_terms() / elapsed / 1e6
+	     << " M terms/s." << endl;
+	return gradient;
+}
+
+int main(int argc, char* argv[]) {
+	int n = 400;
+	if (argc >= 2) {
+		n = stoi(argv[1]);
+	}
+	int evaluations = 20;
+
+	mt19937 engine(1);
+	normal_distribution<double> normal;
+	int side = int(ceil(pow(double(n), 1.0 / 3.0)));
+	vector<Eigen::Vector3d> points(n);
+	for (int i = 0; i < n; ++i) {
+		points[i][0] = i % side + 0.05 * normal(engine);
+		points[i][1] = (i / side) % side + 0.05 * normal(engine);
+		points[i][2] = (i / side) / side + 0.05 * normal(engine);
+	}
+
+	cout << n << " points, " << default_lane_width << " lanes." << endl;
+	auto scalar_gradient = benchmark<false>(points, evaluations);
+	auto lane_gradient = benchmark<true>(points, evaluations);
+
+	double difference = (scalar_gradient - lane_gradient).norm();
+	cout << "Gradient difference: " << scientific << difference << endl;
+	minimum_core_assert(difference <= 1e-9 * (1 + scalar_gradient.norm()));
+}
@@ -5,13 +5,17 @@
 #include <iomanip>
 #include <iostream>
 #include <stdexcept>
+#include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
 #include <unordered_set>
 
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
 
+#include <absl/container/btree_map.h>
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 
 #include <minimum/core/check.h>
@@ -29,7 +33,9 @@ struct AddedVariable {
 	int user_dimension;    // The dimension the Term object sees for evaluation.
 	int solver_dimension;  // The dimension of the variables the solver sees.
 	double* user_data;     // The pointer provided by the user.
-	size_t global_index;   // Global index into a vector of all scalars.
+	// Global index into a vector of all scalars. Updated lazily by
+	// Function::Implementation::update_global_indices.
+	mutable size_t global_index;
 	bool is_constant;      // Whether this variable is (currently) constant.
 	std::shared_ptr<ChangeOfVariables> change_of_variables;
 	mutable std::vector<double> temp_space;  // Used internally during evaluation.
@@ -65,6 +71,7 @@ class Function::Implementation {
 	Implementation(Function* function_interface);
 
 	// Implemenations of functions in the public interface.
+	double evaluate(const Eigen::VectorXd& x, Eigen::VectorXd* gradient) const;
 	double evaluate(const Eigen::VectorXd& x,
 	                Eigen::VectorXd* gradient,
 	                Eigen::MatrixXd* hessian) const;
@@ -78,9 +85,27 @@ class Function::Implementation {
 	void add_variable_internal(double* variable,
 	                           int dimension,
 	                           std::shared_ptr<ChangeOfVariables> change_of_variables = 0);
+	// Adds a new variable without checking whether it overlaps
+	// other variables. Returns its index.
+	std::size_t append_variable(double* variable,
+	                            int dimension,
+	                            std::shared_ptr<ChangeOfVariables> change_of_variables);
+	// Checks that the variables first, first + 1, ... do not overlap
+	// each other or any variable in ordered_variables and adds them to
+	// ordered_variables.
+	void add_ordered_variables(std::size_t first);
+
+	void add_terms(const std::vector<std::shared_ptr<const Term>>& terms,
+	               const std::vector<double*>& variables,
+	               const std::vector<int>& arguments);
 
 	void set_constant(double* variable, bool is_constant);
 
+	// Assigns global indices to all variables if they have changed. The
+	// variables are ordered first and the constants last.
+	void update_global_indices() const;
+	mutable bool global_indices_valid;
+
 	// Copies variables from a global vector x to the Function's
 	// local storage.
 	void copy_global_to_local(const Eigen::VectorXd& x) const;
@@ -102,7 +127,11 @@ class Function::Implementation {
 
 	// All variables added to the function.
 	std::vector<AddedVariable> variables;
-	std::map<double*, std::size_t> variables_map;
+	// Index into variables for every user pointer.
+	absl::flat_hash_map<double*, std::size_t> variables_map;
+	// The same, ordered by address. Used to check that variables do
+	// not overlap.
+	absl::btree_map<double*, std::size_t> ordered_variables;
 
 	// Each variable can have several dimensions. This member
 	// keeps track of the total number of scalars.
@@ -127,12 +156,47 @@ class Function::Implementation {
 	// Has to be mutable because the temporary storage
 	// needs to be written to.
 	mutable std::vector<std::vector<Eigen::VectorXd>> thread_gradient_scratch;
+	// One gradient per thread. Only allocated for the THREAD_BUFFERS schedule
+	// and the Hessian evaluations that need it.
 	mutable std::vector<Eigen::VectorXd> thread_gradient_storage;
+	void allocate_thread_gradient_storage() const;
 	// Temporary storage for the hessian.
 	typedef std::vector<std::vector<Eigen::MatrixXd>> HessianStorage;
 	mutable std::vector<HessianStorage> thread_hessian_scratch;
 	mutable std::vector<Eigen::MatrixXd> thread_dense_hessian_storage;
 
+	// Terms of the same type are grouped into batches for gradient
+	// evaluation. Batch b contains the terms batch_term_indices[k] for
+	// batch_start[b] <= k < batch_start[b + 1]. One virtual call evaluates
+	// the whole batch, in SIMD lanes if the terms support it.
+	//
+	// With the COLORED schedule, the batches color_start[c], ...,
+	// color_start[c + 1] - 1 have color c and no two of them share a
+	// variable.
+	static constexpr int max_batch_size = 64;
+	void create_gradient_schedule() const;
+	mutable GradientSchedule gradient_schedule;
+	mutable int number_of_colors;
+	mutable std::vector<int> color_start;
+	mutable std::vector<int> batch_start;
+	mutable std::vector<int> batch_term_indices;
+	mutable std::vector<const Term*> batch_terms;
+	mutable std::vector<double* const*> batch_variables;
+	// Gradients of all terms in a batch.
+	mutable std::vector<std::vector<double>> thread_batch_gradient;
+
+	// Calls fn(t, i, output) for every term i in the order of the gradient
+	// schedule. t is the thread number and fn adds the contribution of the
+	// term to output, which is either result itself or a copy belonging to
+	// the thread. Returns the sum of the return values of fn.
+	template <typename Fn>
+	double for_each_term(Eigen::VectorXd* result, Fn&& fn) const;
+
+	// Storage for the directions of the terms in Hessian-vector products.
+	// Constant variables use zero_direction.
+	mutable std::vector<std::vector<const double*>> thread_directions;
+	mutable std::vector<double> zero_direction;
+
 	typedef std::vector<Eigen::Triplet<double>> SparseHessianStorage;
 	mutable std::vector<SparseHessianStorage> thread_sparse_hessian_storage;
 
@@ -140,6 +204,25 @@ class Function::Implementation {
 	// was created.
 	mutable size_t number_of_hessian_elements;
 
+	// Positions in the values of the sparse Hessian created by
+	// create_sparse_hessian. The Hessian entries of term i are added to
+	// the values hessian_slots[hessian_slot_start[i]], ... in the order
+	// they are computed in evaluate. The slots are only valid while
+	// hessian_slot_nonzeros >= 0 and are invalidated by any change to the
+	// function. They are only used for matrices with the same sparsity
+	// pattern (hessian_slot_outer and hessian_slot_inner) as the one they
+	// were created for.
+	mutable std::vector<std::size_t> hessian_slot_start;
+	mutable std::vector<int> hessian_slots;
+	mutable std::ptrdiff_t hessian_slot_nonzeros;
+	mutable std::vector<int> hessian_slot_outer;
+	mutable std::vector<int> hessian_slot_inner;
+	void create_hessian_slots(const Eigen::SparseMatrix<double>& H) const;
+	bool has_hessian_slot_pattern(const Eigen::SparseMatrix<double>& H) const;
+	double evaluate_with_hessian_slots(const Eigen::VectorXd& x,
+	                                   Eigen::VectorXd* gradient,
+	                                   Eigen::SparseMatrix<double>* hessian) const;
+
 	Function* parent;
 };
 
@@ -160,14 +243,17 @@ void Function::Implementation::clear() {
 	terms.clear();
 	variables.clear();
 	variables_map.clear();
+	ordered_variables.clear();
 	number_of_scalars = 0;
 	number_of_constants = 0;
+	global_indices_valid = true;
 
 	thread_gradient_scratch.clear();
 	thread_gradient_storage.clear();
 	local_storage_allocated = false;
 
 	number_of_hessian_elements = 0;
+	hessian_slot_nonzeros = -1;
 
 #ifdef USE_OPENMP
 	number_of_threads = omp_get_max_threads();
@@ -184,30 +270,27 @@ Function& Function::operator=(const Function& org) {
 
 	this->hessian_is_enabled = org.hessian_is_enabled;
 	impl->constant = org.impl->constant;
+	reserve(org.impl->terms.size(), org.impl->variables.size());
 
-	// TODO: respect global order.
-	std::map<size_t, double*> user_variables;
-	for (const auto& added_variable : org.impl->variables_map) {
-		AddedVariable& var_info = org.impl->variables[added_variable.second];
-
-		impl->add_variable_internal(
-		    added_variable.first, var_info.user_dimension, var_info.change_of_variables);
-		user_variables[var_info.global_index] = added_variable.first;
+	// The variables are added in the same order, so they get the same
+	// indices.
+	for (const auto& added_variable : org.impl->variables) {
+		impl->add_variable_internal(added_variable.user_data,
+		                            added_variable.user_dimension,
+		                            added_variable.change_of_variables);
+		impl->variables.back().bounds = added_variable.bounds;
+		if (added_variable.is_constant) {
+			impl->set_constant(added_variable.user_data, true);
+		}
 	}
-	minimum_core_assert(org.impl->variables.size() == user_variables.size());
 	minimum_core_assert(get_number_of_variables() == org.get_number_of_variables());
 	minimum_core_assert(get_number_of_scalars() == org.get_number_of_scalars());
 
 	for (const auto& added_term : org.impl->terms) {
-		std::vector<double*> vars;
-		for (auto var : added_term.added_variables_indices) {
-			auto index = org.impl->variables[var].global_index;
-			minimum_core_assert(user_variables.find(index) != user_variables.end());
-			vars.push_back(user_variables[index]);
-		}
-		this->add_term(added_term.term, vars);
+		impl->terms.emplace_back();
+		impl->terms.back().term = added_term.term;
+		impl->terms.back().added_variables_indices = added_term.added_variables_indices;
 	}
-	minimum_core_assert(org.impl->variables.size() == user_variables.size());
 
 	return *this;
 }
@@ -223,23 +306,18 @@ Function& Function::operator+=(const Function& org) {
 		minimum_core_assert(!added_variable.change_of_variables);
 	}
 
-	// TODO: respect global order.
-	std::map<size_t, double*> user_variables;
-	for (const auto& added_variable : org.impl->variables_map) {
-		AddedVariable& var_info = org.impl->variables[added_variable.second];
-
+	for (const auto& added_variable : org.impl->variables) {
 		// No-op if the variable already exists.
-		impl->add_variable_internal(
-		    added_variable.first, var_info.user_dimension, var_info.change_of_variables);
-		user_variables[var_info.global_index] = added_variable.first;
+		impl->add_variable_internal(added_variable.user_data,
+		                            added_variable.user_dimension,
+		                            added_variable.change_of_variables);
 	}
 
+	impl->terms.reserve(impl->terms.size() + org.impl->terms.size());
 	for (auto const& added_term : org.impl->terms) {
 		std::vector<double*> vars;
 		for (auto var : added_term.added_variables_indices) {
-			auto index = org.impl->variables[var].global_index;
-			minimum_core_assert(user_variables.find(index) != user_variables.end());
-			vars.push_back(user_variables[index]);
+			vars.push_back(org.impl->variables[var].user_data);
 		}
 		this->add_term(added_term.term, vars);
 	}
@@ -256,15 +334,29 @@ void Function::add_variable(double* variable, int dimension) {
 	impl->add_variable_internal(variable, dimension);
 }
 
+void Function::reserve(size_t number_of_terms, size_t number_of_variables) {
+	impl->terms.reserve(number_of_terms);
+	impl->variables.reserve(number_of_variables);
+	impl->variables_map.reserve(number_of_variables);
+}
+
 size_t Function::get_variable_global_index(double* variable) const {
 	// Find the variable. This has to succeed.
 	auto itr = impl->variables_map.find(variable);
 	check(itr != impl->variables_map.end(),
 	      "Function::get_variable_global_index: variable not found.");
 
+	impl->update_global_indices();
 	return impl->variables[itr->second].global_index;
 }
 
+int Function::get_variable_solver_dimension(double* variable) const {
+	auto itr = impl->variables_map.find(variable);
+	check(itr != impl->variables_map.end(),
+	      "Function::get_variable_solver_dimension: variable not found.");
+	return impl->variables[itr->second].solver_dimension;
+}
+
 size_t Function::get_number_of_variables() const { return impl->variables.size(); }
 
 // Returns the current number of scalars the function contains.
@@ -322,26 +414,33 @@ void Function::Implementation::add_variable_internal(
 		}
 
 		return;
-	} else if (!variables_map.empty()) {
+	} else if (!ordered_variables.empty()) {
 		// The variable does not yet exist, check that
 		// it does not overlap any other.
-		auto elems = find_surrounding_elements(variables_map, variable);
+		auto elems = find_surrounding_elements(ordered_variables, variable);
 
 		auto succ = elems.second;
-		if (succ != variables_map.end()) {
+		if (succ != ordered_variables.end()) {
 			check(variable + dimension <= variables[succ->second].user_data, "Variables overlap.");
 		}
 
 		auto prev = elems.first;
-		if (prev != variables_map.end()) {
+		if (prev != ordered_variables.end()) {
 			const auto& prev_var = variables[prev->second];
 			check(prev_var.user_data + prev_var.user_dimension <= variable, "Variables overlap.");
 		}
 	}
 
+	auto index = append_variable(variable, dimension, change_of_variables);
+	ordered_variables.emplace(variable, index);
+}
+
+std::size_t Function::Implementation::append_variable(
+    double* variable, int dimension, std::shared_ptr<ChangeOfVariables> change_of_variables) {
 	variables.emplace_back();
 	AddedVariable& var_info = variables.back();
-	variables_map[variable] = variables.size() - 1;
+	std::size_t index = variables.size() - 1;
+	variables_map.emplace(variable, index);
 
 	var_info.user_data = variable;
 	var_info.is_constant = false;
@@ -362,9 +461,41 @@ void Function::Implementation::add_variable_internal(
 	// We need as much space as the dimension of x.
 	var_info.temp_space.resize(var_info.user_dimension);
 	// Give this variable a global index into a global
-	// state vector.
+	// state vector. The constants come after all variables,
+	// so their indices change if there are any.
 	var_info.global_index = number_of_scalars;
 	number_of_scalars += var_info.solver_dimension;
+	if (number_of_constants > 0) {
+		global_indices_valid = false;
+	}
+	return index;
+}
+
+void Function::Implementation::add_ordered_variables(std::size_t first) {
+	std::vector<std::pair<double*, std::size_t>> added;
+	added.reserve(variables.size() - first);
+	for (auto i = first; i < variables.size(); ++i) {
+		added.emplace_back(variables[i].user_data, i);
+	}
+	std::sort(added.begin(), added.end());
+
+	auto end_of = [this](const std::pair<double*, std::size_t>& entry) {
+		return entry.first + variables[entry.second].user_dimension;
+	};
+	for (std::size_t i = 0; i < added.size(); ++i) {
+		if (i + 1 < added.size()) {
+			check(end_of(added[i]) <= added[i + 1].first, "Variables overlap.");
+		}
+		auto succ = ordered_variables.upper_bound(added[i].first);
+		if (succ != ordered_variables.end()) {
+			check(end_of(added[i]) <= succ->first, "Variables overlap.");
+		}
+		if (succ != ordered_variables.begin()) {
+			auto prev = std::prev(succ);
+			check(end_of(*prev) <= added[i].first, "Variables overlap.");
+		}
+	}
+	ordered_variables.insert(added.begin(), added.end());
 }
 
 void Function::Implementation::set_constant(double* variable, bool is_constant) {
@@ -372,30 +503,47 @@ void Function::Implementation::set_constant(double* variable, bool is_constant)
 	auto itr = variables_map.find(variable);
 	check(itr != variables_map.end(), "Function::set_constant: variable not found.");
 
-	variables[itr->second].is_constant = is_constant;
+	auto& added_variable = variables[itr->second];
+	if (added_variable.is_constant == is_constant) {
+		return;
+	}
+	added_variable.is_constant = is_constant;
+	if (is_constant) {
+		this->number_of_scalars -= added_variable.solver_dimension;
+		this->number_of_constants += added_variable.solver_dimension;
+	} else {
+		this->number_of_scalars += added_variable.solver_dimension;
+		this->number_of_constants -= added_variable.solver_dimension;
+	}
 
-	// Recompute all global indices. Expensive!
-	this->number_of_scalars = 0;
-	for (auto& variable : variables) {
-		if (!variable.is_constant) {
-			// Give this variable a global index into a global
-			// state vector.
-			variable.global_index = this->number_of_scalars;
-			this->number_of_scalars += variable.solver_dimension;
-		}
+	// The global indices are recomputed when they are needed, so
+	// making many variables constant is cheap.
+	this->global_indices_valid = false;
+	this->local_storage_allocated = false;
+}
+
+void Function::Implementation::update_global_indices() const {
+	if (global_indices_valid) {
+		return;
 	}
 
-	this->number_of_constants = 0;
+	size_t scalar_index = 0;
+	size_t constant_index = this->number_of_scalars;
 	for (auto& variable : variables) {
-		if (variable.is_constant) {
-			// Give this variable a global index into a global
-			// state vector.
-			variable.global_index = this->number_of_scalars + this->number_of_constants;
-			this->number_of_constants += variable.solver_dimension;
+		// Give this variable a global index into a global
+		// state vector.
+		if (!variable.is_constant) {
+			variable.global_index = scalar_index;
+			scalar_index += variable.solver_dimension;
+		} else {
+			variable.global_index = constant_index;
+			constant_index += variable.solver_dimension;
 		}
 	}
+	minimum_core_assert(scalar_index == this->number_of_scalars);
+	minimum_core_assert(constant_index == this->number_of_scalars + this->number_of_constants);
 
-	this->local_storage_allocated = false;
+	global_indices_valid = true;
 }
 
 void Function::set_constant(double* variable, bool is_constant) {
@@ -438,6 +586,85 @@ void Function::add_term(std::shared_ptr<const Term> term, const std::vector<doub
 	}
 }
 
+void Function::add_terms(const std::vector<std::shared_ptr<const Term>>& terms,
+                         const std::vector<double*>& variables,
+                         const std::vector<int>& arguments) {
+	impl->add_terms(terms, variables, arguments);
+}
+
+void Function::Implementation::add_terms(const std::vector<std::shared_ptr<const Term>>& new_terms,
+                                         const std::vector<double*>& new_variables,
+                                         const std::vector<int>& arguments) {
+	local_storage_allocated = false;
+
+	std::size_t number_of_arguments = 0;
+	for (const auto& term : new_terms) {
+		number_of_arguments += term->number_of_variables();
+	}
+	check(number_of_arguments == arguments.size(),
+	      "Function::add_terms: incorrect number of arguments.");
+
+	// Otherwise the duplicates would be added as two variables and reported
+	// as overlapping.
+	std::vector<double*> sorted_variables(new_variables);
+	std::sort(sorted_variables.begin(), sorted_variables.end());
+	check(std::adjacent_find(sorted_variables.begin(), sorted_variables.end())
+	          == sorted_variables.end(),
+	      "Function::add_terms: the same variable occurs more than once in variables.");
+
+	const auto old_number_of_terms = terms.size();
+	const auto old_number_of_variables = variables.size();
+	const auto old_number_of_scalars = number_of_scalars;
+	const auto old_global_indices_valid = global_indices_valid;
+
+	// Only the variables themselves are looked up. The arguments are
+	// resolved with this table.
+	constexpr auto not_added = std::numeric_limits<std::size_t>::max();
+	std::vector<std::size_t> variable_index(new_variables.size(), not_added);
+	for (std::size_t i = 0; i < new_variables.size(); ++i) {
+		auto itr = variables_map.find(new_variables[i]);
+		if (itr != variables_map.end()) {
+			variable_index[i] = itr->second;
+		}
+	}
+
+	try {
+		terms.reserve(old_number_of_terms + new_terms.size());
+		auto argument = arguments.begin();
+		for (const auto& term : new_terms) {
+			terms.emplace_back();
+			auto& added_term = terms.back();
+			added_term.term = term;
+			added_term.added_variables_indices.reserve(term->number_of_variables());
+
+			for (int var = 0; var < term->number_of_variables(); ++var, ++argument) {
+				check(0 <= *argument && std::size_t(*argument) < new_variables.size(),
+				      "Function::add_terms: argument out of range.");
+				auto& index = variable_index[*argument];
+				if (index == not_added) {
+					index = append_variable(
+					    new_variables[*argument], term->variable_dimension(var), nullptr);
+				} else {
+					check(variables[index].user_dimension == term->variable_dimension(var),
+					      "Function::add_terms: variable dimension does not match term.");
+				}
+				added_term.added_variables_indices.emplace_back(index);
+			}
+		}
+
+		add_ordered_variables(old_number_of_variables);
+	} catch (...) {
+		terms.resize(old_number_of_terms);
+		for (auto i = old_number_of_variables; i < variables.size(); ++i) {
+			variables_map.erase(variables[i].user_data);
+		}
+		variables.resize(old_number_of_variables);
+		number_of_scalars = old_number_of_scalars;
+		global_indices_valid = old_global_indices_valid;
+		throw;
+	}
+}
+
 size_t Function::get_number_of_terms() const { return impl->terms.size(); }
 
 const BeginEndProvider<AddedTerm> Function::terms() const { return {impl->terms}; }
@@ -454,6 +681,7 @@ void Function::set_number_of_threads(int num) {
 
 void Function::Implementation::allocate_local_storage() const {
 	auto start_time = wall_time();
+	update_global_indices();
 
 	size_t max_arity = 1;
 	int max_variable_dimension = 1;
@@ -465,9 +693,7 @@ void Function::Implementation::allocate_local_storage() const {
 	}
 
 	this->thread_gradient_scratch.resize(this->number_of_threads);
-	this->thread_gradient_storage.resize(this->number_of_threads);
 	for (int t = 0; t < this->number_of_threads; ++t) {
-		this->thread_gradient_storage[t].resize(number_of_scalars + number_of_constants);
 		this->thread_gradient_scratch[t].resize(max_arity);
 		for (int var = 0; var < max_arity; ++var) {
 			this->thread_gradient_scratch[t][var].resize(max_variable_dimension);
@@ -486,6 +712,20 @@ void Function::Implementation::allocate_local_storage() const {
 		}
 	}
 
+	this->thread_directions.resize(this->number_of_threads);
+	for (auto& directions : thread_directions) {
+		directions.resize(max_arity);
+	}
+	this->zero_direction.assign(max_variable_dimension, 0.0);
+
+	create_gradient_schedule();
+	this->thread_gradient_storage.clear();
+	if (gradient_schedule == GradientSchedule::THREAD_BUFFERS) {
+		allocate_thread_gradient_storage();
+	}
+	// The variables or terms have changed.
+	hessian_slot_nonzeros = -1;
+
 	if (parent->hessian_is_enabled) {
 		this->thread_hessian_scratch.resize(this->number_of_threads);
 		for (int t = 0; t < this->number_of_threads; ++t) {
@@ -506,6 +746,155 @@ void Function::Implementation::allocate_local_storage() const {
 	parent->allocation_time += wall_time() - start_time;
 }
 
+void Function::Implementation::allocate_thread_gradient_storage() const {
+	this->thread_gradient_storage.resize(this->number_of_threads);
+	for (auto& storage : this->thread_gradient_storage) {
+		storage.resize(number_of_scalars + number_of_constants);
+	}
+}
+
+void Function::Implementation::create_gradient_schedule() const {
+	const int number_of_terms = static_cast<int>(terms.size());
+
+	// Give every type an index, in the order the types first appear.
+	std::unordered_map<std::type_index, int> type_indices;
+	std::vector<int> term_type(number_of_terms);
+	int max_term_dimension = 1;
+	for (int i = 0; i < number_of_terms; ++i) {
+		auto inserted = type_indices.emplace(typeid(*terms[i].term), int(type_indices.size()));
+		term_type[i] = inserted.first->second;
+
+		int dimension = 0;
+		for (auto index : terms[i].added_variables_indices) {
+			dimension += variables[index].user_dimension;
+		}
+		max_term_dimension = std::max(max_term_dimension, dimension);
+	}
+
+	// Color the terms so that no two terms of the same color share a
+	// variable. Colors are only useful if every color has enough batches to
+	// keep all threads busy, so the coloring is given up if it needs more
+	// than max_colors colors.
+	std::vector<int> term_color(number_of_terms, 0);
+	number_of_colors = 1;
+	if (number_of_threads == 1) {
+		gradient_schedule = GradientSchedule::SERIAL;
+	} else {
+		const int max_colors = number_of_terms / (number_of_threads * max_batch_size);
+		gradient_schedule = GradientSchedule::THREAD_BUFFERS;
+
+		// A variable in more terms than max_colors can not be colored.
+		std::vector<int> variable_terms(variables.size(), 0);
+		bool can_color = max_colors >= 1;
+		for (const auto& added_term : terms) {
+			for (auto index : added_term.added_variables_indices) {
+				if (!variables[index].is_constant && ++variable_terms[index] > max_colors) {
+					can_color = false;
+				}
+			}
+		}
+
+		if (can_color) {
+			// Greedy coloring. variable_colors[v] are the colors of the terms
+			// containing variable v so far.
+			std::vector<std::vector<int>> variable_colors(variables.size());
+			for (size_t v = 0; v < variables.size(); ++v) {
+				variable_colors[v].reserve(variable_terms[v]);
+			}
+			std::vector<char> color_taken(max_colors + 1, 0);
+			for (int i = 0; i < number_of_terms && can_color; ++i) {
+				const auto& indices = terms[i].added_variables_indices;
+				for (auto index : indices) {
+					for (auto color : variable_colors[index]) {
+						color_taken[color] = 1;
+					}
+				}
+				int color = 0;
+				while (color_taken[color]) {
+					color++;
+				}
+				for (auto index : indices) {
+					for (auto color : variable_colors[index]) {
+						color_taken[color] = 0;
+					}
+				}
+
+				if (color >= max_colors) {
+					can_color = false;
+				} else {
+					term_color[i] = color;
+					number_of_colors = std::max(number_of_colors, color + 1);
+					for (auto index : indices) {
+						if (!variables[index].is_constant) {
+							variable_colors[index].push_back(color);
+						}
+					}
+				}
+			}
+		}
+
+		if (can_color) {
+			gradient_schedule = GradientSchedule::COLORED;
+		} else {
+			std::fill(term_color.begin(), term_color.end(), 0);
+			number_of_colors = 1;
+		}
+	}
+
+	// Sort the terms by color and then by type.
+	std::vector<int> order(number_of_terms);
+	for (int i = 0; i < number_of_terms; ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+		return std::make_pair(term_color[i], term_type[i])
+		       < std::make_pair(term_color[j], term_type[j]);
+	});
+
+	batch_start.assign(1, 0);
+	color_start.assign(1, 0);
+	batch_term_indices.clear();
+	batch_terms.clear();
+	batch_variables.clear();
+	for (int k = 0; k < number_of_terms; ++k) {
+		int i = order[k];
+		batch_term_indices.push_back(i);
+		batch_terms.push_back(terms[i].term.get());
+		batch_variables.push_back(terms[i].temp_variables.data());
+
+		bool last_of_color = k + 1 == number_of_terms || term_color[order[k + 1]] != term_color[i];
+		bool last_of_type = last_of_color || term_type[order[k + 1]] != term_type[i];
+		if (last_of_type || k + 1 - batch_start.back() == max_batch_size) {
+			batch_start.push_back(k + 1);
+		}
+		if (last_of_color) {
+			color_start.push_back(int(batch_start.size()) - 1);
+		}
+	}
+	if (number_of_terms == 0) {
+		color_start.push_back(0);
+	}
+
+	this->thread_batch_gradient.resize(this->number_of_threads);
+	for (auto& batch_gradient : thread_batch_gradient) {
+		batch_gradient.resize(max_batch_size * max_term_dimension);
+	}
+}
+
+Function::GradientSchedule Function::get_gradient_schedule() const {
+	if (!impl->local_storage_allocated) {
+		impl->allocate_local_storage();
+	}
+	return impl->gradient_schedule;
+}
+
+int Function::get_number_of_gradient_colors() const {
+	if (!impl->local_storage_allocated) {
+		impl->allocate_local_storage();
+	}
+	return impl->number_of_colors;
+}
+
 void Function::print_timing_information(std::ostream& out) const {
 	out << "----------------------------------------------------\n";
 	out << "Function evaluations without gradient : " << evaluations_without_gradient << '\n';
@@ -602,6 +991,7 @@ void Function::create_sparse_hessian(Eigen::SparseMatrix<double>* H) const {
 	Implementation::SparseHessianStorage hessian_indices;
 	absl::flat_hash_set<std::pair<int, int>> hessian_indices_set;
 	impl->number_of_hessian_elements = 0;
+	impl->update_global_indices();
 
 	for (const auto& added_term : impl->terms) {
 		auto& indices = added_term.added_variables_indices;
@@ -639,11 +1029,81 @@ void Function::create_sparse_hessian(Eigen::SparseMatrix<double>* H) const {
 	H->setFromTriplets(hessian_indices.begin(), hessian_indices.end());
 	H->makeCompressed();
 
+	if (!impl->local_storage_allocated) {
+		impl->allocate_local_storage();
+	}
+	impl->create_hessian_slots(*H);
+
 	this->allocation_time += wall_time() - start_time;
 }
 
+void Function::Implementation::create_hessian_slots(const Eigen::SparseMatrix<double>& H) const {
+	const int number_of_terms = static_cast<int>(terms.size());
+
+	// Number of Hessian entries of every term.
+	hessian_slot_start.assign(number_of_terms + 1, 0);
+	for (int k = 0; k < number_of_terms; ++k) {
+		size_t dimension = 0;
+		for (auto index : terms[k].added_variables_indices) {
+			if (!variables[index].is_constant) {
+				dimension += variables[index].user_dimension;
+			}
+		}
+		hessian_slot_start[k + 1] = hessian_slot_start[k] + dimension * dimension;
+	}
+	hessian_slots.resize(hessian_slot_start.back());
+
+	const int* outer = H.outerIndexPtr();
+	const int* inner = H.innerIndexPtr();
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(this->number_of_threads)
+#endif
+	for (int k = 0; k < number_of_terms; ++k) {
+		const auto& indices = terms[k].added_variables_indices;
+		int* slot = &hessian_slots[hessian_slot_start[k]];
+		for (auto index0 : indices) {
+			if (variables[index0].is_constant) {
+				continue;
+			}
+			int global_offset0 = static_cast<int>(variables[index0].global_index);
+			for (auto index1 : indices) {
+				if (variables[index1].is_constant) {
+					continue;
+				}
+				int global_offset1 = static_cast<int>(variables[index1].global_index);
+				for (int i = 0; i < variables[index0].user_dimension; ++i) {
+					for (int j = 0; j < variables[index1].user_dimension; ++j) {
+						// Entry (global_i, global_j) is in column global_j.
+						int global_i = global_offset0 + i;
+						int global_j = global_offset1 + j;
+						auto position = std::lower_bound(
+						    inner + outer[global_j], inner + outer[global_j + 1], global_i);
+						minimum_core_assert(position != inner + outer[global_j + 1]
+						                    && *position == global_i);
+						*slot++ = static_cast<int>(position - inner);
+					}
+				}
+			}
+		}
+	}
+
+	hessian_slot_outer.assign(outer, outer + H.outerSize() + 1);
+	hessian_slot_inner.assign(inner, inner + H.nonZeros());
+	hessian_slot_nonzeros = H.nonZeros();
+}
+
+bool Function::Implementation::has_hessian_slot_pattern(const Eigen::SparseMatrix<double>& H) const {
+	if (hessian_slot_nonzeros < 0 || !H.isCompressed() || H.nonZeros() != hessian_slot_nonzeros
+	    || H.rows() != this->number_of_scalars || H.cols() != this->number_of_scalars) {
+		return false;
+	}
+	return std::equal(hessian_slot_outer.begin(), hessian_slot_outer.end(), H.outerIndexPtr())
+	       && std::equal(hessian_slot_inner.begin(), hessian_slot_inner.end(), H.innerIndexPtr());
+}
+
 void Function::Implementation::copy_global_to_local(const Eigen::VectorXd& x) const {
 	double start_time = wall_time();
+	update_global_indices();
 
 #ifdef USE_OPENMP
 #pragma omp parallel for num_threads(this->number_of_threads) if (variables.size() > 1000)
@@ -676,6 +1136,7 @@ void Function::copy_user_to_global(Eigen::VectorXd* x) const { impl->copy_user_t
 
 void Function::Implementation::copy_user_to_global(Eigen::VectorXd* x) const {
 	double start_time = wall_time();
+	update_global_indices();
 
 	x->resize(this->number_of_scalars);
 	for (const auto& var : variables) {
@@ -701,6 +1162,7 @@ void Function::copy_global_to_user(const Eigen::VectorXd& x) const { impl->copy_
 
 void Function::Implementation::copy_global_to_user(const Eigen::VectorXd& x) const {
 	double start_time = wall_time();
+	update_global_indices();
 
 	for (const auto& var : variables) {
 		double* data = var.user_data;
@@ -738,7 +1200,7 @@ void Function::Implementation::copy_user_to_local() const {
 }
 
 double Function::evaluate(const Eigen::VectorXd& x, Eigen::VectorXd* gradient) const {
-	return this->evaluate(x, gradient, reinterpret_cast<Eigen::MatrixXd*>(0));
+	return impl->evaluate(x, gradient);
 }
 
 double Function::evaluate(const Eigen::VectorXd& x,
@@ -747,12 +1209,274 @@ double Function::evaluate(const Eigen::VectorXd& x,
 	return impl->evaluate(x, gradient, hessian);
 }
 
+double Function::Implementation::evaluate(const Eigen::VectorXd& x,
+                                          Eigen::VectorXd* gradient) const {
+	parent->evaluations_with_gradient++;
+
+	if (!this->local_storage_allocated) {
+		this->allocate_local_storage();
+	}
+
+	// Copy values from the global vector x to the temporary storage
+	// used for evaluating the term.
+	this->copy_global_to_local(x);
+
+	double start_time = wall_time();
+
+	if (gradient->size() != this->number_of_scalars) {
+		gradient->resize(this->number_of_scalars);
+	}
+	gradient->setZero();
+	const bool use_thread_buffers = gradient_schedule == GradientSchedule::THREAD_BUFFERS;
+	if (use_thread_buffers) {
+		// Initialize each thread's global gradient.
+		for (int t = 0; t < this->number_of_threads; ++t) {
+			this->thread_gradient_storage[t].setZero();
+		}
+	}
+
+	double value = this->constant;
+
+#ifdef USE_OPENMP
+	// Each thread needs to store a specific error.
+	std::vector<std::exception_ptr> evaluation_errors(this->number_of_threads);
+#endif
+
+	// Go through and evaluate each batch of terms. The batches of one color
+	// are evaluated in parallel.
+	for (int c = 0; c < number_of_colors; ++c) {
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+ : value) num_threads(this->number_of_threads)
+#endif
+		for (int b = color_start[c]; b < color_start[c + 1]; ++b) {
+#ifdef USE_OPENMP
+			// The thread number calling this iteration.
+			int t = omp_get_thread_num();
+			// We need to catch all exceptions before leaving
+			// the loop body.
+			try {
+#else
+			int t = 0;
+#endif
+
+				int start = batch_start[b];
+				int size = batch_start[b + 1] - start;
+				auto& batch_gradient = this->thread_batch_gradient[t];
+				value += batch_terms[start]->evaluate_batch(
+				    &batch_terms[start], size, &batch_variables[start], batch_gradient.data());
+
+				// Put the gradients from the terms into the global gradient,
+				// or the thread's copy of it if threads may write to the
+				// same variables.
+				double* global_gradient = use_thread_buffers
+				                              ? this->thread_gradient_storage[t].data()
+				                              : gradient->data();
+				const double* term_gradient = batch_gradient.data();
+				for (int k = start; k < start + size; ++k) {
+					const auto& indices = terms[batch_term_indices[k]].added_variables_indices;
+					for (auto index : indices) {
+						const auto& variable = variables[index];
+						if (!variable.is_constant) {
+							size_t global_offset = variable.global_index;
+							if (variable.change_of_variables == nullptr) {
+								for (int i = 0; i < variable.user_dimension; ++i) {
+									global_gradient[global_offset + i] += term_gradient[i];
+								}
+							} else {
+								// Transform the gradient from user space to solver space.
+								variable.change_of_variables->update_gradient(
+								    &global_gradient[global_offset],
+								    &x[global_offset],
+								    term_gradient);
+							}
+						}
+						term_gradient += variable.user_dimension;
+					}
+				}
+
+#ifdef USE_OPENMP
+				// We need to catch all exceptions before leaving
+				// the loop body.
+			} catch (...) {
+				evaluation_errors[t] = std::current_exception();
+			}
+#endif
+		}
+	}
+
+#ifdef USE_OPENMP
+	// Now that we are outside the OpenMP block, we can
+	// rethrow exceptions.
+	for (auto itr = evaluation_errors.begin(); itr != evaluation_errors.end(); ++itr) {
+		if (!(*itr == std::exception_ptr())) {
+			std::rethrow_exception(*itr);
+		}
+	}
+#endif
+
+	parent->evaluate_with_hessian_time += wall_time() - start_time;
+	start_time = wall_time();
+
+	if (use_thread_buffers) {
+		// Sum the gradients from all threads.
+		for (int t = 0; t < this->number_of_threads; ++t) {
+			(*gradient) += this->thread_gradient_storage[t].segment(0, this->number_of_scalars);
+		}
+	}
+
+	parent->write_gradient_hessian_time += wall_time() - start_time;
+	return value;
+}
+
+template <typename Fn>
+double Function::Implementation::for_each_term(Eigen::VectorXd* result, Fn&& fn) const {
+	if (result->size() != this->number_of_scalars) {
+		result->resize(this->number_of_scalars);
+	}
+	result->setZero();
+	const bool use_thread_buffers = gradient_schedule == GradientSchedule::THREAD_BUFFERS;
+	if (use_thread_buffers) {
+		for (int t = 0; t < this->number_of_threads; ++t) {
+			this->thread_gradient_storage[t].setZero();
+		}
+	}
+
+	double value = 0;
+
+#ifdef USE_OPENMP
+	std::vector<std::exception_ptr> evaluation_errors(this->number_of_threads);
+#endif
+
+	for (int c = 0; c < number_of_colors; ++c) {
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+ : value) num_threads(this->number_of_threads)
+#endif
+		for (int b = color_start[c]; b < color_start[c + 1]; ++b) {
+#ifdef USE_OPENMP
+			int t = omp_get_thread_num();
+			try {
+#else
+			int t = 0;
+#endif
+				double* output = use_thread_buffers ? this->thread_gradient_storage[t].data()
+				                                    : result->data();
+				for (int k = batch_start[b]; k < batch_start[b + 1]; ++k) {
+					value += fn(t, batch_term_indices[k], output);
+				}
+#ifdef USE_OPENMP
+			} catch (...) {
+				evaluation_errors[t] = std::current_exception();
+			}
+#endif
+		}
+	}
+
+#ifdef USE_OPENMP
+	for (auto itr = evaluation_errors.begin(); itr != evaluation_errors.end(); ++itr) {
+		if (!(*itr == std::exception_ptr())) {
+			std::rethrow_exception(*itr);
+		}
+	}
+#endif
+
+	if (use_thread_buffers) {
+		for (int t = 0; t < this->number_of_threads; ++t) {
+			(*result) += this->thread_gradient_storage[t].segment(0, this->number_of_scalars);
+		}
+	}
+	return value;
+}
+
+void Function::hessian_vector_product(const Eigen::VectorXd& x,
+                                      const Eigen::VectorXd& v,
+                                      Eigen::VectorXd* result) const {
+	if (!impl->local_storage_allocated) {
+		impl->allocate_local_storage();
+	}
+	minimum_core_assert(v.size() == impl->number_of_scalars);
+
+	impl->copy_global_to_local(x);
+
+	double start_time = wall_time();
+	impl->for_each_term(result, [this, &v](int t, int i, double* output) {
+		const auto& term = impl->terms[i];
+		const auto& indices = term.added_variables_indices;
+		auto& directions = impl->thread_directions[t];
+		for (size_t var = 0; var < indices.size(); ++var) {
+			const auto& variable = impl->variables[indices[var]];
+			minimum_core_assert(!variable.change_of_variables,
+			                    "Change of variables not supported for Hessians");
+			if (variable.is_constant) {
+				directions[var] = impl->zero_direction.data();
+			} else {
+				directions[var] = &v[variable.global_index];
+			}
+		}
+
+		double* term_result = impl->thread_batch_gradient[t].data();
+		term.term->hessian_vector_product(&term.temp_variables[0], directions.data(), term_result);
+
+		for (auto index : indices) {
+			const auto& variable = impl->variables[index];
+			if (!variable.is_constant) {
+				for (int j = 0; j < variable.user_dimension; ++j) {
+					output[variable.global_index + j] += term_result[j];
+				}
+			}
+			term_result += variable.user_dimension;
+		}
+		return 0.0;
+	});
+	evaluate_with_hessian_time += wall_time() - start_time;
+}
+
+void Function::hessian_diagonal(const Eigen::VectorXd& x, Eigen::VectorXd* diagonal) const {
+	minimum_core_assert(hessian_is_enabled,
+	                    "Function::hessian_diagonal: Hessian computation is not enabled.");
+	if (!impl->local_storage_allocated) {
+		impl->allocate_local_storage();
+	}
+
+	impl->copy_global_to_local(x);
+
+	double start_time = wall_time();
+	impl->for_each_term(diagonal, [this](int t, int i, double* output) {
+		const auto& term = impl->terms[i];
+		const auto& indices = term.added_variables_indices;
+		auto& hessian = impl->thread_hessian_scratch[t];
+		term.term->evaluate(
+		    &term.temp_variables[0], &impl->thread_gradient_scratch[t], &hessian);
+
+		for (size_t var0 = 0; var0 < indices.size(); ++var0) {
+			const auto& variable = impl->variables[indices[var0]];
+			if (!variable.is_constant) {
+				minimum_core_assert(!variable.change_of_variables,
+				                    "Change of variables not supported for Hessians");
+				// The same variable may be used several times by a term.
+				for (size_t var1 = 0; var1 < indices.size(); ++var1) {
+					if (indices[var1] == indices[var0]) {
+						for (int j = 0; j < variable.user_dimension; ++j) {
+							output[variable.global_index + j] += hessian[var0][var1](j, j);
+						}
+					}
+				}
+			}
+		}
+		return 0.0;
+	});
+	evaluate_with_hessian_time += wall_time() - start_time;
+}
+
 double Function::Implementation::evaluate(const Eigen::VectorXd& x,
                                           Eigen::VectorXd* gradient,
                                           Eigen::MatrixXd* hessian) const {
+	if (!hessian) {
+		return evaluate(x, gradient);
+	}
+
 	parent->evaluations_with_gradient++;
 
-	minimum_core_assert(!hessian || parent->hessian_is_enabled,
+	minimum_core_assert(parent->hessian_is_enabled,
 	                    "Function::evaluate: Hessian computation is not enabled.");
 
 	if (!this->local_storage_allocated) {
@@ -760,18 +1484,17 @@ double Function::Implementation::evaluate(const Eigen::VectorXd& x,
 	}
 
 	double start_time = wall_time();
-	if (hessian) {
 #ifdef USE_OPENMP
-		thread_dense_hessian_storage.resize(this->number_of_threads);
+	thread_dense_hessian_storage.resize(this->number_of_threads);
 #else
-		thread_dense_hessian_storage.resize(1);
+	thread_dense_hessian_storage.resize(1);
 #endif
-		for (int t = 0; t < this->number_of_threads; ++t) {
-			thread_dense_hessian_storage[t].resize(static_cast<int>(this->number_of_scalars),
-			                                       static_cast<int>(this->number_of_scalars));
-			thread_dense_hessian_storage[t].setZero();
-		}
+	for (int t = 0; t < this->number_of_threads; ++t) {
+		thread_dense_hessian_storage[t].resize(static_cast<int>(this->number_of_scalars),
+		                                       static_cast<int>(this->number_of_scalars));
+		thread_dense_hessian_storage[t].setZero();
 	}
+	allocate_thread_gradient_storage();
 	parent->allocation_time += wall_time() - start_time;
 
 	// Copy values from the global vector x to the temporary storage
@@ -806,49 +1529,40 @@ double Function::Implementation::evaluate(const Eigen::VectorXd& x,
 		int t = 0;
 #endif
 
-			if (hessian) {
-				// Evaluate the term and put its gradient and hessian
-				// into local storage.
-				value += terms[i].term->evaluate(&terms[i].temp_variables[0],
-				                                 &this->thread_gradient_scratch[t],
-				                                 &this->thread_hessian_scratch[t]);
+			// Evaluate the term and put its gradient and hessian
+			// into local storage.
+			value += terms[i].term->evaluate(&terms[i].temp_variables[0],
+			                                 &this->thread_gradient_scratch[t],
+			                                 &this->thread_hessian_scratch[t]);
 
-				const auto& term = terms[i].term;
-				const auto& indices = terms[i].added_variables_indices;
-				// Put the hessian into the global hessian.
-				for (int var0 = 0; var0 < term->number_of_variables(); ++var0) {
-					if (!variables[indices[var0]].is_constant) {
-						minimum_core_assert(!variables[indices[var0]].change_of_variables,
-						                    "Change of variables not supported for Hessians");
-
-						size_t global_offset0 = variables[indices[var0]].global_index;
-						for (int var1 = 0; var1 < term->number_of_variables(); ++var1) {
-							size_t global_offset1 = variables[indices[var1]].global_index;
+			const auto& term = terms[i].term;
+			const auto& indices = terms[i].added_variables_indices;
+			// Put the hessian into the global hessian.
+			for (int var0 = 0; var0 < term->number_of_variables(); ++var0) {
+				if (!variables[indices[var0]].is_constant) {
+					minimum_core_assert(!variables[indices[var0]].change_of_variables,
+					                    "Change of variables not supported for Hessians");
 
-							if (!variables[indices[var1]].is_constant) {
-								const Eigen::MatrixXd& part_hessian =
-								    this->thread_hessian_scratch[t][var0][var1];
-								for (int i = 0; i < term->variable_dimension(var0); ++i) {
-									for (int j = 0; j < term->variable_dimension(var1); ++j) {
-										thread_dense_hessian_storage[t].coeffRef(
-										    i + global_offset0, j + global_offset1) +=
-										    part_hessian(i, j);
-									}
+					size_t global_offset0 = variables[indices[var0]].global_index;
+					for (int var1 = 0; var1 < term->number_of_variables(); ++var1) {
+						size_t global_offset1 = variables[indices[var1]].global_index;
+
+						if (!variables[indices[var1]].is_constant) {
+							const Eigen::MatrixXd& part_hessian =
+							    this->thread_hessian_scratch[t][var0][var1];
+							for (int i = 0; i < term->variable_dimension(var0); ++i) {
+								for (int j = 0; j < term->variable_dimension(var1); ++j) {
+									thread_dense_hessian_storage[t].coeffRef(
+									    i + global_offset0, j + global_offset1) +=
+									    part_hessian(i, j);
 								}
 							}
 						}
 					}
 				}
-
-			} else {
-				// Evaluate the term and put its gradient into local
-				// storage.
-				value += terms[i].term->evaluate(&terms[i].temp_variables[0],
-				                                 &this->thread_gradient_scratch[t]);
 			}
 
 			// Put the gradient from the term into the thread's global gradient.
-			const auto& indices = terms[i].added_variables_indices;
 			for (int var = 0; var < indices.size(); ++var) {
 				if (!variables[indices[var]].is_constant) {
 					if (variables[indices[var]].change_of_variables == nullptr) {
@@ -905,14 +1619,12 @@ double Function::Implementation::evaluate(const Eigen::VectorXd& x,
 		(*gradient) += this->thread_gradient_storage[t].segment(0, this->number_of_scalars);
 	}
 
-	if (hessian) {
-		// Create the global (dense) hessian.
-		hessian->resize(static_cast<int>(this->number_of_scalars),
-		                static_cast<int>(this->number_of_scalars));
-		hessian->setZero();
-		for (int t = 0; t < this->number_of_threads; ++t) {
-			(*hessian) += this->thread_dense_hessian_storage[t];
-		}
+	// Create the global (dense) hessian.
+	hessian->resize(static_cast<int>(this->number_of_scalars),
+	                static_cast<int>(this->number_of_scalars));
+	hessian->setZero();
+	for (int t = 0; t < this->number_of_threads; ++t) {
+		(*hessian) += this->thread_dense_hessian_storage[t];
 	}
 
 	parent->write_gradient_hessian_time += wall_time() - start_time;
@@ -938,6 +1650,12 @@ double Function::Implementation::evaluate(const Eigen::VectorXd& x,
 		this->allocate_local_storage();
 	}
 
+	// If the Hessian has the pattern created by create_sparse_hessian, the
+	// values can be written directly.
+	if (has_hessian_slot_pattern(*hessian)) {
+		return evaluate_with_hessian_slots(x, gradient, hessian);
+	}
+
 	double start_time = wall_time();
 #ifdef USE_OPENMP
 	thread_sparse_hessian_storage.resize(this->number_of_threads);
@@ -950,6 +1668,7 @@ double Function::Implementation::evaluate(const Eigen::VectorXd& x,
 		thread_sparse_hessian_storage[t].clear();
 	}
 	this->number_of_hessian_elements = 0;
+	allocate_thread_gradient_storage();
 
 	parent->allocation_time += wall_time() - start_time;
 
@@ -1081,6 +1800,144 @@ double Function::Implementation::evaluate(const Eigen::VectorXd& x,
 	return value;
 }
 
+double Function::Implementation::evaluate_with_hessian_slots(
+    const Eigen::VectorXd& x,
+    Eigen::VectorXd* gradient,
+    Eigen::SparseMatrix<double>* hessian) const {
+	// Copy values from the global vector x to the temporary storage
+	// used for evaluating the term.
+	this->copy_global_to_local(x);
+
+	double start_time = wall_time();
+
+	if (gradient->size() != this->number_of_scalars) {
+		gradient->resize(this->number_of_scalars);
+	}
+	gradient->setZero();
+	double* hessian_values = hessian->valuePtr();
+	std::fill(hessian_values, hessian_values + hessian->nonZeros(), 0.0);
+
+	// Terms of the same color do not share any variables and can write to
+	// the gradient and Hessian directly. Otherwise the gradient is
+	// accumulated per thread and the Hessian with atomic additions.
+	const bool use_thread_buffers = gradient_schedule == GradientSchedule::THREAD_BUFFERS;
+	if (use_thread_buffers) {
+		// Initialize each thread's global gradient.
+		for (int t = 0; t < this->number_of_threads; ++t) {
+			this->thread_gradient_storage[t].setZero();
+		}
+	}
+
+	double value = this->constant;
+
+#ifdef USE_OPENMP
+	// Each thread needs to store a specific error.
+	std::vector<std::exception_ptr> evaluation_errors(this->number_of_threads);
+#endif
+
+	for (int c = 0; c < number_of_colors; ++c) {
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+ : value) num_threads(this->number_of_threads)
+#endif
+		for (int b = color_start[c]; b < color_start[c + 1]; ++b) {
+#ifdef USE_OPENMP
+			// The thread number calling this iteration.
+			int t = omp_get_thread_num();
+			// We need to catch all exceptions before leaving
+			// the loop body.
+			try {
+#else
+			int t = 0;
+#endif
+
+				double* global_gradient = use_thread_buffers
+				                              ? this->thread_gradient_storage[t].data()
+				                              : gradient->data();
+				for (int k = batch_start[b]; k < batch_start[b + 1]; ++k) {
+					const auto& added_term = terms[batch_term_indices[k]];
+					const auto& indices = added_term.added_variables_indices;
+
+					// Evaluate the term and put its gradient and hessian
+					// into local storage.
+					value += added_term.term->evaluate(&added_term.temp_variables[0],
+					                                   &this->thread_gradient_scratch[t],
+					                                   &this->thread_hessian_scratch[t]);
+
+					const int* slot = &hessian_slots[hessian_slot_start[batch_term_indices[k]]];
+					for (int var0 = 0; var0 < indices.size(); ++var0) {
+						const auto& variable0 = variables[indices[var0]];
+						if (variable0.is_constant) {
+							continue;
+						}
+						minimum_core_assert(!variable0.change_of_variables,
+						                    "Change of variables not supported for sparse Hessian");
+
+						// Put the gradient from the term into the global gradient.
+						size_t global_offset = variable0.global_index;
+						for (int i = 0; i < variable0.user_dimension; ++i) {
+							global_gradient[global_offset + i] +=
+							    this->thread_gradient_scratch[t][var0][i];
+						}
+
+						// Put the hessian from the term into the global hessian.
+						for (int var1 = 0; var1 < indices.size(); ++var1) {
+							const auto& variable1 = variables[indices[var1]];
+							if (variable1.is_constant) {
+								continue;
+							}
+							const Eigen::MatrixXd& part_hessian =
+							    this->thread_hessian_scratch[t][var0][var1];
+							for (int i = 0; i < variable0.user_dimension; ++i) {
+								for (int j = 0; j < variable1.user_dimension; ++j) {
+									if (use_thread_buffers) {
+#ifdef USE_OPENMP
+#pragma omp atomic
+#endif
+										hessian_values[*slot] += part_hessian(i, j);
+									} else {
+										hessian_values[*slot] += part_hessian(i, j);
+									}
+									slot++;
+								}
+							}
+						}
+					}
+				}
+
+#ifdef USE_OPENMP
+				// We need to catch all exceptions before leaving
+				// the loop body.
+			} catch (...) {
+				evaluation_errors[t] = std::current_exception();
+			}
+#endif
+		}
+	}
+
+#ifdef USE_OPENMP
+	// Now that we are outside the OpenMP block, we can
+	// rethrow exceptions.
+	for (auto itr = evaluation_errors.begin(); itr != evaluation_errors.end(); ++itr) {
+		if (!(*itr == std::exception_ptr())) {
+			std::rethrow_exception(*itr);
+		}
+	}
+#endif
+
+	parent->evaluate_with_hessian_time += wall_time() - start_time;
+	start_time = wall_time();
+
+	if (use_thread_buffers) {
+		// Sum the gradients from all threads.
+		for (int t = 0; t < this->number_of_threads; ++t) {
+			(*gradient) += this->thread_gradient_storage[t].segment(0, this->number_of_scalars);
+		}
+	}
+
+	parent->write_gradient_hessian_time += wall_time() - start_time;
+	return value;
+}
+
 Interval<double> Function::evaluate(const std::vector<Interval<double>>& x) const {
 	return impl->evaluate(x);
 }
@@ -1198,6 +2055,7 @@ void Function::write_to_stream(std::ostream& out) const {
 	// matches.
 	out << TermFactory::fix_name(typeid(std::vector<std::map<double, int>>).name()) << endl;
 
+	impl->update_global_indices();
 	out << impl->terms.size() << endl;
 	out << impl->variables.size() << endl;
 	out << impl->number_of_scalars << endl;
@@ -1330,6 +2188,7 @@ std::vector<Interval<double>> Function::get_all_variable_bounds() const {
 	using namespace std;
 
 	vector<Interval<double>> bounds(get_number_of_scalars());
+	impl->update_global_indices();
 
 	for (const auto& added_variable : impl->variables) {
 		if (added_variable.bounds.empty()) {
@@ -108,6 +108,26 @@ class MINIMUM_NONLINEAR_API Function {
 		add_term(std::make_shared<MyTerm>(), {args...});
 	}
 
+	// Adds many terms at once. Term i is evaluated for the next
+	// terms[i]->number_of_variables() entries of arguments, which are
+	// indices into variables. For example,
+	//
+	//		f.add_terms({term1, term2}, {x, y, z}, {0, 1, 1, 2});
+	//
+	// adds term1 with x and y and term2 with y and z, if they both have
+	// two variables. Variables not already added are added with the
+	// dimensions required by the terms.
+	//
+	// Every variable is only looked up once and whether the new
+	// variables overlap is checked once for all of them. If an error
+	// occurs, nothing is added.
+	void add_terms(const std::vector<std::shared_ptr<const Term>>& terms,
+	               const std::vector<double*>& variables,
+	               const std::vector<int>& arguments);
+
+	// Reserves space before adding many terms and variables.
+	void reserve(size_t number_of_terms, size_t number_of_variables);
+
 	// Returns the current number of terms contained in the function.
 	size_t get_number_of_terms() const;
 
@@ -148,11 +168,18 @@ class MINIMUM_NONLINEAR_API Function {
 	// Hessian.
 	size_t get_variable_global_index(double* variable) const;
 
+	// Returns the number of scalars of a variable the solver sees,
+	// i.e. its dimension after any change of variables.
+	int get_variable_solver_dimension(double* variable) const;
+
 	// Sets a variable to be constant. In this case, it will not be
 	// part of the optimization problem.
 	//
 	// NOTE: After calling this function, the global indexing of
 	//       variables will change permanently.
+	//
+	// The global indices are recomputed once when they are next needed,
+	// so calling this for many variables is cheap.
 	void set_constant(double* variable, bool is_constant);
 
 	// Returns the current number of variables the function contains.
@@ -166,6 +193,24 @@ class MINIMUM_NONLINEAR_API Function {
 	// Default: number of cores available.
 	void set_number_of_threads(int num);
 
+	// How the threads add the gradients of the terms to the global gradient.
+	//
+	//  * SERIAL         -- only one thread is used.
+	//  * COLORED        -- the terms are colored so that terms of the same
+	//                      color share no variables. The terms of one color
+	//                      are evaluated in parallel and write directly to
+	//                      the global gradient.
+	//  * THREAD_BUFFERS -- every thread accumulates a full gradient and they
+	//                      are summed at the end. Used when the coloring
+	//                      needs too many colors, e.g. when a variable is
+	//                      present in a large fraction of the terms.
+	enum class GradientSchedule { SERIAL, COLORED, THREAD_BUFFERS };
+
+	// The schedule is chosen when the function is first evaluated after
+	// being changed.
+	GradientSchedule get_gradient_schedule() const;
+	int get_number_of_gradient_colors() const;
+
 	// Evaluation using the data in the user-provided space.
 	double evaluate() const;
 
@@ -181,13 +226,27 @@ class MINIMUM_NONLINEAR_API Function {
 	                Eigen::VectorXd* gradient,
 	                Eigen::MatrixXd* hessian) const;
 
-	// Same functionality as above, but for a sparse Hessian.
+	// Same functionality as above, but for a sparse Hessian. If the
+	// Hessian was created by create_sparse_hessian (and the function has not
+	// changed since), its values are overwritten in place without changing
+	// the sparsity pattern.
 	double evaluate(const Eigen::VectorXd& x,
 	                Eigen::VectorXd* gradient,
 	                Eigen::SparseMatrix<double>* hessian) const;
 
 	Interval<double> evaluate(const std::vector<Interval<double>>& x) const;
 
+	// Computes the product of the Hessian at the point x with the vector v
+	// without forming the Hessian. Only uses memory proportional to the
+	// number of scalars.
+	void hessian_vector_product(const Eigen::VectorXd& x,
+	                            const Eigen::VectorXd& v,
+	                            Eigen::VectorXd* result) const;
+
+	// Computes the diagonal of the Hessian at the point x without forming
+	// the Hessian.
+	void hessian_diagonal(const Eigen::VectorXd& x, Eigen::VectorXd* diagonal) const;
+
 	// Copies variables from a global vector x to the storage
 	// provided by the user.
 	void copy_global_to_user(const Eigen::VectorXd& x) const;
@@ -895,3 +895,334 @@ TEST_CASE("variable_bounds") {
 	f.set_variable_bounds(y, {});
 	CHECK(f.get_variable_bounds(y).empty());
 }
+
+class SquareTerm : public SizedTerm<1> {
+   public:
+	virtual double evaluate(double* const* const variables) const {
+		return variables[0][0] * variables[0][0];
+	}
+
+	virtual double evaluate(double* const* const variables,
+	                        std::vector<Eigen::VectorXd>* gradient) const {
+		(*gradient)[0][0] = 2 * variables[0][0];
+		return evaluate(variables);
+	}
+
+	virtual double evaluate(double* const* const variables,
+	                        std::vector<Eigen::VectorXd>* gradient,
+	                        std::vector<std::vector<Eigen::MatrixXd>>* hessian) const {
+		(*hessian)[0][0](0, 0) = 2;
+		return evaluate(variables, gradient);
+	}
+};
+
+TEST_CASE("batched_gradient") {
+	// Interleaved terms of different types, more than fit in one batch.
+	const int n = 150;
+	std::vector<double> xx(2 * n);
+	std::vector<double> x(n);
+	std::vector<double> y(n);
+	Function f;
+	for (int i = 0; i < n; ++i) {
+		xx[2 * i] = 0.1 * i;
+		xx[2 * i + 1] = 1.0 - 0.05 * i;
+		x[i] = 1.0 + 0.1 * i;
+		y[i] = 2.0 + 0.01 * i;
+		f.add_term(make_differentiable<2>(Term1{}), &xx[2 * i]);
+		f.add_term(make_differentiable<1, 1>(Term2{}), &x[i], &y[(i + 1) % n]);
+		f.add_term(std::make_shared<SquareTerm>(), &x[(i + 7) % n]);
+	}
+	f.set_constant(&y[3], true);
+
+	Eigen::VectorXd point;
+	f.copy_user_to_global(&point);
+	Eigen::VectorXd gradient;
+	double value = f.evaluate(point, &gradient);
+
+	// The dense Hessian evaluation evaluates every term separately.
+	Eigen::VectorXd expected_gradient;
+	Eigen::MatrixXd hessian;
+	double expected_value = f.evaluate(point, &expected_gradient, &hessian);
+
+	CHECK(value == Approx(expected_value));
+	REQUIRE(gradient.size() == expected_gradient.size());
+	for (int i = 0; i < gradient.size(); ++i) {
+		CHECK(gradient[i] == Approx(expected_gradient[i]));
+	}
+	CHECK(gradient[f.get_variable_global_index(&xx[0])] == Approx(1 + 1.4));
+}
+
+TEST_CASE("gradient_schedule") {
+	// A chain of terms, where every variable is in two terms.
+	const int n = 1000;
+	std::vector<double> x(n + 1);
+	double shared = 1.0;
+	Function f;
+	for (int i = 0; i <= n; ++i) {
+		x[i] = 1.0 + 0.001 * i;
+	}
+	for (int i = 0; i < n; ++i) {
+		f.add_term(make_differentiable<1, 1>(Term2{}), &x[i], &x[i + 1]);
+	}
+
+	Eigen::VectorXd point;
+	f.copy_user_to_global(&point);
+	Eigen::VectorXd expected_gradient;
+	Eigen::MatrixXd hessian;
+	double expected_value = f.evaluate(point, &expected_gradient, &hessian);
+
+	auto check_gradient = [&]() {
+		Eigen::VectorXd gradient;
+		CHECK(f.evaluate(point, &gradient) == Approx(expected_value));
+		REQUIRE(gradient.size() == expected_gradient.size());
+		for (int i = 0; i < gradient.size(); ++i) {
+			CHECK(gradient[i] == Approx(expected_gradient[i]));
+		}
+	};
+
+	f.set_number_of_threads(1);
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::SERIAL);
+	check_gradient();
+
+#ifdef USE_OPENMP
+	f.set_number_of_threads(4);
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::COLORED);
+	CHECK(f.get_number_of_gradient_colors() == 2);
+	check_gradient();
+
+	// A variable in every term can not be colored.
+	for (int i = 0; i < n; ++i) {
+		f.add_term(std::make_shared<SquareTerm>(), &shared);
+	}
+	f.copy_user_to_global(&point);
+	expected_value = f.evaluate(point, &expected_gradient, &hessian);
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::THREAD_BUFFERS);
+	check_gradient();
+
+	// Unless it is constant.
+	f.set_constant(&shared, true);
+	f.copy_user_to_global(&point);
+	expected_value = f.evaluate(point, &expected_gradient, &hessian);
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::COLORED);
+	check_gradient();
+#endif
+}
+
+TEST_CASE("sparse_hessian_in_place") {
+	const int n = 1000;
+	std::vector<double> xx(2 * n);
+	std::vector<double> x(n + 1);
+	double shared = 1.5;
+	Function f;
+	for (int i = 0; i <= n; ++i) {
+		x[i] = 1.0 + 0.001 * i;
+	}
+	for (int i = 0; i < n; ++i) {
+		xx[2 * i] = 0.01 * i;
+		xx[2 * i + 1] = 1.0 - 0.01 * i;
+		f.add_term(make_differentiable<2>(Term1{}), &xx[2 * i]);
+		f.add_term(make_differentiable<1, 1>(Term2{}), &x[i], &x[i + 1]);
+	}
+
+	auto check_hessian = [&]() {
+		Eigen::VectorXd point;
+		f.copy_user_to_global(&point);
+		Eigen::VectorXd expected_gradient;
+		Eigen::MatrixXd expected_hessian;
+		double expected_value = f.evaluate(point, &expected_gradient, &expected_hessian);
+
+		Eigen::SparseMatrix<double> hessian;
+		f.create_sparse_hessian(&hessian);
+		auto nonzeros = hessian.nonZeros();
+		const double* values = hessian.valuePtr();
+		Eigen::VectorXd gradient;
+		for (int repetition = 0; repetition < 2; ++repetition) {
+			CHECK(f.evaluate(point, &gradient, &hessian) == Approx(expected_value));
+			// The pattern is not changed.
+			CHECK(hessian.nonZeros() == nonzeros);
+			CHECK(hessian.valuePtr() == values);
+			CHECK((gradient - expected_gradient).norm() < 1e-9);
+			CHECK((Eigen::MatrixXd(hessian) - expected_hessian).norm() < 1e-9);
+		}
+
+		// A matrix with the same size and number of non-zeros but another
+		// pattern can not use the slots.
+		std::vector<Eigen::Triplet<double>> entries;
+		for (int k = 0; k < nonzeros; ++k) {
+			entries.emplace_back(k % point.size(), k / point.size(), 1.0);
+		}
+		Eigen::SparseMatrix<double> other(point.size(), point.size());
+		other.setFromTriplets(entries.begin(), entries.end());
+		REQUIRE(other.nonZeros() == nonzeros);
+		CHECK(f.evaluate(point, &gradient, &other) == Approx(expected_value));
+		CHECK((Eigen::MatrixXd(other) - expected_hessian).norm() < 1e-9);
+	};
+
+	f.set_number_of_threads(1);
+	check_hessian();
+#ifdef USE_OPENMP
+	f.set_number_of_threads(4);
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::COLORED);
+	check_hessian();
+
+	for (int i = 0; i < n; ++i) {
+		f.add_term(make_differentiable<1, 1>(Term2{}), &x[i], &shared);
+	}
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::THREAD_BUFFERS);
+	check_hessian();
+#endif
+}
+
+TEST_CASE("hessian_vector_product") {
+	const int n = 200;
+	std::vector<double> xx(2 * n);
+	std::vector<double> x(n + 1);
+	double z[3] = {1.0, 2.0, 3.0};
+	double w[2] = {3.0, 4.0};
+	double shared = 1.5;
+	Function f;
+	for (int i = 0; i <= n; ++i) {
+		x[i] = 1.0 + 0.001 * i;
+	}
+	for (int i = 0; i < n; ++i) {
+		xx[2 * i] = 0.01 * i;
+		xx[2 * i + 1] = 1.0 - 0.01 * i;
+		f.add_term(make_differentiable<2>(Term1{}), &xx[2 * i]);
+		f.add_term(make_differentiable<1, 1>(Term2{}), &x[i], &x[i + 1]);
+		// Uses the default implementation in Term.
+		f.add_term(std::make_shared<SquareTerm>(), &x[(i + 7) % n]);
+	}
+	f.add_term(make_differentiable<3>(Single3{}), z);
+	f.add_term(make_differentiable<3, 2>(Mixed3_2{}), z, w);
+	// The same variable twice in one term.
+	f.add_term(make_differentiable<1, 1>(Term2{}), &shared, &shared);
+	f.set_constant(&x[5], true);
+
+	auto check_products = [&]() {
+		Eigen::VectorXd point;
+		f.copy_user_to_global(&point);
+		Eigen::VectorXd gradient;
+		Eigen::MatrixXd hessian;
+		f.evaluate(point, &gradient, &hessian);
+
+		Eigen::VectorXd v(point.size());
+		for (int i = 0; i < v.size(); ++i) {
+			v[i] = std::sin(1.0 + i);
+		}
+		Eigen::VectorXd Hv;
+		f.hessian_vector_product(point, v, &Hv);
+		REQUIRE(Hv.size() == point.size());
+		CHECK((Hv - hessian * v).norm() < 1e-9 * (1 + Hv.norm()));
+
+		Eigen::VectorXd diagonal;
+		f.hessian_diagonal(point, &diagonal);
+		REQUIRE(diagonal.size() == point.size());
+		CHECK((diagonal - hessian.diagonal()).norm() < 1e-9 * (1 + diagonal.norm()));
+	};
+
+	f.set_number_of_threads(1);
+	check_products();
+#ifdef USE_OPENMP
+	f.set_number_of_threads(4);
+	check_products();
+	for (int i = 0; i < n; ++i) {
+		f.add_term(make_differentiable<1, 1>(Term2{}), &x[i], &shared);
+	}
+	CHECK(f.get_gradient_schedule() == Function::GradientSchedule::THREAD_BUFFERS);
+	check_products();
+#endif
+}
+
+TEST_CASE("add_terms") {
+	const int n = 100;
+	std::vector<double> x(n + 1);
+	std::vector<double> xx(2 * n);
+	for (int i = 0; i <= n; ++i) {
+		x[i] = 1.0 + 0.01 * i;
+	}
+	for (int i = 0; i < 2 * n; ++i) {
+		xx[i] = 0.1 * i;
+	}
+	auto term1 = make_differentiable<2>(Term1{});
+	auto term2 = make_differentiable<1, 1>(Term2{});
+
+	Function expected;
+	Function f;
+	f.reserve(2 * n, 2 * n + 1);
+	std::vector<std::shared_ptr<const Term>> terms;
+	std::vector<double*> variables;
+	std::vector<int> arguments;
+	for (int i = 0; i <= n; ++i) {
+		variables.push_back(&x[i]);
+	}
+	for (int i = 0; i < n; ++i) {
+		expected.add_term(term2, &x[i], &x[i + 1]);
+		expected.add_term(term1, &xx[2 * i]);
+
+		terms.push_back(term2);
+		arguments.push_back(i);
+		arguments.push_back(i + 1);
+		terms.push_back(term1);
+		variables.push_back(&xx[2 * i]);
+		arguments.push_back(static_cast<int>(variables.size()) - 1);
+	}
+	f.add_terms(terms, variables, arguments);
+
+	CHECK(f.get_number_of_terms() == expected.get_number_of_terms());
+	CHECK(f.get_number_of_variables() == expected.get_number_of_variables());
+	REQUIRE(f.get_number_of_scalars() == expected.get_number_of_scalars());
+	for (int i = 0; i <= n; ++i) {
+		CHECK(f.get_variable_global_index(&x[i]) == expected.get_variable_global_index(&x[i]));
+	}
+
+	Eigen::VectorXd point;
+	f.copy_user_to_global(&point);
+	Eigen::VectorXd gradient, expected_gradient;
+	CHECK(f.evaluate(point, &gradient) == Approx(expected.evaluate(point, &expected_gradient)));
+	CHECK((gradient - expected_gradient).norm() < 1e-10);
+
+	// Errors leave the function unchanged.
+	double y[3] = {1, 2, 3};
+	CHECK_THROWS(f.add_terms({term1, term2}, {&y[0], &y[1]}, {0, 0, 1}));
+	CHECK_THROWS(f.add_terms({term2, term1}, {&y[0], &xx[1]}, {0, 0, 1}));
+	CHECK_THROWS(f.add_terms({term2}, {&y[0]}, {0, 1}));
+	CHECK_THROWS(f.add_terms({term2}, {&x[0], &xx[0]}, {0, 1}));
+	CHECK_THROWS_WITH(f.add_terms({term2}, {&y[0], &y[0]}, {0, 1}),
+	                  Catch::Contains("more than once"));
+	CHECK(f.get_number_of_terms() == expected.get_number_of_terms());
+	CHECK(f.get_number_of_variables() == expected.get_number_of_variables());
+	f.add_variable(&y[1], 2);
+	CHECK_THROWS(f.add_variable(&y[0], 2));
+}
+
+TEST_CASE("set_constant_many") {
+	const int n = 1000;
+	std::vector<double> x(n);
+	Function f;
+	for (int i = 0; i < n; ++i) {
+		x[i] = i;
+		f.add_variable(&x[i], 1);
+	}
+	for (int i = 0; i < n; i += 2) {
+		f.set_constant(&x[i], true);
+	}
+	CHECK(f.get_number_of_scalars() == n / 2);
+	for (int i = 1; i < n; i += 2) {
+		CHECK(f.get_variable_global_index(&x[i]) == i / 2);
+	}
+
+	// Variables added later are placed before the constants.
+	double y = 7;
+	f.add_variable(&y, 1);
+	CHECK(f.get_variable_global_index(&y) == n / 2);
+	f.set_constant(&x[0], false);
+	CHECK(f.get_variable_global_index(&x[0]) == 0);
+	CHECK(f.get_variable_global_index(&y) == n / 2 + 1);
+
+	Eigen::VectorXd point;
+	f.copy_user_to_global(&point);
+	REQUIRE(point.size() == n / 2 + 2);
+	CHECK(point[0] == 0);
+	CHECK(point[1] == 1);
+	CHECK(point[n / 2 + 1] == 7);
+}
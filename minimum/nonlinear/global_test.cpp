@@ -217,6 +217,49 @@ TEST_CASE("Constant variable") {
 	}
 }
 
+TEST_CASE("global_optimization/parallel") {
+	// One constant variable, so the copies of the function used by the
+	// threads must keep it constant.
+	double x[] = {2.0, 2.0};
+	double z = 2.0;
+	double y = 1.0;
+	Function f;
+	f.add_term(std::make_shared<IntervalTerm<SimpleFunction2, 2>>(), x);
+	f.add_term(std::make_shared<IntervalTerm<SimpleFunction1_1, 1, 1>>(), &z, &y);
+	f.set_constant(&y, true);
+	std::vector<Interval<double>> box = {{-10.0, 9.0}, {-8.0, 7.0}, {-5.0, 6.0}};
+
+	GlobalSolver solver;
+	solver.maximum_iterations = 100000;
+	solver.argument_improvement_tolerance = 0;
+	solver.function_improvement_tolerance = 1e-10;
+	solver.number_of_threads = 4;
+	std::stringstream info_buffer;
+	solver.log_function = [&info_buffer](const std::string& str) {
+		info_buffer << str << std::endl;
+	};
+	SolverResults results;
+	auto interval = solver.solve_global(f, box, &results);
+	INFO(info_buffer.str());
+	INFO(results);
+	REQUIRE(interval.size() == 3);
+	CHECK(results.exit_condition == SolverResults::FUNCTION_TOLERANCE);
+	double ground_truth = 3.0;
+	CHECK(results.optimum_lower <= ground_truth);
+	CHECK(ground_truth <= results.optimum_upper);
+	CHECK(std::abs(x[0]) <= 1e-4);
+	CHECK(std::abs(x[1]) <= 1e-4);
+	CHECK(std::abs(z) <= 1e-4);
+	CHECK(y == 1.0);
+
+	REQUIRE(results.boxes_per_thread.size() == 4);
+	int boxes = 0;
+	for (auto b : results.boxes_per_thread) {
+		boxes += b;
+	}
+	CHECK(boxes > 10);
+}
+
 template <typename Functor, int dimension>
 void run_test(double* x,
               double distance_from_start = 1.0,
@@ -0,0 +1,260 @@
+// Petter Strandmark.
+#pragma once
+// Lanes<R, W> holds W values and applies every operation to all of them.
+// It is used as the value type of fadbad::F so that W terms are
+// differentiated at once. The storage is a fixed-size Eigen array, so each
+// operation becomes one or a few packet instructions (SSE2, AVX2 or AVX-512
+// depending on the flags the library is compiled with, e.g. -march=native).
+//
+// Lanes has no comparison operators. Code that branches on values cannot be
+// evaluated in lanes, since the lanes may take different branches.
+
+#include <Eigen/Core>
+#include <fadbad.h>
+
+namespace minimum {
+namespace nonlinear {
+
+// Number of doubles in one SIMD register.
+#if defined(__AVX512F__)
+constexpr int default_lane_width = 8;
+#elif defined(__AVX__)
+constexpr int default_lane_width = 4;
+#else
+constexpr int default_lane_width = 2;
+#endif
+
+template <typename R, int W>
+class Lanes {
+   public:
+	typedef R Scalar;
+	typedef Eigen::Array<R, W, 1> Array;
+
+	Lanes() {}
+
+	Lanes(R value) : values(Array::Constant(value)) {}
+
+	template <typename Derived>
+	Lanes(const Eigen::ArrayBase<Derived>& values) : values(values) {}
+
+	R& operator[](int lane) { return values[lane]; }
+	const R& operator[](int lane) const { return values[lane]; }
+
+	const Array& array() const { return values; }
+
+	R sum() const { return values.sum(); }
+
+	Lanes operator+() const { return *this; }
+	Lanes operator-() const { return Lanes(-values); }
+
+	Lanes& operator+=(const Lanes& rhs) {
+		values += rhs.values;
+		return *this;
+	}
+	Lanes& operator-=(const Lanes& rhs) {
+		values -= rhs.values;
+		return *this;
+	}
+	Lanes& operator*=(const Lanes& rhs) {
+		values *= rhs.values;
+		return *this;
+	}
+	Lanes& operator/=(const Lanes& rhs) {
+		values /= rhs.values;
+		return *this;
+	}
+	Lanes& operator+=(const R& rhs) {
+		values += rhs;
+		return *this;
+	}
+	Lanes& operator-=(const R& rhs) {
+		values -= rhs;
+		return *this;
+	}
+	Lanes& operator*=(const R& rhs) {
+		values *= rhs;
+		return *this;
+	}
+	Lanes& operator/=(const R& rhs) {
+		values /= rhs;
+		return *this;
+	}
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+   private:
+	Array values;
+};
+
+// The scalar arguments below are not deduced, so that integers and other
+// arithmetic types are converted to R.
+
+template <typename R, int W>
+Lanes<R, W> operator+(Lanes<R, W> lhs, const Lanes<R, W>& rhs) {
+	return lhs += rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator+(Lanes<R, W> lhs, const typename Lanes<R, W>::Scalar& rhs) {
+	return lhs += rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator+(const typename Lanes<R, W>::Scalar& lhs, Lanes<R, W> rhs) {
+	return rhs += lhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator-(Lanes<R, W> lhs, const Lanes<R, W>& rhs) {
+	return lhs -= rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator-(Lanes<R, W> lhs, const typename Lanes<R, W>::Scalar& rhs) {
+	return lhs -= rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator-(const typename Lanes<R, W>::Scalar& lhs, const Lanes<R, W>& rhs) {
+	return Lanes<R, W>(lhs - rhs.array());
+}
+
+template <typename R, int W>
+Lanes<R, W> operator*(Lanes<R, W> lhs, const Lanes<R, W>& rhs) {
+	return lhs *= rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator*(Lanes<R, W> lhs, const typename Lanes<R, W>::Scalar& rhs) {
+	return lhs *= rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator*(const typename Lanes<R, W>::Scalar& lhs, Lanes<R, W> rhs) {
+	return rhs *= lhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator/(Lanes<R, W> lhs, const Lanes<R, W>& rhs) {
+	return lhs /= rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator/(Lanes<R, W> lhs, const typename Lanes<R, W>::Scalar& rhs) {
+	return lhs /= rhs;
+}
+
+template <typename R, int W>
+Lanes<R, W> operator/(const typename Lanes<R, W>::Scalar& lhs, const Lanes<R, W>& rhs) {
+	return Lanes<R, W>(lhs / rhs.array());
+}
+
+template <typename R, int W>
+Lanes<R, W> sqrt(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().sqrt());
+}
+
+template <typename R, int W>
+Lanes<R, W> exp(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().exp());
+}
+
+template <typename R, int W>
+Lanes<R, W> log(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().log());
+}
+
+template <typename R, int W>
+Lanes<R, W> sin(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().sin());
+}
+
+template <typename R, int W>
+Lanes<R, W> cos(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().cos());
+}
+
+template <typename R, int W>
+Lanes<R, W> tan(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().tan());
+}
+
+template <typename R, int W>
+Lanes<R, W> asin(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().asin());
+}
+
+template <typename R, int W>
+Lanes<R, W> acos(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().acos());
+}
+
+template <typename R, int W>
+Lanes<R, W> atan(const Lanes<R, W>& arg) {
+	return Lanes<R, W>(arg.array().atan());
+}
+
+template <typename R, int W>
+Lanes<R, W> pow(const Lanes<R, W>& base, const typename Lanes<R, W>::Scalar& exponent) {
+	return Lanes<R, W>(base.array().pow(exponent));
+}
+
+template <typename R, int W>
+Lanes<R, W> pow(const typename Lanes<R, W>::Scalar& base, const Lanes<R, W>& exponent) {
+	return Lanes<R, W>(Eigen::pow(base, exponent.array()));
+}
+
+template <typename R, int W>
+Lanes<R, W> pow(const Lanes<R, W>& base, const Lanes<R, W>& exponent) {
+	return Lanes<R, W>(base.array().pow(exponent.array()));
+}
+}  // namespace nonlinear
+}  // namespace minimum
+
+namespace fadbad {
+// Operations used by fadbad::F<Lanes<R, W>, N>. The comparisons are left
+// out, so comparing dual numbers with lanes does not compile.
+template <typename R, int W>
+struct Op<minimum::nonlinear::Lanes<R, W>> {
+	typedef minimum::nonlinear::Lanes<R, W> T;
+	typedef T Base;
+	static Base myInteger(const int i) { return Base(R(i)); }
+	static Base myZero() { return myInteger(0); }
+	static Base myOne() { return myInteger(1); }
+	static Base myTwo() { return myInteger(2); }
+	static Base myPI() { return Base(R(3.14159265358979323846)); }
+	static T myPos(const T& x) { return +x; }
+	static T myNeg(const T& x) { return -x; }
+	template <typename U>
+	static T& myCadd(T& x, const U& y) {
+		return x += y;
+	}
+	template <typename U>
+	static T& myCsub(T& x, const U& y) {
+		return x -= y;
+	}
+	template <typename U>
+	static T& myCmul(T& x, const U& y) {
+		return x *= y;
+	}
+	template <typename U>
+	static T& myCdiv(T& x, const U& y) {
+		return x /= y;
+	}
+	static T myInv(const T& x) { return R(1) / x; }
+	static T mySqr(const T& x) { return x * x; }
+	template <typename X, typename Y>
+	static T myPow(const X& x, const Y& y) {
+		return minimum::nonlinear::pow(x, y);
+	}
+	static T mySqrt(const T& x) { return minimum::nonlinear::sqrt(x); }
+	static T myLog(const T& x) { return minimum::nonlinear::log(x); }
+	static T myExp(const T& x) { return minimum::nonlinear::exp(x); }
+	static T mySin(const T& x) { return minimum::nonlinear::sin(x); }
+	static T myCos(const T& x) { return minimum::nonlinear::cos(x); }
+	static T myTan(const T& x) { return minimum::nonlinear::tan(x); }
+	static T myAsin(const T& x) { return minimum::nonlinear::asin(x); }
+	static T myAcos(const T& x) { return minimum::nonlinear::acos(x); }
+	static T myAtan(const T& x) { return minimum::nonlinear::atan(x); }
+};
+}  // namespace fadbad
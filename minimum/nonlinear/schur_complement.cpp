@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <minimum/core/check.h>
+#include <minimum/nonlinear/schur_complement.h>
+using minimum::core::check;
+
+namespace minimum {
+namespace nonlinear {
+
+class SchurComplementSolver::Implementation {
+   public:
+	struct EliminatedBlock {
+		int start;
+		int size;
+		// Reduced indices coupled to this block, sorted.
+		std::vector<int> reduced;
+		// The block of A_EE, replaced by its Cholesky factor L.
+		Eigen::MatrixXd E;
+		// A_CE restricted to the rows in reduced.
+		Eigen::MatrixXd W;
+		// L^-1 W^T.
+		Eigen::MatrixXd Y;
+	};
+
+	void analyze_pattern(const Eigen::SparseMatrix<double>& A);
+	bool factorize(const Eigen::SparseMatrix<double>& A, double shift);
+	Eigen::VectorXd solve(const Eigen::VectorXd& rhs, double tolerance, int max_iterations) const;
+
+	// Computes S v without forming S.
+	void reduced_product(const Eigen::VectorXd& v, Eigen::VectorXd* result) const;
+
+	ReducedSolver reduced_solver;
+	std::vector<EliminatedBlock> blocks;
+
+	int n = 0;
+	std::ptrdiff_t input_non_zeros = -1;
+	// Block of every scalar (-1 if not eliminated).
+	std::vector<int> block_of;
+	// Reduced index of every scalar that is not eliminated.
+	std::vector<int> reduced_index;
+	std::vector<int> original_index;
+
+	// Where the values of A go. Entry k of A is added to
+	// E (destination < E.size()) or W of block_destination[k], or to
+	// the value reduced_destination[k] of A_CC. -1 means unused.
+	std::vector<int> block_destination;
+	std::vector<int> block_offset;
+	std::vector<int> reduced_destination;
+
+	// Lower triangle of A_CC, with all diagonal entries present.
+	Eigen::SparseMatrix<double> A_CC;
+	std::vector<int> diagonal_destination;
+
+	// For DENSE_CHOLESKY.
+	Eigen::LLT<Eigen::MatrixXd> S_factorization;
+	// For CONJUGATE_GRADIENT.
+	Eigen::VectorXd S_diagonal;
+
+	bool factorized = false;
+	mutable int cg_iterations = 0;
+};
+
+void SchurComplementSolver::Implementation::analyze_pattern(const Eigen::SparseMatrix<double>& A) {
+	minimum_core_assert(A.rows() == A.cols());
+	minimum_core_assert(A.isCompressed());
+	n = static_cast<int>(A.rows());
+	input_non_zeros = A.nonZeros();
+	factorized = false;
+
+	block_of.assign(n, -1);
+	for (int b = 0; b < int(blocks.size()); ++b) {
+		auto& block = blocks[b];
+		check(block.size > 0 && block.start >= 0 && block.start + block.size <= n,
+		      "SchurComplementSolver: block out of range.");
+		for (int i = block.start; i < block.start + block.size; ++i) {
+			check(block_of[i] < 0, "SchurComplementSolver: overlapping blocks.");
+			block_of[i] = b;
+		}
+		block.reduced.clear();
+	}
+	reduced_index.assign(n, -1);
+	original_index.clear();
+	for (int i = 0; i < n; ++i) {
+		if (block_of[i] < 0) {
+			reduced_index[i] = static_cast<int>(original_index.size());
+			original_index.push_back(i);
+		}
+	}
+	const int nc = static_cast<int>(original_index.size());
+
+	// Reduced scalars coupled to every block and the pattern of A_CC.
+	std::vector<Eigen::Triplet<double>> reduced_entries;
+	for (int i = 0; i < nc; ++i) {
+		reduced_entries.emplace_back(i, i, 0.0);
+	}
+	for (int j = 0; j < n; ++j) {
+		for (Eigen::SparseMatrix<double>::InnerIterator itr(A, j); itr; ++itr) {
+			int i = static_cast<int>(itr.row());
+			if (i < j) {
+				continue;
+			}
+			int bi = block_of[i];
+			int bj = block_of[j];
+			if (bi >= 0 && bj >= 0) {
+				check(bi == bj, "SchurComplementSolver: two eliminated blocks are coupled.");
+			} else if (bi >= 0) {
+				blocks[bi].reduced.push_back(reduced_index[j]);
+			} else if (bj >= 0) {
+				blocks[bj].reduced.push_back(reduced_index[i]);
+			} else if (i != j) {
+				reduced_entries.emplace_back(reduced_index[i], reduced_index[j], 0.0);
+			}
+		}
+	}
+	for (auto& block : blocks) {
+		std::sort(block.reduced.begin(), block.reduced.end());
+		block.reduced.erase(std::unique(block.reduced.begin(), block.reduced.end()),
+		                    block.reduced.end());
+		block.E.resize(block.size, block.size);
+		block.W.resize(block.reduced.size(), block.size);
+	}
+	A_CC.resize(nc, nc);
+	A_CC.setFromTriplets(reduced_entries.begin(), reduced_entries.end());
+	A_CC.makeCompressed();
+
+	auto position_in_A_CC = [this](int row, int col) {
+		auto begin = A_CC.innerIndexPtr() + A_CC.outerIndexPtr()[col];
+		auto end = A_CC.innerIndexPtr() + A_CC.outerIndexPtr()[col + 1];
+		auto itr = std::lower_bound(begin, end, row);
+		minimum_core_assert(itr != end && *itr == row);
+		return static_cast<int>(itr - A_CC.innerIndexPtr());
+	};
+	diagonal_destination.resize(nc);
+	for (int i = 0; i < nc; ++i) {
+		diagonal_destination[i] = position_in_A_CC(i, i);
+	}
+
+	block_destination.assign(input_non_zeros, -1);
+	block_offset.assign(input_non_zeros, -1);
+	reduced_destination.assign(input_non_zeros, -1);
+	for (int j = 0; j < n; ++j) {
+		for (Eigen::SparseMatrix<double>::InnerIterator itr(A, j); itr; ++itr) {
+			int i = static_cast<int>(itr.row());
+			if (i < j) {
+				continue;
+			}
+			auto k = &itr.value() - A.valuePtr();
+			int bi = block_of[i];
+			int bj = block_of[j];
+			if (bi >= 0 && bj >= 0) {
+				auto& block = blocks[bi];
+				block_destination[k] = bi;
+				block_offset[k] = (j - block.start) * block.size + (i - block.start);
+			} else if (bi >= 0 || bj >= 0) {
+				int b = bi >= 0 ? bi : bj;
+				int e = bi >= 0 ? i : j;
+				int c = bi >= 0 ? reduced_index[j] : reduced_index[i];
+				auto& block = blocks[b];
+				int row = static_cast<int>(
+				    std::lower_bound(block.reduced.begin(), block.reduced.end(), c)
+				    - block.reduced.begin());
+				block_destination[k] = b;
+				block_offset[k] = static_cast<int>(block.E.size())
+				                  + (e - block.start) * static_cast<int>(block.W.rows()) + row;
+			} else {
+				reduced_destination[k] = position_in_A_CC(reduced_index[i], reduced_index[j]);
+			}
+		}
+	}
+}
+
+bool SchurComplementSolver::Implementation::factorize(const Eigen::SparseMatrix<double>& A,
+                                                      double shift) {
+	minimum_core_assert(A.rows() == n && A.cols() == n);
+	minimum_core_assert(A.isCompressed() && A.nonZeros() == input_non_zeros,
+	                    "The pattern of A has changed since analyze_pattern.");
+	factorized = false;
+
+	for (auto& block : blocks) {
+		block.E.setZero();
+		block.W.setZero();
+	}
+	std::fill(A_CC.valuePtr(), A_CC.valuePtr() + A_CC.nonZeros(), 0.0);
+	const double* A_values = A.valuePtr();
+	for (std::ptrdiff_t k = 0; k < input_non_zeros; ++k) {
+		if (block_destination[k] >= 0) {
+			auto& block = blocks[block_destination[k]];
+			auto offset = block_offset[k];
+			if (offset < block.E.size()) {
+				block.E.data()[offset] += A_values[k];
+			} else {
+				block.W.data()[offset - block.E.size()] += A_values[k];
+			}
+		} else if (reduced_destination[k] >= 0) {
+			A_CC.valuePtr()[reduced_destination[k]] += A_values[k];
+		}
+	}
+	for (auto k : diagonal_destination) {
+		A_CC.valuePtr()[k] += shift;
+	}
+
+	// Factorize the blocks and compute Y = L^-1 W^T.
+	int failed = 0;
+	const int number_of_blocks = static_cast<int>(blocks.size());
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (int b = 0; b < number_of_blocks; ++b) {
+		auto& block = blocks[b];
+		block.E.diagonal().array() += shift;
+		Eigen::LLT<Eigen::Ref<Eigen::MatrixXd>> llt(block.E);
+		if (llt.info() != Eigen::Success) {
+#ifdef USE_OPENMP
+#pragma omp atomic write
+#endif
+			failed = 1;
+			continue;
+		}
+		block.Y = block.W.transpose();
+		block.E.triangularView<Eigen::Lower>().solveInPlace(block.Y);
+	}
+	if (failed) {
+		return false;
+	}
+
+	const int nc = static_cast<int>(original_index.size());
+	if (reduced_solver == ReducedSolver::DENSE_CHOLESKY) {
+		Eigen::MatrixXd S = A_CC;
+		for (auto& block : blocks) {
+			const int m = static_cast<int>(block.reduced.size());
+			Eigen::MatrixXd update = block.Y.transpose() * block.Y;
+			for (int c = 0; c < m; ++c) {
+				for (int r = c; r < m; ++r) {
+					S(block.reduced[r], block.reduced[c]) -= update(r, c);
+				}
+			}
+		}
+		S_factorization.compute(S);
+		if (S_factorization.info() != Eigen::Success) {
+			return false;
+		}
+	} else {
+		S_diagonal = A_CC.diagonal();
+		for (auto& block : blocks) {
+			for (int r = 0; r < int(block.reduced.size()); ++r) {
+				S_diagonal[block.reduced[r]] -= block.Y.col(r).squaredNorm();
+			}
+		}
+		for (int i = 0; i < nc; ++i) {
+			if (!(S_diagonal[i] > 0)) {
+				return false;
+			}
+		}
+	}
+
+	factorized = true;
+	return true;
+}
+
+void SchurComplementSolver::Implementation::reduced_product(const Eigen::VectorXd& v,
+                                                            Eigen::VectorXd* result) const {
+	result->noalias() = A_CC.selfadjointView<Eigen::Lower>() * v;
+	Eigen::VectorXd v_block, Yv;
+	for (auto& block : blocks) {
+		const int m = static_cast<int>(block.reduced.size());
+		v_block.resize(m);
+		for (int r = 0; r < m; ++r) {
+			v_block[r] = v[block.reduced[r]];
+		}
+		Yv.noalias() = block.Y * v_block;
+		v_block.noalias() = block.Y.transpose() * Yv;
+		for (int r = 0; r < m; ++r) {
+			(*result)[block.reduced[r]] -= v_block[r];
+		}
+	}
+}
+
+Eigen::VectorXd SchurComplementSolver::Implementation::solve(const Eigen::VectorXd& rhs,
+                                                             double tolerance,
+                                                             int max_iterations) const {
+	minimum_core_assert(factorized, "No factorization available.");
+	minimum_core_assert(rhs.size() == n);
+	const int nc = static_cast<int>(original_index.size());
+	const int number_of_blocks = static_cast<int>(blocks.size());
+
+	// z_b = L_b^-1 b_b.
+	std::vector<Eigen::VectorXd> z(number_of_blocks);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (int b = 0; b < number_of_blocks; ++b) {
+		auto& block = blocks[b];
+		z[b] = rhs.segment(block.start, block.size);
+		block.E.triangularView<Eigen::Lower>().solveInPlace(z[b]);
+	}
+
+	// Right-hand side of the reduced system.
+	Eigen::VectorXd r(nc);
+	for (int i = 0; i < nc; ++i) {
+		r[i] = rhs[original_index[i]];
+	}
+	for (int b = 0; b < number_of_blocks; ++b) {
+		auto& block = blocks[b];
+		Eigen::VectorXd update = block.Y.transpose() * z[b];
+		for (int k = 0; k < int(block.reduced.size()); ++k) {
+			r[block.reduced[k]] -= update[k];
+		}
+	}
+
+	Eigen::VectorXd x_C;
+	if (reduced_solver == ReducedSolver::DENSE_CHOLESKY) {
+		x_C = S_factorization.solve(r);
+	} else {
+		// Preconditioned conjugate gradients.
+		x_C = Eigen::VectorXd::Zero(nc);
+		Eigen::VectorXd residual = r;
+		Eigen::VectorXd p = residual.cwiseQuotient(S_diagonal);
+		Eigen::VectorXd Sp(nc);
+		double rz = residual.dot(p);
+		const double stop = tolerance * r.norm();
+		if (max_iterations <= 0) {
+			max_iterations = nc;
+		}
+		cg_iterations = 0;
+		while (residual.norm() > stop && cg_iterations < max_iterations) {
+			reduced_product(p, &Sp);
+			double alpha = rz / p.dot(Sp);
+			x_C += alpha * p;
+			residual -= alpha * Sp;
+			Eigen::VectorXd z_residual = residual.cwiseQuotient(S_diagonal);
+			double rz_next = residual.dot(z_residual);
+			p = z_residual + (rz_next / rz) * p;
+			rz = rz_next;
+			cg_iterations++;
+		}
+	}
+
+	Eigen::VectorXd x(n);
+	for (int i = 0; i < nc; ++i) {
+		x[original_index[i]] = x_C[i];
+	}
+
+	// Back-substitution x_b = L_b^-T (z_b - Y_b x_C).
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (int b = 0; b < number_of_blocks; ++b) {
+		auto& block = blocks[b];
+		Eigen::VectorXd x_block(block.reduced.size());
+		for (int k = 0; k < int(block.reduced.size()); ++k) {
+			x_block[k] = x_C[block.reduced[k]];
+		}
+		z[b].noalias() -= block.Y * x_block;
+		block.E.triangularView<Eigen::Lower>().transpose().solveInPlace(z[b]);
+		x.segment(block.start, block.size) = z[b];
+	}
+	return x;
+}
+
+SchurComplementSolver::SchurComplementSolver(std::vector<Block> blocks,
+                                             ReducedSolver reduced_solver)
+    : impl(new Implementation) {
+	impl->reduced_solver = reduced_solver;
+	for (auto& block : blocks) {
+		impl->blocks.emplace_back();
+		impl->blocks.back().start = block.start;
+		impl->blocks.back().size = block.size;
+	}
+}
+
+SchurComplementSolver::~SchurComplementSolver() { delete impl; }
+
+void SchurComplementSolver::analyze_pattern(const Eigen::SparseMatrix<double>& A) {
+	impl->analyze_pattern(A);
+}
+
+bool SchurComplementSolver::factorize(const Eigen::SparseMatrix<double>& A, double shift) {
+	return impl->factorize(A, shift);
+}
+
+Eigen::VectorXd SchurComplementSolver::solve(const Eigen::VectorXd& b) const {
+	return impl->solve(b, cg_tolerance, maximum_cg_iterations);
+}
+
+std::ptrdiff_t SchurComplementSolver::factor_non_zeros() const {
+	if (!impl->factorized) {
+		return 0;
+	}
+	std::ptrdiff_t non_zeros = 0;
+	for (auto& block : impl->blocks) {
+		non_zeros += block.size * (block.size + 1) / 2;
+	}
+	if (impl->reduced_solver == ReducedSolver::DENSE_CHOLESKY) {
+		std::ptrdiff_t nc = reduced_size();
+		non_zeros += nc * (nc + 1) / 2;
+	}
+	return non_zeros;
+}
+
+int SchurComplementSolver::reduced_size() const {
+	return static_cast<int>(impl->original_index.size());
+}
+
+int SchurComplementSolver::cg_iterations() const { return impl->cg_iterations; }
+}  // namespace nonlinear
+}  // namespace minimum
@@ -0,0 +1,82 @@
+#pragma once
+// Solves block-structured Newton systems, e.g. from bundle
+// adjustment, by eliminating a set of variables with the Schur
+// complement.
+//
+// The scalars are split into eliminated scalars E (e.g. the
+// points) and reduced scalars C (e.g. the cameras). If
+//
+//   A = [A_CC  A_CE]
+//       [A_EC  A_EE],
+//
+// and A_EE is block diagonal, the system A x = b is solved by
+// first solving the reduced system
+//
+//   (A_CC - A_CE A_EE^-1 A_EC) x_C = b_C - A_CE A_EE^-1 b_E
+//
+// and then back-substituting x_E = A_EE^-1 (b_E - A_EC x_C). The
+// diagonal blocks of A_EE are factorized independently and in
+// parallel.
+//
+
+#include <cstddef>
+#include <vector>
+
+#include <Eigen/SparseCore>
+
+#include <minimum/nonlinear/export.h>
+#include <minimum/nonlinear/sparse_cholesky.h>
+
+namespace minimum {
+namespace nonlinear {
+
+class MINIMUM_NONLINEAR_API SchurComplementSolver : public SparseCholesky {
+   public:
+	// One diagonal block of A_EE: the scalars start, ..., start + size - 1.
+	struct Block {
+		int start;
+		int size;
+	};
+
+	// How the reduced system is solved.
+	enum class ReducedSolver {
+		// Forms the reduced matrix and factorizes it with dense Cholesky.
+		DENSE_CHOLESKY,
+		// Conjugate gradients with a Jacobi preconditioner. The reduced
+		// matrix is never formed.
+		CONJUGATE_GRADIENT
+	};
+
+	// The blocks may not overlap. No entry of A may couple two
+	// different blocks; this is checked by analyze_pattern.
+	SchurComplementSolver(std::vector<Block> blocks,
+	                      ReducedSolver reduced_solver = ReducedSolver::DENSE_CHOLESKY);
+	~SchurComplementSolver();
+	SchurComplementSolver(const SchurComplementSolver&) = delete;
+	SchurComplementSolver& operator=(const SchurComplementSolver&) = delete;
+
+	void analyze_pattern(const Eigen::SparseMatrix<double>& A) override;
+	bool factorize(const Eigen::SparseMatrix<double>& A, double shift = 0) override;
+	Eigen::VectorXd solve(const Eigen::VectorXd& b) const override;
+	// The factors of the blocks and, for DENSE_CHOLESKY, of the
+	// reduced matrix.
+	std::ptrdiff_t factor_non_zeros() const override;
+
+	// Number of reduced scalars.
+	int reduced_size() const;
+
+	// Relative residual at which the conjugate gradient iterations
+	// stop and the maximum number of iterations (0: the number of
+	// reduced scalars).
+	double cg_tolerance = 1e-10;
+	int maximum_cg_iterations = 0;
+
+	// Conjugate gradient iterations used by the last solve.
+	int cg_iterations() const;
+
+   private:
+	class Implementation;
+	Implementation* impl;
+};
+}  // namespace nonlinear
+}  // namespace minimum
@@ -0,0 +1,202 @@
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+
+#include <Eigen/Dense>
+
+#include <minimum/nonlinear/auto_diff_term.h>
+#include <minimum/nonlinear/schur_complement.h>
+#include <minimum/nonlinear/solver.h>
+
+using namespace minimum::nonlinear;
+
+namespace {
+// Block structure of bundle adjustment: cameras with 4 scalars
+// first, then points with 3 scalars. Every point is coupled to a few
+// cameras. Positive definite.
+Eigen::SparseMatrix<double> create_matrix(int cameras,
+                                          int points,
+                                          std::vector<SchurComplementSolver::Block>* blocks) {
+	std::mt19937 engine(0);
+	std::uniform_int_distribution<int> camera(0, cameras - 1);
+	std::uniform_real_distribution<double> value(-1, 1);
+	int n = 4 * cameras + 3 * points;
+	std::vector<Eigen::Triplet<double>> entries;
+	std::vector<double> diagonal(n, 0.1);
+	auto add = [&](int i, int j, double v) {
+		entries.emplace_back(i, j, v);
+		entries.emplace_back(j, i, v);
+		diagonal[i] += std::abs(v);
+		diagonal[j] += std::abs(v);
+	};
+	for (int c = 0; c + 1 < cameras; ++c) {
+		add(4 * c, 4 * c + 4, value(engine));
+	}
+	for (int p = 0; p < points; ++p) {
+		int start = 4 * cameras + 3 * p;
+		blocks->push_back({start, 3});
+		add(start, start + 1, value(engine));
+		add(start + 1, start + 2, value(engine));
+		for (int k = 0; k < 3; ++k) {
+			int c = camera(engine);
+			for (int i = 0; i < 4; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					add(4 * c + i, start + j, value(engine));
+				}
+			}
+		}
+	}
+	for (int i = 0; i < n; ++i) {
+		entries.emplace_back(i, i, diagonal[i]);
+	}
+	Eigen::SparseMatrix<double> A(n, n);
+	A.setFromTriplets(entries.begin(), entries.end());
+	A.makeCompressed();
+	return A;
+}
+
+void test_solve(SchurComplementSolver::ReducedSolver reduced_solver) {
+	std::vector<SchurComplementSolver::Block> blocks;
+	auto A = create_matrix(6, 50, &blocks);
+	Eigen::VectorXd b = Eigen::VectorXd::Random(A.rows());
+	Eigen::MatrixXd dense = A;
+
+	SchurComplementSolver schur(blocks, reduced_solver);
+	schur.analyze_pattern(A);
+	CHECK(schur.reduced_size() == 24);
+	REQUIRE(schur.factorize(A));
+	Eigen::VectorXd x = schur.solve(b);
+	CHECK((dense * x - b).norm() < 1e-8 * b.norm());
+
+	// Shifted factorization.
+	REQUIRE(schur.factorize(A, 3.0));
+	x = schur.solve(b);
+	Eigen::MatrixXd shifted = dense;
+	shifted.diagonal().array() += 3.0;
+	CHECK((shifted * x - b).norm() < 1e-8 * b.norm());
+
+	// Not positive definite.
+	CHECK_FALSE(schur.factorize(A, -100.0));
+	CHECK(schur.factor_non_zeros() == 0);
+	REQUIRE(schur.factorize(A));
+	CHECK(schur.factor_non_zeros() > 0);
+}
+
+// Camera j observes point i at s_j (p_i - t_j).
+struct Observation {
+	double u, v;
+
+	template <typename R>
+	R operator()(const R* const camera, const R* const point) const {
+		R du = camera[2] * (point[0] - camera[0]) - u;
+		R dv = camera[2] * (point[1] - camera[1]) - v;
+		return du * du + dv * dv;
+	}
+};
+
+double solve_bundle_adjustment(NewtonSolver::FactorizationMethod method,
+                               NewtonSolver::SchurReducedSolver reduced_solver) {
+	const int number_of_cameras = 5;
+	const int number_of_points = 40;
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<double> uniform(-1, 1);
+
+	std::vector<double> cameras, points;
+	for (int j = 0; j < number_of_cameras; ++j) {
+		cameras.push_back(uniform(engine));
+		cameras.push_back(uniform(engine));
+		cameras.push_back(1.5 + 0.5 * uniform(engine));
+	}
+	for (int i = 0; i < number_of_points; ++i) {
+		points.push_back(5 * uniform(engine));
+		points.push_back(5 * uniform(engine));
+	}
+
+	Function f;
+	std::vector<double*> point_pointers;
+	for (int i = 0; i < number_of_points; ++i) {
+		double* point = &points[2 * i];
+		point_pointers.push_back(point);
+		for (int j : {0, i % 4 + 1, (i + 1) % 4 + 1}) {
+			double* camera = &cameras[3 * j];
+			Observation observation;
+			observation.u = camera[2] * (point[0] - camera[0]);
+			observation.v = camera[2] * (point[1] - camera[1]);
+			f.add_term(std::make_shared<AutoDiffTerm<Observation, 3, 2>>(observation),
+			           camera,
+			           point);
+		}
+	}
+	// The first camera defines the coordinate system.
+	f.set_constant(&cameras[0], true);
+	// Start away from the solution.
+	for (int j = 3; j < 3 * number_of_cameras; ++j) {
+		cameras[j] += 0.1 * uniform(engine);
+	}
+	for (auto& p : points) {
+		p += 0.1 * uniform(engine);
+	}
+
+	NewtonSolver solver;
+	solver.log_function = nullptr;
+	solver.factorization_method = method;
+	solver.sparsity_mode = NewtonSolver::SparsityMode::SPARSE;
+	solver.schur_eliminated_variables = point_pointers;
+	solver.schur_reduced_solver = reduced_solver;
+	solver.maximum_iterations = 100;
+	SolverResults results;
+	solver.solve(f, &results);
+	INFO(results);
+	CHECK(results.exit_success());
+	return f.evaluate();
+}
+}  // namespace
+
+TEST_CASE("dense_cholesky") { test_solve(SchurComplementSolver::ReducedSolver::DENSE_CHOLESKY); }
+
+TEST_CASE("conjugate_gradient") {
+	test_solve(SchurComplementSolver::ReducedSolver::CONJUGATE_GRADIENT);
+}
+
+TEST_CASE("coupled_blocks") {
+	std::vector<SchurComplementSolver::Block> blocks;
+	auto A = create_matrix(2, 3, &blocks);
+	// Two points sharing scalars.
+	blocks[1].start -= 1;
+	SchurComplementSolver overlapping(blocks);
+	CHECK_THROWS(overlapping.analyze_pattern(A));
+
+	// One point split into two blocks, which are coupled.
+	blocks.pop_back();
+	blocks[1].start += 1;
+	blocks[1].size = 1;
+	blocks.push_back({blocks[1].start + 1, 2});
+	SchurComplementSolver coupled(blocks);
+	CHECK_THROWS(coupled.analyze_pattern(A));
+}
+
+TEST_CASE("only_eliminated") {
+	Eigen::MatrixXd dense(4, 4);
+	dense << 4, 1, 0, 0,  //
+	    1, 3, 0, 0,       //
+	    0, 0, 2, 0,       //
+	    0, 0, 0, 5;
+	Eigen::SparseMatrix<double> A = dense.sparseView();
+	A.makeCompressed();
+	SchurComplementSolver schur({{0, 2}, {2, 1}, {3, 1}});
+	schur.analyze_pattern(A);
+	CHECK(schur.reduced_size() == 0);
+	REQUIRE(schur.factorize(A));
+	Eigen::VectorXd b(4);
+	b << 1, 2, 3, 4;
+	CHECK((dense * schur.solve(b) - b).norm() < 1e-12);
+}
+
+TEST_CASE("newton_bundle_adjustment") {
+	using Method = NewtonSolver::FactorizationMethod;
+	using Reduced = NewtonSolver::SchurReducedSolver;
+	CHECK(solve_bundle_adjustment(Method::SUPERNODAL, Reduced::DENSE_CHOLESKY) < 1e-12);
+	CHECK(solve_bundle_adjustment(Method::SCHUR, Reduced::DENSE_CHOLESKY) < 1e-12);
+	CHECK(solve_bundle_adjustment(Method::SCHUR, Reduced::CONJUGATE_GRADIENT) < 1e-12);
+}
@@ -31,6 +31,27 @@ std::ostream& operator<<(std::ostream& out, const SolverResults& results) {
 	out << "Backtracking time         : " << results.backtracking_time << '\n';
 	out << "Log time                  : " << results.log_time << '\n';
 	out << "Total time (without log)  : " << results.total_time - results.log_time << '\n';
+	out << "Hessian-vector products   : " << results.hessian_vector_products << '\n';
+	out << "Gradient schedule         : ";
+	switch (results.gradient_schedule) {
+		case Function::GradientSchedule::SERIAL:
+			out << "serial\n";
+			break;
+		case Function::GradientSchedule::COLORED:
+			out << "colored (" << results.gradient_colors << " colors)\n";
+			break;
+		case Function::GradientSchedule::THREAD_BUFFERS:
+			out << "thread buffers\n";
+			break;
+	}
+	for (std::size_t t = 0; t < results.boxes_per_thread.size(); ++t) {
+		out << "Thread " << t << " boxes              : " << results.boxes_per_thread[t];
+		if (t < results.box_time_per_thread.size() && results.box_time_per_thread[t] > 0) {
+			out << " (" << results.boxes_per_thread[t] / results.box_time_per_thread[t]
+			    << " per second)";
+		}
+		out << '\n';
+	}
 	out << "----------------------------------------------\n";
 	return out;
 }
@@ -10,7 +10,9 @@
 
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include <minimum/core/check.h>
 #include <minimum/nonlinear/constrained_function.h>
@@ -51,11 +53,24 @@ struct MINIMUM_NONLINEAR_API SolverResults {
 	double log_time = 0;
 	double total_time = 0;
 
+	// How the gradient evaluations were parallelized. Set by the solvers
+	// that evaluate the gradient.
+	Function::GradientSchedule gradient_schedule = Function::GradientSchedule::SERIAL;
+	int gradient_colors = 0;
+
+	// Number of Hessian-vector products computed by matrix-free solvers.
+	int hessian_vector_products = 0;
+
 	// The minimum value of the function being minimized is
 	// in this interval. These members are only set by global
 	// optmization solvers.
 	double optimum_lower = -std::numeric_limits<double>::infinity();
 	double optimum_upper = std::numeric_limits<double>::infinity();
+
+	// Number of boxes processed by each thread of the global solver and
+	// the time each thread spent processing them.
+	std::vector<int> boxes_per_thread;
+	std::vector<double> box_time_per_thread;
 };
 
 MINIMUM_NONLINEAR_API std::ostream& operator<<(std::ostream& out, const SolverResults& results);
@@ -210,9 +225,50 @@ class MINIMUM_NONLINEAR_API NewtonSolver : public Solver {
 		MESCHACH,   // BKP using the Meschach library (dense only). Production-ready.
 		            // Will fall back to ’iterative’ for sparse problems.
 		SYM_ILDL,   // BKP using the sym-ildl library.
+		SUPERNODAL,  // Iterative diagonal modification with a supernodal sparse
+		             // Cholesky factorization. Uses ’iterative’ for dense problems.
+		SCHUR,       // Iterative diagonal modification, eliminating
+		             // schur_eliminated_variables with the Schur complement.
+		             // Always uses a sparse Hessian.
 	};
 	FactorizationMethod factorization_method = FactorizationMethod::MESCHACH;
 
+	// Variables eliminated by the SCHUR factorization, e.g. the points
+	// in bundle adjustment. No term may depend on two of them, so that
+	// their part of the Hessian is block diagonal. Every variable is
+	// one block; they are factorized in parallel.
+	std::vector<double*> schur_eliminated_variables;
+
+	// How the SCHUR factorization solves the reduced system (e.g. the
+	// cameras in bundle adjustment). Dense Cholesky forms the reduced
+	// matrix, while conjugate gradients only uses products with it.
+	enum class SchurReducedSolver { DENSE_CHOLESKY, CONJUGATE_GRADIENT };
+	SchurReducedSolver schur_reduced_solver = SchurReducedSolver::DENSE_CHOLESKY;
+
+	virtual void solve(const Function& function, SolverResults* results) const override;
+};
+
+// Truncated Newton with a trust region (Steihaug-Toint). The
+// Newton system is solved approximately with preconditioned
+// conjugate gradients using Hessian-vector products, so the
+// Hessian is never formed. Uses memory linear in the number of
+// variables, like L-BFGS, while keeping the fast convergence of
+// Newton's method close to the optimum.
+class MINIMUM_NONLINEAR_API NewtonCGSolver : public Solver {
+   public:
+	// Initial and maximum radius of the trust region.
+	double initial_trust_region_radius = 1.0;
+	double maximum_trust_region_radius = 1e10;
+
+	// Maximum number of conjugate gradient iterations in each
+	// iteration. Default (0): the number of variables.
+	int maximum_cg_iterations = 0;
+
+	// Whether to precondition with the diagonal of the Hessian.
+	// The diagonal requires the Hessians of the individual terms,
+	// but not the Hessian of the function.
+	bool use_diagonal_preconditioner = true;
+
 	virtual void solve(const Function& function, SolverResults* results) const override;
 };
 
@@ -291,6 +347,11 @@ class MINIMUM_NONLINEAR_API GlobalSolver : public Solver {
 	// Will just give a point in the box of the global optimum.
 	virtual void solve(const Function& function, SolverResults* results) const override;
 
+	// Number of threads processing boxes in parallel. Every thread
+	// evaluates its own copy of the function, which is evaluated
+	// with a single thread.
+	int number_of_threads = 1;
+
    private:
 	IntervalVector private_solve(const Function& function,
 	                             const std::map<std::string, Constraint> constraints,
@@ -299,6 +360,58 @@ class MINIMUM_NONLINEAR_API GlobalSolver : public Solver {
 	                             SolverResults* results) const;
 };
 
+// Solves many small, independent problems with the same structure,
+// e.g. fitting one model to many data sets. One function is created
+// per thread and reused for all problems solved by that thread, so
+// the function and its local storage are only allocated once per
+// thread.
+class MINIMUM_NONLINEAR_API BatchSolver {
+   public:
+	// Creates the function for one thread. It is called once per thread
+	// with an empty function. All variables of the function must be
+	// stored in parameters, which has number_of_parameters elements and
+	// stays valid while the function is used. *problem is the index of
+	// the problem currently being solved; the terms read their data
+	// through it.
+	using FunctionFactory =
+	    std::function<void(Function* function, double* parameters, const int* problem)>;
+
+	// Result of one problem.
+	struct Result {
+		double objective_value = std::numeric_limits<double>::quiet_NaN();
+		decltype(SolverResults::exit_condition) exit_condition = SolverResults::NA;
+
+		bool exit_success() const {
+			return exit_condition == SolverResults::GRADIENT_TOLERANCE
+			       || exit_condition == SolverResults::FUNCTION_TOLERANCE
+			       || exit_condition == SolverResults::ARGUMENT_TOLERANCE;
+		}
+	};
+
+	BatchSolver(int number_of_parameters, FunctionFactory factory);
+
+	// Solves number_of_problems problems with solver. Problem i starts
+	// at the point stored in
+	//
+	//   (*x)[i * number_of_parameters], ..., (*x)[(i + 1) * number_of_parameters - 1],
+	//
+	// and its solution is written back there.
+	//
+	// The solver is shared between the threads, so its log and callback
+	// functions are called concurrently. They are typically disabled.
+	std::vector<Result> solve(const Solver& solver,
+	                          int number_of_problems,
+	                          std::vector<double>* x) const;
+
+	// Number of problems solved in parallel. Default (0): the number of
+	// hardware threads.
+	int number_of_threads = 0;
+
+   private:
+	int number_of_parameters;
+	FunctionFactory factory;
+};
+
 // Definitions of helper classes.
 
 struct FactorizationCacheInternal;
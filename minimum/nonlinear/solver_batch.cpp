@@ -0,0 +1,96 @@
+// Petter Strandmark.
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <minimum/core/check.h>
+#include <minimum/nonlinear/solver.h>
+using minimum::core::check;
+
+namespace minimum {
+namespace nonlinear {
+
+BatchSolver::BatchSolver(int number_of_parameters_, FunctionFactory factory_)
+    : number_of_parameters(number_of_parameters_), factory(std::move(factory_)) {
+	check(number_of_parameters > 0, "BatchSolver: invalid number of parameters.");
+	check(bool(factory), "BatchSolver: no function factory.");
+}
+
+std::vector<BatchSolver::Result> BatchSolver::solve(const Solver& solver,
+                                                    int number_of_problems,
+                                                    std::vector<double>* x) const {
+	check(number_of_problems >= 0, "BatchSolver::solve: invalid number of problems.");
+	check(x->size() == std::size_t(number_of_problems) * number_of_parameters,
+	      "BatchSolver::solve: x does not match the number of problems.");
+	check(number_of_threads >= 0, "BatchSolver::solve: invalid number of threads.");
+
+	std::vector<Result> results(number_of_problems);
+	const int n = number_of_parameters;
+
+	int threads_to_use = number_of_threads;
+	if (threads_to_use == 0) {
+		threads_to_use = std::max(1, int(std::thread::hardware_concurrency()));
+	}
+	threads_to_use = std::max(1, std::min(threads_to_use, number_of_problems));
+
+	// Problems are handed out one at a time. A problem takes much longer
+	// to solve than the atomic increment.
+	std::atomic<int> next_problem(0);
+	std::mutex error_mutex;
+	std::exception_ptr error;
+
+	auto worker = [&]() {
+		try {
+			std::vector<double> parameters(n);
+			int problem = -1;
+			Function function;
+			factory(&function, parameters.data(), &problem);
+			// Parallelism is across problems.
+			function.set_number_of_threads(1);
+
+			while (true) {
+				problem = next_problem.fetch_add(1);
+				if (problem >= number_of_problems) {
+					break;
+				}
+				double* problem_x = x->data() + std::size_t(problem) * n;
+				std::copy(problem_x, problem_x + n, parameters.begin());
+
+				SolverResults solver_results;
+				solver.solve(function, &solver_results);
+
+				std::copy(parameters.begin(), parameters.end(), problem_x);
+				results[problem].objective_value = function.evaluate();
+				results[problem].exit_condition = solver_results.exit_condition;
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+			// Stop the other threads.
+			next_problem = number_of_problems;
+		}
+	};
+
+	if (threads_to_use == 1) {
+		worker();
+	} else {
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threads_to_use; ++t) {
+			threads.emplace_back(worker);
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return results;
+}
+}  // namespace nonlinear
+}  // namespace minimum
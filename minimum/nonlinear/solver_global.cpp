@@ -3,10 +3,15 @@
 // [1] Stig Skelboe, Computation of Rational Interval Functions, BIT 14, 1974.
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdio>
+#include <exception>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <sstream>
+#include <thread>
 
 #include <minimum/core/check.h>
 #include <minimum/core/time.h>
@@ -40,9 +45,11 @@ double volume(const IntervalVector& x) {
 struct GlobalQueueEntry {
 	IntervalVector box;
 	Interval<double> bounds;
+	// Volume of the box, computed once when the box is created.
+	double priority = 0;
 
 	bool operator<(const GlobalQueueEntry& rhs) const {
-		return volume(this->box) < volume(rhs.box);
+		return this->priority < rhs.priority;
 
 		// From [1].
 		// return this->bounds.get_lower() > rhs.bounds.get_lower();
@@ -62,33 +69,50 @@ std::ostream& operator<<(std::ostream& out, IntervalQueue queue) {
 	return out;
 }
 
+// The boxes being processed are not in the queue, but are included in
+// the bounding box if they are not empty.
 IntervalVector get_bounding_box(const IntervalQueue& queue_in,
+                                const IntervalQueue& boxes_in_progress,
                                 double* function_lower_bound,
                                 double* sum_of_volumes) {
 	*sum_of_volumes = 0;
 
-	if (queue_in.empty()) {
+	std::size_t n = 0;
+	bool empty = true;
+	for (const auto* entries : {&queue_in, &boxes_in_progress}) {
+		for (const auto& elem : *entries) {
+			if (!elem.box.empty()) {
+				n = elem.box.size();
+				empty = false;
+			}
+		}
+	}
+	if (empty) {
 		return IntervalVector();
 	}
 
-	auto n = queue_in.front().box.size();
 	std::vector<double> upper_bound(n, -1e100);
 	std::vector<double> lower_bound(n, 1e100);
 
 	*function_lower_bound = std::numeric_limits<double>::infinity();
 
-	for (const auto& elem : queue_in) {
-		const auto& box = elem.box;
-		for (int i = 0; i < n; ++i) {
-			lower_bound[i] = std::min(lower_bound[i], box[i].get_lower());
-			upper_bound[i] = std::max(upper_bound[i], box[i].get_upper());
+	for (const auto* entries : {&queue_in, &boxes_in_progress}) {
+		for (const auto& elem : *entries) {
+			const auto& box = elem.box;
+			if (box.empty()) {
+				continue;
+			}
+			for (std::size_t i = 0; i < n; ++i) {
+				lower_bound[i] = std::min(lower_bound[i], box[i].get_lower());
+				upper_bound[i] = std::max(upper_bound[i], box[i].get_upper());
+			}
+			*sum_of_volumes += elem.priority;
+			*function_lower_bound = std::min(*function_lower_bound, elem.bounds.get_lower());
 		}
-		*sum_of_volumes += volume(box);
-		*function_lower_bound = std::min(*function_lower_bound, elem.bounds.get_lower());
 	}
 
 	IntervalVector out(n);
-	for (int i = 0; i < n; ++i) {
+	for (std::size_t i = 0; i < n; ++i) {
 		out[i] = Interval<double>(lower_bound[i], upper_bound[i]);
 	}
 
@@ -96,13 +120,13 @@ IntervalVector get_bounding_box(const IntervalQueue& queue_in,
 }
 
 //
-// Splits an interval into 2^n subintervals and adds them all to the
-// queue.
+// Splits an interval into 2^n subintervals and adds the ones that may
+// contain the optimum to the queue.
 //
 int split_interval(const Function& function,
                    const IntervalVector& x,
                    IntervalQueue* queue,
-                   double upper_bound) {
+                   const std::atomic<double>& upper_bound) {
 	auto n = x.size();
 	std::vector<int> split(n, 0);
 
@@ -130,11 +154,10 @@ int split_interval(const Function& function,
 		}
 
 		entry.bounds = function.evaluate(entry.box);
+		entry.priority = volume(entry.box);
 		evaluations++;
 
-		if (entry.bounds.get_lower() <= upper_bound) {
-			std::push_heap(begin(*queue), end(*queue));
-		} else {
+		if (entry.bounds.get_lower() > upper_bound.load()) {
 			queue->pop_back();
 		}
 
@@ -203,7 +226,15 @@ IntervalVector GlobalSolver::private_solve(const Function& function,
 
 	check(x_interval.size() == function.get_number_of_scalars(),
 	      "solve_global: input vector does not match the function's number of scalars");
+	check(this->number_of_threads >= 1, "solve_global: invalid number of threads.");
 	auto n = x_interval.size();
+	const int number_of_threads = this->number_of_threads;
+
+	// The boxes are processed by number_of_threads workers. Everything
+	// below is protected by queue_mutex, except the upper bound, which is
+	// read without locking when pruning boxes.
+	std::mutex queue_mutex;
+	std::condition_variable queue_changed;
 
 	IntervalQueue queue;
 	queue.reserve(2 * this->maximum_iterations);
@@ -211,99 +242,48 @@ IntervalVector GlobalSolver::private_solve(const Function& function,
 	GlobalQueueEntry entry;
 	entry.bounds = function.evaluate(x_interval);
 	entry.box = x_interval;
+	entry.priority = volume(x_interval);
 	queue.push_back(entry);
 
-	double upper_bound = Interval<double>::infinity;
+	std::atomic<double> upper_bound(Interval<double>::infinity);
 	if (constraints.empty()) {
 		upper_bound = entry.bounds.get_upper();
 	}
 
 	Eigen::VectorXd best_x(n);
+	double best_value = Interval<double>::infinity;
 	IntervalVector best_interval;
 
+	// The box each thread is currently processing. Empty if none.
+	IntervalQueue boxes_in_progress(number_of_threads);
+	int number_of_boxes_in_progress = 0;
+	bool stop = false;
+	std::exception_ptr worker_error;
+
 	int number_of_function_evaluations = 0;
+	// Number of boxes that have been processed. Counted when a box is
+	// completed so that after_iteration sees every value once, also with
+	// several threads.
 	int iterations = 0;
 	results->exit_condition = SolverResults::INTERNAL_ERROR;
+	results->boxes_per_thread.assign(number_of_threads, 0);
+	results->box_time_per_thread.assign(number_of_threads, 0.0);
 
-	while (!queue.empty()) {
-		double start_time = wall_time();
-		iterations++;
-
-		const auto box = queue.front().box;
-		const auto bounds = queue.front().bounds;
-		// Remove current element from queue.
-		pop_heap(begin(queue), end(queue));
-		queue.pop_back();
-
-		// cerr << "-- Processing " << box << " with bounds " << bounds << ". Global upper bound is
-		// " << upper_bound << endl;
-
-		bool maybe_feasible = true;
-		for (auto itr : constraints) {
-			auto& constraint = itr.second;
-			auto range = constraint.evaluate(box);
-			if (constraint.type == Constraint::Type::EQUAL) {
-				maybe_feasible = range.contains(0.0);
-			} else {
-				maybe_feasible = range.get_lower() <= 0;
-			}
-			if (!maybe_feasible) {
-				break;
-			}
-		}
-
-		if (maybe_feasible) {
-			best_interval = box;
-		}
-
-		// Could this interval containt a feasible point and a point
-		// with a better objective value?
-		if (maybe_feasible && bounds.get_lower() < upper_bound) {
-			// Evaluate middle point.
-			Eigen::VectorXd x(box.size());
-			midpoint(box, &x);
-			double value = function.evaluate(x);
-
-			bool is_feasible = true;
-			for (auto itr : constraints) {
-				double value = itr.second.evaluate(x);
-				if (itr.second.type == Constraint::Type::EQUAL) {
-					is_feasible = std::abs(value) <= feasibility_tolerance;
-				} else {
-					is_feasible = value <= feasibility_tolerance;
-				}
-				if (!is_feasible) {
-					break;
-				}
-			}
-
-			number_of_function_evaluations++;
-
-			if (is_feasible && value < upper_bound) {
-				upper_bound = value;
-				best_x = x;
-			}
-
-			// Add new elements to queue.
-			number_of_function_evaluations += split_interval(function, box, &queue, upper_bound);
-		}
-		results->function_evaluation_time += wall_time() - start_time;
-
+	// Called after a box has been processed with the lock held. Prunes
+	// the queue, logs and checks the stopping criteria.
+	auto after_iteration = [&]() {
 		if (iterations % 100 == 0) {
 			// Remove intervals from queue which cannot contain the optimum.
-			bool removed = false;
-			for (ptrdiff_t i = ptrdiff_t(queue.size()) - 1; i >= 0; --i) {
-				if (queue[i].bounds.get_lower() > upper_bound) {
-					queue.erase(queue.begin() + i);
-					removed = true;
-				}
-			}
-			if (removed) {
+			auto new_end = remove_if(begin(queue), end(queue), [&](const GlobalQueueEntry& entry) {
+				return entry.bounds.get_lower() > upper_bound;
+			});
+			if (new_end != end(queue)) {
+				queue.erase(new_end, end(queue));
 				make_heap(begin(queue), end(queue));
 			}
 		}
 
-		start_time = wall_time();
+		double start_time = wall_time();
 		int log_interval = 1;
 		if (iterations > 20) {
 			log_interval = 10;
@@ -326,9 +306,10 @@ IntervalVector GlobalSolver::private_solve(const Function& function,
 
 		if (iterations % log_interval == 0) {
 			double volumes_sum;
-			double lower_bound =
-			    upper_bound;  // Default lower bound if queue is empty (problem is solved).
-			auto bounding_box = get_bounding_box(queue, &lower_bound, &volumes_sum);
+			// Default lower bound if queue is empty (problem is solved).
+			double lower_bound = upper_bound;
+			auto bounding_box =
+			    get_bounding_box(queue, boxes_in_progress, &lower_bound, &volumes_sum);
 			double vol_bounding = volume(bounding_box);
 
 			double avg_magnitude = (std::abs(lower_bound) + std::abs(upper_bound)) / 2.0;
@@ -351,7 +332,7 @@ IntervalVector GlobalSolver::private_solve(const Function& function,
 				        iterations,
 				        int(queue.size()),
 				        lower_bound,
-				        upper_bound,
+				        upper_bound.load(),
 				        relative_gap,
 				        vol_bounding,
 				        volumes_sum);
@@ -362,24 +343,177 @@ IntervalVector GlobalSolver::private_solve(const Function& function,
 
 			if (relative_gap <= this->function_improvement_tolerance) {
 				results->exit_condition = SolverResults::FUNCTION_TOLERANCE;
-				break;
+				stop = true;
+				return;
 			}
 
 			if (vol_bounding <= this->argument_improvement_tolerance) {
 				results->exit_condition = SolverResults::ARGUMENT_TOLERANCE;
-				break;
+				stop = true;
+				return;
 			}
 		}
 
 		if (number_of_function_evaluations >= this->maximum_iterations) {
 			results->exit_condition = SolverResults::NO_CONVERGENCE;
-			break;
+			stop = true;
 		}
+	};
+
+	auto worker = [&](int thread,
+	                  const Function& function,
+	                  const std::map<std::string, Constraint>& constraints) {
+		IntervalQueue new_boxes;
+		while (true) {
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			queue_changed.wait(lock, [&]() {
+				return stop || !queue.empty() || number_of_boxes_in_progress == 0;
+			});
+			if (stop || queue.empty()) {
+				// Either stopped or there are no more boxes and no other
+				// thread can create any.
+				queue_changed.notify_all();
+				return;
+			}
+
+			pop_heap(begin(queue), end(queue));
+			auto& current = boxes_in_progress[thread];
+			current = std::move(queue.back());
+			queue.pop_back();
+			number_of_boxes_in_progress++;
+			lock.unlock();
+
+			double start_time = wall_time();
+			const auto& box = current.box;
+			const auto& bounds = current.bounds;
+			int evaluations = 0;
+			new_boxes.clear();
+
+			bool maybe_feasible = true;
+			for (auto& itr : constraints) {
+				auto& constraint = itr.second;
+				auto range = constraint.evaluate(box);
+				if (constraint.type == Constraint::Type::EQUAL) {
+					maybe_feasible = range.contains(0.0);
+				} else {
+					maybe_feasible = range.get_lower() <= 0;
+				}
+				if (!maybe_feasible) {
+					break;
+				}
+			}
+
+			// Could this interval containt a feasible point and a point
+			// with a better objective value?
+			Eigen::VectorXd x;
+			double value = Interval<double>::infinity;
+			bool improved = false;
+			if (maybe_feasible && bounds.get_lower() < upper_bound) {
+				// Evaluate middle point.
+				midpoint(box, &x);
+				value = function.evaluate(x);
+
+				bool is_feasible = true;
+				for (auto& itr : constraints) {
+					double value = itr.second.evaluate(x);
+					if (itr.second.type == Constraint::Type::EQUAL) {
+						is_feasible = std::abs(value) <= feasibility_tolerance;
+					} else {
+						is_feasible = value <= feasibility_tolerance;
+					}
+					if (!is_feasible) {
+						break;
+					}
+				}
+				evaluations++;
+
+				if (is_feasible) {
+					// Lower the shared upper bound right away so that the
+					// new boxes and the other threads can use it.
+					double current_upper = upper_bound;
+					while (value < current_upper
+					       && !upper_bound.compare_exchange_weak(current_upper, value)) {
+					}
+					improved = value < current_upper;
+				}
+
+				// Create new boxes.
+				evaluations += split_interval(function, box, &new_boxes, upper_bound);
+			}
+			double elapsed_time = wall_time() - start_time;
+
+			lock.lock();
+			if (maybe_feasible) {
+				best_interval = box;
+			}
+			if (improved && value < best_value) {
+				best_value = value;
+				best_x = x;
+			}
+			for (auto& new_box : new_boxes) {
+				queue.push_back(std::move(new_box));
+				push_heap(begin(queue), end(queue));
+			}
+			current.box.clear();
+			number_of_boxes_in_progress--;
+			number_of_function_evaluations += evaluations;
+			results->function_evaluation_time += elapsed_time;
+			results->boxes_per_thread[thread]++;
+			results->box_time_per_thread[thread] += elapsed_time;
+			iterations++;
+
+			if (!stop) {
+				after_iteration();
+			}
+			lock.unlock();
+			queue_changed.notify_all();
+		}
+	};
+
+	// Runs a worker and stops all others if it fails.
+	auto run_worker = [&](int thread,
+	                      const Function& function,
+	                      const std::map<std::string, Constraint>& constraints) {
+		try {
+			worker(thread, function, constraints);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			if (!worker_error) {
+				worker_error = std::current_exception();
+			}
+			stop = true;
+			queue_changed.notify_all();
+		}
+	};
+
+	if (number_of_threads == 1) {
+		run_worker(0, function, constraints);
+	} else {
+		// Function evaluation uses temporary storage, so every thread
+		// needs its own copy.
+		std::vector<Function> functions(number_of_threads, function);
+		std::vector<std::map<std::string, Constraint>> thread_constraints(number_of_threads,
+		                                                                   constraints);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < number_of_threads; ++t) {
+			functions[t].set_number_of_threads(1);
+			for (auto& itr : thread_constraints[t]) {
+				itr.second.set_number_of_threads(1);
+			}
+			threads.emplace_back(
+			    [&, t]() { run_worker(t, functions[t], thread_constraints[t]); });
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+	if (worker_error) {
+		std::rethrow_exception(worker_error);
 	}
 
 	double tmp = 0;
 	double lower_bound = upper_bound;
-	auto bounding_box = get_bounding_box(queue, &lower_bound, &tmp);
+	auto bounding_box = get_bounding_box(queue, boxes_in_progress, &lower_bound, &tmp);
 	results->optimum_lower = lower_bound;
 	results->optimum_upper = upper_bound;
 
@@ -360,6 +360,8 @@ void LBFGSSolver::solve(const Function& function, SolverResults* results) const
 	}
 
 	function.copy_global_to_user(x);
+	results->gradient_schedule = function.get_gradient_schedule();
+	results->gradient_colors = function.get_number_of_gradient_colors();
 	results->total_time += wall_time() - global_start_time;
 
 	if (this->log_function) {
@@ -21,7 +21,9 @@
 #include <minimum/core/check.h>
 #include <minimum/core/string.h>
 #include <minimum/core/time.h>
+#include <minimum/nonlinear/schur_complement.h>
 #include <minimum/nonlinear/solver.h>
+#include <minimum/nonlinear/sparse_cholesky.h>
 using minimum::core::check;
 using minimum::core::to_string;
 using minimum::core::wall_time;
@@ -48,7 +50,9 @@ void NewtonSolver::solve(const Function& function, SolverResults* results) const
 	// Determine whether to use sparse representation
 	// and matrix factorization.
 	bool use_sparsity;
-	if (this->sparsity_mode == SparsityMode::DENSE) {
+	if (this->factorization_method == FactorizationMethod::SCHUR) {
+		use_sparsity = true;
+	} else if (this->sparsity_mode == SparsityMode::DENSE) {
 		use_sparsity = false;
 	} else if (this->sparsity_mode == SparsityMode::SPARSE) {
 		use_sparsity = true;
@@ -69,6 +73,16 @@ void NewtonSolver::solve(const Function& function, SolverResults* results) const
 		}
 		factorization_method = FactorizationMethod::ITERATIVE;
 	}
+	bool use_supernodal = false;
+	if (factorization_method == FactorizationMethod::SUPERNODAL) {
+		use_supernodal = use_sparsity;
+		factorization_method = FactorizationMethod::ITERATIVE;
+	}
+	bool use_schur = false;
+	if (factorization_method == FactorizationMethod::SCHUR) {
+		use_schur = true;
+		factorization_method = FactorizationMethod::ITERATIVE;
+	}
 
 	// Current point, gradient and Hessian.
 	double fval = std::numeric_limits<double>::quiet_NaN();
@@ -106,16 +120,40 @@ void NewtonSolver::solve(const Function& function, SolverResults* results) const
 
 	// Dense and sparse Cholesky factorizers.
 	typedef Eigen::LLT<Eigen::MatrixXd> LLT;
-	typedef Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> SparseLLT;
 	std::unique_ptr<LLT> factorization;
-	std::unique_ptr<SparseLLT> sparse_factorization;
+	std::unique_ptr<SparseCholesky> sparse_factorization;
+	SchurComplementSolver* schur = nullptr;
 	if (!use_sparsity) {
 		factorization.reset(new LLT(n));
 	} else {
-		sparse_factorization.reset(new SparseLLT);
+		if (use_schur) {
+			std::vector<SchurComplementSolver::Block> blocks;
+			for (auto variable : this->schur_eliminated_variables) {
+				auto start = function.get_variable_global_index(variable);
+				// Constant variables are not part of the Hessian.
+				if (start < n) {
+					blocks.push_back({static_cast<int>(start),
+					                  function.get_variable_solver_dimension(variable)});
+				}
+			}
+			auto reduced_solver = SchurComplementSolver::ReducedSolver::DENSE_CHOLESKY;
+			if (this->schur_reduced_solver == SchurReducedSolver::CONJUGATE_GRADIENT) {
+				reduced_solver = SchurComplementSolver::ReducedSolver::CONJUGATE_GRADIENT;
+			}
+			schur = new SchurComplementSolver(std::move(blocks), reduced_solver);
+			sparse_factorization.reset(schur);
+		} else if (use_supernodal) {
+			sparse_factorization.reset(new SupernodalSparseCholesky);
+		} else {
+			sparse_factorization.reset(new SimplicialSparseCholesky);
+		}
 		// The sparsity pattern of H is always the same. Therefore, it is enough
 		// to analyze it once.
-		sparse_factorization->analyzePattern(sparse_H);
+		sparse_factorization->analyze_pattern(sparse_H);
+		if (schur && this->log_function) {
+			this->log_function("The reduced system of the Schur complement has "
+			                   + to_string(schur->reduced_size()) + " scalars.");
+		}
 	}
 
 	FactorizationCache factorization_cache((int)n);
@@ -224,22 +262,17 @@ void NewtonSolver::solve(const Function& function, SolverResults* results) const
 				tau = -mindiag + beta;
 			}
 			while (true) {
-				// Add tau*I to the Hessian.
-				if (tau > 0) {
+				// Add tau*I to the Hessian. The sparse factorization adds
+				// the shift itself, so the sparse Hessian is left intact.
+				if (tau > 0 && !use_sparsity) {
 					for (size_t i = 0; i < n; ++i) {
-						if (use_sparsity) {
-							int ii = static_cast<int>(i);
-							sparse_H.coeffRef(ii, ii) = dH(i) + tau;
-						} else {
-							H(i, i) = dH(i) + tau;
-						}
+						H(i, i) = dH(i) + tau;
 					}
 				}
 				// Attempt Cholesky factorization.
 				bool success;
 				if (use_sparsity) {
-					sparse_factorization->factorize(sparse_H);
-					success = sparse_factorization->info() == Eigen::Success;
+					success = sparse_factorization->factorize(sparse_H, tau);
 				} else {
 					factorization->compute(H);
 					success = factorization->info() == Eigen::Success;
@@ -372,6 +405,8 @@ void NewtonSolver::solve(const Function& function, SolverResults* results) const
 	}
 
 	function.copy_global_to_user(x);
+	results->gradient_schedule = function.get_gradient_schedule();
+	results->gradient_colors = function.get_number_of_gradient_colors();
 	results->total_time += wall_time() - global_start_time;
 
 	if (this->log_function) {
@@ -0,0 +1,283 @@
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+
+#include <Eigen/Core>
+
+#include <minimum/core/string.h>
+#include <minimum/core/time.h>
+#include <minimum/nonlinear/solver.h>
+using minimum::core::to_string;
+using minimum::core::wall_time;
+
+namespace minimum {
+namespace nonlinear {
+
+// Each iteration approximately minimizes the quadratic model
+//
+//   m(p) = f + g'p + p'Hp / 2,  ||p||_M <= radius,
+//
+// with the conjugate gradient method of Steihaug and Toint (Nocedal
+// and Wright, Algorithm 7.2). M is the diagonal preconditioner. The
+// inner iterations stop at the trust region boundary, at a direction
+// of negative curvature or when the residual is small enough.
+void NewtonCGSolver::solve(const Function& function, SolverResults* results) const {
+	double global_start_time = wall_time();
+
+	// Dimension of problem.
+	size_t n = function.get_number_of_scalars();
+
+	if (n == 0) {
+		results->exit_condition = SolverResults::FUNCTION_TOLERANCE;
+		return;
+	}
+
+	// Current point and gradient.
+	double fval = std::numeric_limits<double>::quiet_NaN();
+	double fprev = std::numeric_limits<double>::quiet_NaN();
+	double normg0 = std::numeric_limits<double>::quiet_NaN();
+	double normg = std::numeric_limits<double>::quiet_NaN();
+	double normdx = std::numeric_limits<double>::quiet_NaN();
+
+	Eigen::VectorXd x, g;
+	function.copy_user_to_global(&x);
+	Eigen::VectorXd x2(n);
+
+	// Diagonal of the preconditioner.
+	Eigen::VectorXd M = Eigen::VectorXd::Ones(n);
+
+	// Step, residual, preconditioned residual, search direction and
+	// the Hessian times the search direction.
+	Eigen::VectorXd p(n), r(n), z(n), d(n), Hd(n);
+
+	auto M_dot = [&M](const Eigen::VectorXd& a, const Eigen::VectorXd& b) {
+		return (a.array() * M.array() * b.array()).sum();
+	};
+
+	const int max_cg_iterations =
+	    this->maximum_cg_iterations > 0 ? this->maximum_cg_iterations : static_cast<int>(n);
+	double radius = this->initial_trust_region_radius;
+
+	CheckExitConditionsCache exit_condition_cache;
+
+	//
+	// START MAIN ITERATION
+	//
+	results->startup_time += wall_time() - global_start_time;
+	results->exit_condition = SolverResults::INTERNAL_ERROR;
+	int iter = 0;
+	bool last_iteration_successful = true;
+	while (true) {
+		int log_interval = 1;
+		if (iter > 30) {
+			log_interval = 10;
+		}
+		if (iter > 200) {
+			log_interval = 100;
+		}
+		if (iter > 2000) {
+			log_interval = 1000;
+		}
+
+		//
+		// Evaluate function and derivatives at new points.
+		//
+		double start_time = wall_time();
+		if (last_iteration_successful) {
+			fval = function.evaluate(x, &g);
+
+			normg = std::max(g.maxCoeff(), -g.minCoeff());
+			if (iter == 0) {
+				normg0 = normg;
+			}
+
+			// Check for NaN.
+			if (normg != normg) {
+				results->exit_condition = SolverResults::FUNCTION_NAN;
+				break;
+			}
+
+			if (this->use_diagonal_preconditioner) {
+				function.hessian_diagonal(x, &M);
+				// Only the magnitude of the curvature is useful for scaling.
+				M = M.cwiseAbs();
+				double floor = 1e-8 * M.maxCoeff();
+				for (size_t i = 0; i < n; ++i) {
+					M[i] = floor > 0 ? std::max(M[i], floor) : 1.0;
+				}
+			}
+		}
+		results->function_evaluation_time += wall_time() - start_time;
+
+		//
+		// Test stopping criteriea
+		//
+		start_time = wall_time();
+		if (normg == 0) {
+			results->exit_condition = SolverResults::GRADIENT_TOLERANCE;
+			break;
+		}
+		if (last_iteration_successful
+		    && this->check_exit_conditions(fval,
+		                                   fprev,
+		                                   normg,
+		                                   normg0,
+		                                   x.norm(),
+		                                   normdx,
+		                                   true,
+		                                   &exit_condition_cache,
+		                                   results)) {
+			break;
+		}
+		if (iter >= this->maximum_iterations) {
+			results->exit_condition = SolverResults::NO_CONVERGENCE;
+			break;
+		}
+		if (this->callback_function) {
+			CallbackInformation information;
+			information.objective_value = fval;
+			information.x = &x;
+			information.g = &g;
+
+			if (!callback_function(information)) {
+				results->exit_condition = SolverResults::USER_ABORT;
+				break;
+			}
+		}
+		results->stopping_criteria_time += wall_time() - start_time;
+
+		//
+		// Approximately solve the trust region subproblem.
+		//
+		start_time = wall_time();
+
+		// Moves p along d to the boundary of the trust region.
+		auto step_to_boundary = [&]() {
+			double pMp = M_dot(p, p);
+			double pMd = M_dot(p, d);
+			double dMd = M_dot(d, d);
+			double tau =
+			    (-pMd + std::sqrt(pMd * pMd + dMd * std::max(radius * radius - pMp, 0.0))) / dMd;
+			p += tau * d;
+			r += tau * Hd;
+		};
+
+		p.setZero();
+		r = g;
+		z = r.cwiseQuotient(M);
+		d = -z;
+		double rz = r.dot(z);
+		const double cg_tolerance = std::min(0.5, std::sqrt(g.norm())) * g.norm();
+		int cg_iterations = 0;
+		bool on_boundary = false;
+		while (r.norm() > cg_tolerance && cg_iterations < max_cg_iterations) {
+			function.hessian_vector_product(x, d, &Hd);
+			results->hessian_vector_products++;
+			cg_iterations++;
+
+			double dHd = d.dot(Hd);
+			if (dHd <= 0) {
+				// Negative curvature. Follow it to the boundary.
+				step_to_boundary();
+				on_boundary = true;
+				break;
+			}
+
+			double alpha = rz / dHd;
+			z = p + alpha * d;
+			if (M_dot(z, z) >= radius * radius) {
+				step_to_boundary();
+				on_boundary = true;
+				break;
+			}
+			p = z;
+			r += alpha * Hd;
+
+			z = r.cwiseQuotient(M);
+			double rz_next = r.dot(z);
+			d = -z + (rz_next / rz) * d;
+			rz = rz_next;
+		}
+
+		results->linear_solver_time += wall_time() - start_time;
+
+		//
+		// Evaluate the step and update the trust region.
+		//
+		start_time = wall_time();
+
+		// r = g + Hp, so the model decrease is -(g'p + p'Hp / 2).
+		double predicted_decrease = -0.5 * (g.dot(p) + r.dot(p));
+		double step_norm = std::sqrt(M_dot(p, p));
+		x2 = x + p;
+		double fnew = function.evaluate(x2);
+		double ratio = (fval - fnew) / predicted_decrease;
+		if (!(predicted_decrease > 0) || ratio != ratio) {
+			ratio = -1;
+		}
+		// Close to the solution, the predicted decrease is smaller than
+		// the rounding errors in f and the ratio is meaningless. Take the
+		// step anyway.
+		const double rounding = 100 * std::numeric_limits<double>::epsilon() * std::abs(fval);
+		if (predicted_decrease > 0 && predicted_decrease <= rounding) {
+			ratio = 1;
+		}
+
+		if (ratio < 0.25) {
+			radius = 0.25 * step_norm;
+		} else if (ratio > 0.75 && on_boundary) {
+			radius = std::min(2 * radius, this->maximum_trust_region_radius);
+		}
+
+		last_iteration_successful = ratio > 1e-4;
+		if (last_iteration_successful) {
+			normdx = p.norm();
+			fprev = fval;
+			x = x2;
+		}
+
+		results->function_evaluation_time += wall_time() - start_time;
+
+		//
+		// Log the results of this iteration.
+		//
+		start_time = wall_time();
+		if (this->log_function && iter % log_interval == 0) {
+			if (iter == 0) {
+				this->log_function("Itr        f        max|g_i|   radius    ratio      cg");
+			}
+			this->log_function(
+			    to_string(std::setw(4), iter) + " "
+			    + to_string(std::scientific, std::showpos, std::setprecision(6), std::setw(10), fval)
+			    + " " + to_string(std::scientific, std::setprecision(3), std::setw(9), normg) + " "
+			    + to_string(std::scientific, std::setprecision(3), std::setw(9), radius) + " "
+			    + to_string(std::scientific, std::showpos, std::setprecision(2), ratio) + " "
+			    + to_string(std::setw(5), cg_iterations));
+		}
+		results->log_time += wall_time() - start_time;
+
+		// The trust region is too small to make any more progress.
+		if (!last_iteration_successful
+		    && p.norm() <= this->argument_improvement_tolerance
+		                       * (x.norm() + this->argument_improvement_tolerance)) {
+			results->exit_condition = SolverResults::ARGUMENT_TOLERANCE;
+			break;
+		}
+
+		iter++;
+	}
+
+	function.copy_global_to_user(x);
+	results->gradient_schedule = function.get_gradient_schedule();
+	results->gradient_colors = function.get_number_of_gradient_colors();
+	results->total_time += wall_time() - global_start_time;
+
+	if (this->log_function) {
+		char str[1024];
+		std::sprintf(str, " end %+10.6e %.3e", fval, normg);
+		this->log_function(str);
+	}
+}
+}  // namespace nonlinear
+}  // namespace minimum
@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/OrderingMethods>
+#include <Eigen/SparseCholesky>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <minimum/core/check.h>
+#include <minimum/nonlinear/sparse_cholesky.h>
+
+namespace minimum {
+namespace nonlinear {
+
+SparseCholesky::~SparseCholesky() {}
+
+class SimplicialSparseCholesky::Implementation {
+   public:
+	Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt;
+	bool factorized = false;
+};
+
+SimplicialSparseCholesky::SimplicialSparseCholesky() : impl(new Implementation) {}
+
+SimplicialSparseCholesky::~SimplicialSparseCholesky() { delete impl; }
+
+void SimplicialSparseCholesky::analyze_pattern(const Eigen::SparseMatrix<double>& A) {
+	impl->llt.analyzePattern(A);
+	impl->factorized = false;
+}
+
+bool SimplicialSparseCholesky::factorize(const Eigen::SparseMatrix<double>& A, double shift) {
+	impl->llt.setShift(shift);
+	impl->llt.factorize(A);
+	impl->factorized = impl->llt.info() == Eigen::Success;
+	return impl->factorized;
+}
+
+Eigen::VectorXd SimplicialSparseCholesky::solve(const Eigen::VectorXd& b) const {
+	minimum_core_assert(impl->factorized, "No factorization available.");
+	return impl->llt.solve(b);
+}
+
+std::ptrdiff_t SimplicialSparseCholesky::factor_non_zeros() const {
+	if (!impl->factorized) {
+		return 0;
+	}
+	return impl->llt.matrixL().nestedExpression().nonZeros();
+}
+
+// Supernodal left-looking Cholesky factorization.
+//
+// The matrix is permuted with AMD and all indices below refer to
+// the permuted matrix. Supernode s consists of the columns
+// first_column[s], ..., first_column[s + 1] - 1 of L. Its row
+// structure is stored in rows[row_start[s], ..., row_start[s + 1])
+// and begins with the columns of the supernode itself. The values
+// are stored as a dense column-major block starting at
+// values[value_start[s]].
+class SupernodalSparseCholesky::Implementation {
+   public:
+	void analyze_pattern(const Eigen::SparseMatrix<double>& A);
+	bool factorize(const Eigen::SparseMatrix<double>& A, double shift);
+	Eigen::VectorXd solve(const Eigen::VectorXd& b) const;
+
+	int number_of_supernodes() const { return int(first_column.size()) - 1; }
+
+	int n = 0;
+	std::ptrdiff_t input_non_zeros = -1;
+	bool factorized = false;
+
+	// new_index[i] is the index of variable i in the permuted matrix.
+	std::vector<int> new_index;
+
+	std::vector<int> first_column;
+	std::vector<int> supernode_of_column;
+	std::vector<int> row_start;
+	std::vector<int> rows;
+	std::vector<std::ptrdiff_t> value_start;
+	std::vector<double> values;
+
+	// Position in values of every entry in the value array of A.
+	// Entries in the upper triangle are ignored and have -1.
+	std::vector<std::ptrdiff_t> value_destination;
+	std::vector<std::ptrdiff_t> diagonal_destination;
+
+	// Supernode s is updated by the supernodes update_source[k] for
+	// update_start[s] <= k < update_start[s + 1]. The rows of the
+	// source that are in s begin at position update_row[k].
+	std::vector<int> update_start;
+	std::vector<int> update_source;
+	std::vector<int> update_row;
+
+	// Supernodes grouped by their height in the elimination tree.
+	// Supernodes with the same height do not depend on each other.
+	std::vector<int> level_start;
+	std::vector<int> level_supernodes;
+
+   private:
+	bool factorize_supernode(int s, Eigen::MatrixXd* update, std::vector<int>* relative);
+};
+
+void SupernodalSparseCholesky::Implementation::analyze_pattern(
+    const Eigen::SparseMatrix<double>& A) {
+	minimum_core_assert(A.rows() == A.cols());
+	minimum_core_assert(A.isCompressed());
+	n = int(A.rows());
+	input_non_zeros = A.nonZeros();
+	factorized = false;
+
+	new_index.resize(n);
+	if (n > 0) {
+		Eigen::AMDOrdering<int> ordering;
+		Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> inverse_permutation;
+		ordering(A, inverse_permutation);
+		Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> permutation =
+		    inverse_permutation.inverse();
+		for (int i = 0; i < n; ++i) {
+			new_index[i] = permutation.indices()[i];
+		}
+	}
+
+	// For every row i of the permuted lower triangle, the columns
+	// k < i with non-zero entries.
+	std::vector<int> row_list_start(n + 1, 0);
+	for (int j = 0; j < n; ++j) {
+		for (Eigen::SparseMatrix<double>::InnerIterator it(A, j); it; ++it) {
+			if (it.row() > j) {
+				row_list_start[std::max(new_index[it.row()], new_index[j]) + 1]++;
+			}
+		}
+	}
+	for (int i = 0; i < n; ++i) {
+		row_list_start[i + 1] += row_list_start[i];
+	}
+	std::vector<int> row_list(row_list_start[n]);
+	std::vector<int> position(row_list_start.begin(), row_list_start.end() - 1);
+	for (int j = 0; j < n; ++j) {
+		for (Eigen::SparseMatrix<double>::InnerIterator it(A, j); it; ++it) {
+			if (it.row() > j) {
+				int r = new_index[it.row()];
+				int c = new_index[j];
+				if (r < c) {
+					std::swap(r, c);
+				}
+				row_list[position[r]++] = c;
+			}
+		}
+	}
+
+	// Elimination tree.
+	std::vector<int> parent(n, -1);
+	std::vector<int> ancestor(n, -1);
+	for (int i = 0; i < n; ++i) {
+		for (int l = row_list_start[i]; l < row_list_start[i + 1]; ++l) {
+			int r = row_list[l];
+			while (ancestor[r] != -1 && ancestor[r] != i) {
+				int next = ancestor[r];
+				ancestor[r] = i;
+				r = next;
+			}
+			if (ancestor[r] == -1) {
+				ancestor[r] = i;
+				parent[r] = i;
+			}
+		}
+	}
+
+	// Column counts of L. Row i of L is the union of the paths in
+	// the elimination tree from each k in the row list up to i.
+	std::vector<int> column_count(n, 1);
+	std::vector<int> mark(n, -1);
+	for (int i = 0; i < n; ++i) {
+		mark[i] = i;
+		for (int l = row_list_start[i]; l < row_list_start[i + 1]; ++l) {
+			for (int j = row_list[l]; mark[j] != i; j = parent[j]) {
+				mark[j] = i;
+				column_count[j]++;
+			}
+		}
+	}
+	std::vector<int> number_of_children(n, 0);
+	for (int j = 0; j < n; ++j) {
+		if (parent[j] >= 0) {
+			number_of_children[parent[j]]++;
+		}
+	}
+
+	// Fundamental supernodes.
+	first_column.clear();
+	supernode_of_column.resize(n);
+	for (int j = 0; j < n; ++j) {
+		bool merge = j > 0 && parent[j - 1] == j && column_count[j - 1] == column_count[j] + 1
+		             && number_of_children[j] == 1;
+		if (!merge) {
+			first_column.push_back(j);
+		}
+		supernode_of_column[j] = int(first_column.size()) - 1;
+	}
+	first_column.push_back(n);
+	int S = number_of_supernodes();
+
+	// Row structure of each supernode.
+	row_start.assign(S + 1, 0);
+	for (int s = 0; s < S; ++s) {
+		row_start[s + 1] = row_start[s] + column_count[first_column[s]];
+	}
+	rows.resize(row_start[S]);
+	position.assign(row_start.begin(), row_start.end() - 1);
+	for (int s = 0; s < S; ++s) {
+		rows[position[s]++] = first_column[s];
+	}
+	std::fill(mark.begin(), mark.end(), -1);
+	for (int i = 0; i < n; ++i) {
+		mark[i] = i;
+		for (int l = row_list_start[i]; l < row_list_start[i + 1]; ++l) {
+			for (int j = row_list[l]; mark[j] != i; j = parent[j]) {
+				mark[j] = i;
+				int s = supernode_of_column[j];
+				if (first_column[s] == j) {
+					rows[position[s]++] = i;
+				}
+			}
+		}
+	}
+	for (int s = 0; s < S; ++s) {
+		minimum_core_assert(position[s] == row_start[s + 1]);
+		for (int j = first_column[s]; j < first_column[s + 1]; ++j) {
+			minimum_core_assert(rows[row_start[s] + j - first_column[s]] == j);
+		}
+	}
+
+	value_start.resize(S + 1);
+	value_start[0] = 0;
+	for (int s = 0; s < S; ++s) {
+		std::ptrdiff_t number_of_rows = row_start[s + 1] - row_start[s];
+		std::ptrdiff_t number_of_columns = first_column[s + 1] - first_column[s];
+		value_start[s + 1] = value_start[s] + number_of_rows * number_of_columns;
+	}
+	values.resize(value_start[S]);
+
+	// Where the values of A go in the factor.
+	auto destination = [this](int r, int c) {
+		int s = supernode_of_column[c];
+		auto begin = rows.begin() + row_start[s];
+		auto end = rows.begin() + row_start[s + 1];
+		std::ptrdiff_t local_row = std::lower_bound(begin, end, r) - begin;
+		std::ptrdiff_t local_column = c - first_column[s];
+		return value_start[s] + local_column * (end - begin) + local_row;
+	};
+	value_destination.assign(input_non_zeros, -1);
+	for (int j = 0; j < n; ++j) {
+		for (auto k = A.outerIndexPtr()[j]; k < A.outerIndexPtr()[j + 1]; ++k) {
+			int i = A.innerIndexPtr()[k];
+			if (i >= j) {
+				int r = new_index[i];
+				int c = new_index[j];
+				value_destination[k] = destination(std::max(r, c), std::min(r, c));
+			}
+		}
+	}
+	diagonal_destination.resize(n);
+	for (int j = 0; j < n; ++j) {
+		diagonal_destination[j] = destination(j, j);
+	}
+
+	// Which supernodes update which.
+	std::vector<int> update_target;
+	std::vector<int> source;
+	std::vector<int> source_row;
+	for (int d = 0; d < S; ++d) {
+		int previous = -1;
+		int number_of_columns = first_column[d + 1] - first_column[d];
+		for (int p = row_start[d] + number_of_columns; p < row_start[d + 1]; ++p) {
+			int t = supernode_of_column[rows[p]];
+			if (t != previous) {
+				update_target.push_back(t);
+				source.push_back(d);
+				source_row.push_back(p - row_start[d]);
+				previous = t;
+			}
+		}
+	}
+	update_start.assign(S + 1, 0);
+	for (int t : update_target) {
+		update_start[t + 1]++;
+	}
+	for (int s = 0; s < S; ++s) {
+		update_start[s + 1] += update_start[s];
+	}
+	update_source.resize(update_target.size());
+	update_row.resize(update_target.size());
+	position.assign(update_start.begin(), update_start.end() - 1);
+	for (size_t u = 0; u < update_target.size(); ++u) {
+		int k = position[update_target[u]]++;
+		update_source[k] = source[u];
+		update_row[k] = source_row[u];
+	}
+
+	// Levels in the supernodal elimination tree.
+	std::vector<int> level(S, 0);
+	int number_of_levels = 0;
+	for (int s = 0; s < S; ++s) {
+		int last = first_column[s + 1] - 1;
+		if (parent[last] >= 0) {
+			int p = supernode_of_column[parent[last]];
+			level[p] = std::max(level[p], level[s] + 1);
+		}
+		number_of_levels = std::max(number_of_levels, level[s] + 1);
+	}
+	level_start.assign(number_of_levels + 1, 0);
+	for (int s = 0; s < S; ++s) {
+		level_start[level[s] + 1]++;
+	}
+	for (int l = 0; l < number_of_levels; ++l) {
+		level_start[l + 1] += level_start[l];
+	}
+	level_supernodes.resize(S);
+	position.assign(level_start.begin(), level_start.end() - 1);
+	for (int s = 0; s < S; ++s) {
+		level_supernodes[position[level[s]]++] = s;
+	}
+}
+
+bool SupernodalSparseCholesky::Implementation::factorize_supernode(int s,
+                                                                    Eigen::MatrixXd* update,
+                                                                    std::vector<int>* relative) {
+	int first = first_column[s];
+	int number_of_columns = first_column[s + 1] - first;
+	int number_of_rows = row_start[s + 1] - row_start[s];
+	const int* supernode_rows = &rows[row_start[s]];
+	Eigen::Map<Eigen::MatrixXd> L(&values[value_start[s]], number_of_rows, number_of_columns);
+
+	// Subtract the contributions from all descendants.
+	for (int u = update_start[s]; u < update_start[s + 1]; ++u) {
+		int d = update_source[u];
+		int p = update_row[u];
+		const int* source_rows = &rows[row_start[d]];
+		int source_number_of_rows = row_start[d + 1] - row_start[d];
+		Eigen::Map<const Eigen::MatrixXd> Ld(&values[value_start[d]],
+		                                     source_number_of_rows,
+		                                     first_column[d + 1] - first_column[d]);
+
+		int m = source_number_of_rows - p;
+		int k = 0;
+		while (k < m && source_rows[p + k] < first + number_of_columns) {
+			k++;
+		}
+		update->resize(m, k);
+		update->noalias() = Ld.middleRows(p, m) * Ld.middleRows(p, k).transpose();
+
+		relative->resize(m);
+		int position = 0;
+		for (int i = 0; i < m; ++i) {
+			while (supernode_rows[position] != source_rows[p + i]) {
+				position++;
+			}
+			(*relative)[i] = position;
+		}
+
+		for (int j = 0; j < k; ++j) {
+			double* column = &L(0, source_rows[p + j] - first);
+			for (int i = j; i < m; ++i) {
+				column[(*relative)[i]] -= (*update)(i, j);
+			}
+		}
+	}
+
+	Eigen::Ref<Eigen::MatrixXd> diagonal_block = L.topRows(number_of_columns);
+	Eigen::LLT<Eigen::Ref<Eigen::MatrixXd>> llt(diagonal_block);
+	if (llt.info() != Eigen::Success) {
+		return false;
+	}
+	if (number_of_rows > number_of_columns) {
+		auto below = L.bottomRows(number_of_rows - number_of_columns);
+		diagonal_block.transpose().triangularView<Eigen::Upper>().solveInPlace<Eigen::OnTheRight>(
+		    below);
+	}
+	return true;
+}
+
+bool SupernodalSparseCholesky::Implementation::factorize(const Eigen::SparseMatrix<double>& A,
+                                                         double shift) {
+	minimum_core_assert(A.rows() == n && A.cols() == n);
+	minimum_core_assert(A.isCompressed() && A.nonZeros() == input_non_zeros,
+	                    "The pattern of A has changed since analyze_pattern.");
+	factorized = false;
+
+	std::fill(values.begin(), values.end(), 0.0);
+	const double* A_values = A.valuePtr();
+	for (std::ptrdiff_t k = 0; k < input_non_zeros; ++k) {
+		if (value_destination[k] >= 0) {
+			values[value_destination[k]] += A_values[k];
+		}
+	}
+	if (shift != 0) {
+		for (auto k : diagonal_destination) {
+			values[k] += shift;
+		}
+	}
+
+	int failed = 0;
+	for (size_t l = 0; l + 1 < level_start.size(); ++l) {
+		int begin = level_start[l];
+		int end = level_start[l + 1];
+#ifdef USE_OPENMP
+#pragma omp parallel if (end - begin > 1)
+#endif
+		{
+			Eigen::MatrixXd update;
+			std::vector<int> relative;
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+			for (int i = begin; i < end; ++i) {
+				if (!factorize_supernode(level_supernodes[i], &update, &relative)) {
+#ifdef USE_OPENMP
+#pragma omp atomic write
+#endif
+					failed = 1;
+				}
+			}
+		}
+		if (failed) {
+			return false;
+		}
+	}
+	factorized = true;
+	return true;
+}
+
+Eigen::VectorXd SupernodalSparseCholesky::Implementation::solve(const Eigen::VectorXd& b) const {
+	minimum_core_assert(factorized, "No factorization available.");
+	minimum_core_assert(b.size() == n);
+
+	Eigen::VectorXd y(n);
+	for (int i = 0; i < n; ++i) {
+		y[new_index[i]] = b[i];
+	}
+
+	Eigen::VectorXd work;
+	int S = number_of_supernodes();
+	// Solve L y = b.
+	for (int s = 0; s < S; ++s) {
+		int number_of_columns = first_column[s + 1] - first_column[s];
+		int number_of_rows = row_start[s + 1] - row_start[s];
+		int number_below = number_of_rows - number_of_columns;
+		Eigen::Map<const Eigen::MatrixXd> L(&values[value_start[s]], number_of_rows, number_of_columns);
+		auto ys = y.segment(first_column[s], number_of_columns);
+		L.topRows(number_of_columns).triangularView<Eigen::Lower>().solveInPlace(ys);
+		if (number_below > 0) {
+			work.noalias() = L.bottomRows(number_below) * ys;
+			const int* below_rows = &rows[row_start[s] + number_of_columns];
+			for (int i = 0; i < number_below; ++i) {
+				y[below_rows[i]] -= work[i];
+			}
+		}
+	}
+	// Solve L' x = y.
+	for (int s = S - 1; s >= 0; --s) {
+		int number_of_columns = first_column[s + 1] - first_column[s];
+		int number_of_rows = row_start[s + 1] - row_start[s];
+		int number_below = number_of_rows - number_of_columns;
+		Eigen::Map<const Eigen::MatrixXd> L(&values[value_start[s]], number_of_rows, number_of_columns);
+		auto ys = y.segment(first_column[s], number_of_columns);
+		if (number_below > 0) {
+			work.resize(number_below);
+			const int* below_rows = &rows[row_start[s] + number_of_columns];
+			for (int i = 0; i < number_below; ++i) {
+				work[i] = y[below_rows[i]];
+			}
+			ys.noalias() -= L.bottomRows(number_below).transpose() * work;
+		}
+		L.topRows(number_of_columns).transpose().triangularView<Eigen::Upper>().solveInPlace(ys);
+	}
+
+	Eigen::VectorXd x(n);
+	for (int i = 0; i < n; ++i) {
+		x[i] = y[new_index[i]];
+	}
+	return x;
+}
+
+SupernodalSparseCholesky::SupernodalSparseCholesky() : impl(new Implementation) {}
+
+SupernodalSparseCholesky::~SupernodalSparseCholesky() { delete impl; }
+
+void SupernodalSparseCholesky::analyze_pattern(const Eigen::SparseMatrix<double>& A) {
+	impl->analyze_pattern(A);
+}
+
+bool SupernodalSparseCholesky::factorize(const Eigen::SparseMatrix<double>& A, double shift) {
+	return impl->factorize(A, shift);
+}
+
+Eigen::VectorXd SupernodalSparseCholesky::solve(const Eigen::VectorXd& b) const {
+	return impl->solve(b);
+}
+
+std::ptrdiff_t SupernodalSparseCholesky::factor_non_zeros() const {
+	std::ptrdiff_t non_zeros = 0;
+	for (int s = 0; s < impl->number_of_supernodes(); ++s) {
+		std::ptrdiff_t number_of_columns = impl->first_column[s + 1] - impl->first_column[s];
+		std::ptrdiff_t number_of_rows = impl->row_start[s + 1] - impl->row_start[s];
+		non_zeros +=
+		    number_of_rows * number_of_columns - number_of_columns * (number_of_columns - 1) / 2;
+	}
+	return non_zeros;
+}
+
+int SupernodalSparseCholesky::number_of_supernodes() const {
+	return impl->number_of_supernodes();
+}
+}  // namespace nonlinear
+}  // namespace minimum
@@ -0,0 +1,88 @@
+#pragma once
+// Sparse Cholesky factorizations used by the Newton solver.
+//
+// The sparsity pattern of the Hessian does not change between
+// iterations, so the symbolic analysis (ordering, elimination
+// tree, structure of the factor) is performed once and reused
+// for every numeric factorization. A diagonal shift is applied
+// while the values are loaded, which makes the repeated
+// factorizations of H + tau*I in the Newton solver cheap.
+//
+
+#include <cstddef>
+#include <memory>
+
+#include <Eigen/SparseCore>
+
+#include <minimum/nonlinear/export.h>
+
+namespace minimum {
+namespace nonlinear {
+
+class MINIMUM_NONLINEAR_API SparseCholesky {
+   public:
+	virtual ~SparseCholesky();
+
+	// Performs the symbolic analysis of the pattern of A. Only the
+	// lower triangle of A is used.
+	virtual void analyze_pattern(const Eigen::SparseMatrix<double>& A) = 0;
+
+	// Computes the factorization of A + shift * I. A must be
+	// compressed and have the pattern given to analyze_pattern.
+	//
+	// Returns false if the matrix is not positive definite.
+	virtual bool factorize(const Eigen::SparseMatrix<double>& A, double shift = 0) = 0;
+
+	// Solves (A + shift * I) x = b using the last successful
+	// factorization.
+	virtual Eigen::VectorXd solve(const Eigen::VectorXd& b) const = 0;
+
+	// Number of non-zeros in the lower-triangular factor.
+	virtual std::ptrdiff_t factor_non_zeros() const = 0;
+};
+
+// Simplicial (column-by-column) factorization from Eigen.
+class MINIMUM_NONLINEAR_API SimplicialSparseCholesky : public SparseCholesky {
+   public:
+	SimplicialSparseCholesky();
+	~SimplicialSparseCholesky();
+	SimplicialSparseCholesky(const SimplicialSparseCholesky&) = delete;
+	SimplicialSparseCholesky& operator=(const SimplicialSparseCholesky&) = delete;
+
+	void analyze_pattern(const Eigen::SparseMatrix<double>& A) override;
+	bool factorize(const Eigen::SparseMatrix<double>& A, double shift = 0) override;
+	Eigen::VectorXd solve(const Eigen::VectorXd& b) const override;
+	std::ptrdiff_t factor_non_zeros() const override;
+
+   private:
+	class Implementation;
+	Implementation* impl;
+};
+
+// Supernodal factorization. Consecutive columns of the factor
+// with identical structure are stored as dense blocks, so that
+// almost all floating-point work is done by dense kernels.
+//
+// Supernodes whose subtrees in the elimination tree are disjoint
+// are factorized in parallel.
+class MINIMUM_NONLINEAR_API SupernodalSparseCholesky : public SparseCholesky {
+   public:
+	SupernodalSparseCholesky();
+	~SupernodalSparseCholesky();
+	SupernodalSparseCholesky(const SupernodalSparseCholesky&) = delete;
+	SupernodalSparseCholesky& operator=(const SupernodalSparseCholesky&) = delete;
+
+	void analyze_pattern(const Eigen::SparseMatrix<double>& A) override;
+	bool factorize(const Eigen::SparseMatrix<double>& A, double shift = 0) override;
+	Eigen::VectorXd solve(const Eigen::VectorXd& b) const override;
+	std::ptrdiff_t factor_non_zeros() const override;
+
+	// Number of supernodes found by analyze_pattern.
+	int number_of_supernodes() const;
+
+   private:
+	class Implementation;
+	Implementation* impl;
+};
+}  // namespace nonlinear
+}  // namespace minimum
@@ -0,0 +1,133 @@
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+
+#include <Eigen/Dense>
+
+#include <minimum/nonlinear/sparse_cholesky.h>
+
+using namespace minimum::nonlinear;
+
+namespace {
+// Laplacian of a k×k grid plus random couplings. Positive definite.
+Eigen::SparseMatrix<double> create_matrix(int k, int extra, std::mt19937* engine) {
+	int n = k * k;
+	std::uniform_int_distribution<int> index(0, n - 1);
+	std::uniform_real_distribution<double> value(-1, 1);
+	std::vector<Eigen::Triplet<double>> entries;
+	std::vector<double> diagonal(n, 0.1);
+	auto add = [&](int i, int j, double v) {
+		entries.emplace_back(i, j, v);
+		entries.emplace_back(j, i, v);
+		diagonal[i] += std::abs(v);
+		diagonal[j] += std::abs(v);
+	};
+	for (int x = 0; x < k; ++x) {
+		for (int y = 0; y < k; ++y) {
+			if (x + 1 < k) {
+				add(x * k + y, (x + 1) * k + y, -1);
+			}
+			if (y + 1 < k) {
+				add(x * k + y, x * k + y + 1, -1);
+			}
+		}
+	}
+	for (int l = 0; l < extra; ++l) {
+		int i = index(*engine);
+		int j = index(*engine);
+		if (i != j) {
+			add(i, j, value(*engine));
+		}
+	}
+	for (int i = 0; i < n; ++i) {
+		entries.emplace_back(i, i, diagonal[i]);
+	}
+	Eigen::SparseMatrix<double> A(n, n);
+	A.setFromTriplets(entries.begin(), entries.end());
+	A.makeCompressed();
+	return A;
+}
+
+void test_solve(SparseCholesky* cholesky) {
+	std::mt19937 engine(0);
+	auto A = create_matrix(20, 50, &engine);
+	Eigen::VectorXd b = Eigen::VectorXd::Random(A.rows());
+	Eigen::MatrixXd dense = A;
+
+	cholesky->analyze_pattern(A);
+	REQUIRE(cholesky->factorize(A));
+	Eigen::VectorXd x = cholesky->solve(b);
+	CHECK((dense * x - b).norm() < 1e-10 * b.norm());
+
+	// New values with the same pattern.
+	A *= 2.0;
+	REQUIRE(cholesky->factorize(A));
+	x = cholesky->solve(b);
+	CHECK((2.0 * dense * x - b).norm() < 1e-10 * b.norm());
+
+	// Shifted factorization.
+	REQUIRE(cholesky->factorize(A, 3.0));
+	x = cholesky->solve(b);
+	Eigen::MatrixXd shifted = 2.0 * dense;
+	shifted.diagonal().array() += 3.0;
+	CHECK((shifted * x - b).norm() < 1e-10 * b.norm());
+
+	// Not positive definite.
+	CHECK_FALSE(cholesky->factorize(A, -100.0));
+	REQUIRE(cholesky->factorize(A, 0.0));
+	CHECK(cholesky->factor_non_zeros() >= A.rows());
+}
+}  // namespace
+
+TEST_CASE("simplicial") {
+	SimplicialSparseCholesky cholesky;
+	test_solve(&cholesky);
+}
+
+TEST_CASE("supernodal") {
+	SupernodalSparseCholesky cholesky;
+	test_solve(&cholesky);
+	CHECK(cholesky.number_of_supernodes() < 400);
+}
+
+TEST_CASE("supernodal_lower_triangle") {
+	std::mt19937 engine(1);
+	auto A = create_matrix(15, 20, &engine);
+	Eigen::SparseMatrix<double> lower = A.triangularView<Eigen::Lower>();
+	lower.makeCompressed();
+	Eigen::VectorXd b = Eigen::VectorXd::Random(A.rows());
+
+	SupernodalSparseCholesky supernodal;
+	supernodal.analyze_pattern(lower);
+	REQUIRE(supernodal.factorize(lower));
+	SimplicialSparseCholesky simplicial;
+	simplicial.analyze_pattern(A);
+	REQUIRE(simplicial.factorize(A));
+
+	CHECK((supernodal.solve(b) - simplicial.solve(b)).norm() < 1e-10);
+	CHECK(supernodal.factor_non_zeros() == simplicial.factor_non_zeros());
+}
+
+TEST_CASE("supernodal_dense") {
+	Eigen::MatrixXd B = Eigen::MatrixXd::Random(30, 30);
+	Eigen::MatrixXd dense = B * B.transpose() + Eigen::MatrixXd::Identity(30, 30);
+	Eigen::SparseMatrix<double> A = dense.sparseView();
+	A.makeCompressed();
+	Eigen::VectorXd b = Eigen::VectorXd::Random(30);
+
+	SupernodalSparseCholesky cholesky;
+	cholesky.analyze_pattern(A);
+	CHECK(cholesky.number_of_supernodes() == 1);
+	REQUIRE(cholesky.factorize(A));
+	CHECK((dense * cholesky.solve(b) - b).norm() < 1e-10);
+}
+
+TEST_CASE("supernodal_empty") {
+	Eigen::SparseMatrix<double> A(0, 0);
+	A.makeCompressed();
+	SupernodalSparseCholesky cholesky;
+	cholesky.analyze_pattern(A);
+	CHECK(cholesky.factorize(A));
+	CHECK(cholesky.solve(Eigen::VectorXd(0)).size() == 0);
+}
@@ -1,67 +1,55 @@
 #pragma once
 
 #include <minimum/core/parser.h>
-#include <minimum/core/range.h>
-using minimum::core::range;
 
 namespace minimum::nonlinear {
 // Functor that can be used with AutoDiffTerm or DynamicAutoDiffTerm.
 //
 // It parses a string at runtime to determine the expression to evaluate.
+// The expression is compiled once, so evaluating it does not look up
+// identifiers or allocate memory.
 class StringFunctor1 {
    public:
 	StringFunctor1(std::string_view expr, std::vector<std::string> names_)
-	    : expression(minimum::core::Parser(expr).parse()), names(names_) {}
+	    : StringFunctor1(minimum::core::Parser(expr).parse(), std::move(names_)) {}
 	StringFunctor1(minimum::core::Expression expression_, std::vector<std::string> names_)
-	    : expression(std::move(expression_)), names(names_) {}
+	    : expression(expression_, names_), names(std::move(names_)) {}
 
 	template <typename R>
 	R operator()(const R* const x) const {
-		std::unordered_map<std::string, R> vars;
-		for (auto i : range(names.size())) {
-			vars[names[i]] = x[i];
-		}
-		return expression.evaluate<R>(vars);
+		return expression.evaluate<R>(x);
 	}
 
 	template <typename R>
 	R operator()(const std::vector<int>& dimensions, const R* const* const x) const {
 		minimum_core_assert(dimensions.size() == 1);
 		minimum_core_assert(dimensions[0] == names.size());
-
-		std::unordered_map<std::string, R> vars;
-		for (auto i : range(names.size())) {
-			vars[names[i]] = x[0][i];
-		}
-		return expression.evaluate<R>(vars);
+		return expression.evaluate<R>(x[0]);
 	}
 
    private:
-	const minimum::core::Expression expression;
+	const minimum::core::CompiledExpression expression;
 	const std::vector<std::string> names;
 };
 
 class StringFunctorN {
    public:
 	StringFunctorN(std::string_view expr, std::vector<std::string> names_)
-	    : expression(minimum::core::Parser(expr).parse()), names(names_) {}
+	    : StringFunctorN(minimum::core::Parser(expr).parse(), std::move(names_)) {}
 	StringFunctorN(minimum::core::Expression expression_, std::vector<std::string> names_)
-	    : expression(std::move(expression_)), names(names_) {}
+	    : expression(expression_, names_), names(std::move(names_)) {}
 
 	template <typename R>
 	R operator()(const std::vector<int>& dimensions, const R* const* const x) const {
 		minimum_core_assert(dimensions.size() == names.size());
-
-		std::unordered_map<std::string, R> vars;
-		for (auto i : range(names.size())) {
-			minimum_core_assert(dimensions[i] == 1);
-			vars[names[i]] = x[i][0];
+		for (auto dimension : dimensions) {
+			minimum_core_assert(dimension == 1);
 		}
-		return expression.evaluate<R>(vars);
+		return expression.evaluate_scalars<R>(x);
 	}
 
    private:
-	const minimum::core::Expression expression;
+	const minimum::core::CompiledExpression expression;
 	const std::vector<std::string> names;
 };
 }  // namespace minimum::nonlinear
@@ -51,3 +51,25 @@ TEST_CASE("n_var_dynamic") {
 	CHECK(gradient[0][0] == Approx(14));
 	CHECK(gradient[1][0] == Approx(28));
 }
+
+TEST_CASE("1_var_hessian") {
+	AutoDiffTerm<StringFunctor1, 2> term("x^2*y + exp(x*y) + 2*exp(x*y) - 3/y",
+	                                     std::vector<std::string>{"x", "y"});
+	double vars[] = {0.5, 2};
+	std::vector<double*> all_vars = {vars};
+	double x = vars[0];
+	double y = vars[1];
+
+	std::vector<Eigen::VectorXd> gradient;
+	gradient.push_back(Eigen::VectorXd(2));
+	std::vector<std::vector<Eigen::MatrixXd>> hessian(1);
+	hessian[0].push_back(Eigen::MatrixXd(2, 2));
+	CHECK(term.evaluate(all_vars.data(), &gradient, &hessian)
+	      == Approx(x * x * y + 3 * std::exp(x * y) - 3 / y));
+	CHECK(gradient[0][0] == Approx(2 * x * y + 3 * y * std::exp(x * y)));
+	CHECK(gradient[0][1] == Approx(x * x + 3 * x * std::exp(x * y) + 3 / (y * y)));
+	CHECK(hessian[0][0](0, 0) == Approx(2 * y + 3 * y * y * std::exp(x * y)));
+	CHECK(hessian[0][0](0, 1)
+	      == Approx(2 * x + 3 * std::exp(x * y) + 3 * x * y * std::exp(x * y)));
+	CHECK(hessian[0][0](1, 1) == Approx(3 * x * x * std::exp(x * y) - 6 / (y * y * y)));
+}
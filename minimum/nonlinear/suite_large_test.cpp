@@ -22,6 +22,13 @@ class NewtonSolverSymIldl : public NewtonSolver
 	}
 };
 
+class NewtonSolverSupernodal : public NewtonSolver {
+   public:
+	NewtonSolverSupernodal() {
+		this->factorization_method = NewtonSolver::FactorizationMethod::SUPERNODAL;
+	}
+};
+
 template <typename SolverClass>
 void run_test_main(const std::function<void(std::vector<double>&, Function*)>& create_f,
                    const std::function<std::vector<double>(int)>& start,
@@ -70,6 +77,20 @@ void run_test(const std::function<void(std::vector<double>&, Function*)>& create
 		SECTION("Newton-SymILDL-10000", "") {
 			run_test_main<NewtonSolverSymIldl>(create_f, start, 10000);
 		}
+
+		SECTION("Newton-Supernodal-100", "") {
+			run_test_main<NewtonSolverSupernodal>(create_f, start, 100);
+		}
+		SECTION("Newton-Supernodal-1000", "") {
+			run_test_main<NewtonSolverSupernodal>(create_f, start, 1000);
+		}
+		SECTION("Newton-Supernodal-10000", "") {
+			run_test_main<NewtonSolverSupernodal>(create_f, start, 10000);
+		}
+
+		SECTION("NewtonCG-100", "") { run_test_main<NewtonCGSolver>(create_f, start, 100); }
+		SECTION("NewtonCG-1000", "") { run_test_main<NewtonCGSolver>(create_f, start, 1000); }
+		SECTION("NewtonCG-10000", "") { run_test_main<NewtonCGSolver>(create_f, start, 10000); }
 	}
 
 	SECTION("LBFGS-100", "") { run_test_main<LBFGSSolver>(create_f, start, 100); }
@@ -0,0 +1,74 @@
+// Petter Strandmark
+//
+// Test functions from
+// Jorge J. More, Burton S. Garbow and Kenneth E. Hillstrom,
+// "Testing unconstrained optimization software",
+// Transactions on Mathematical Software 7(1):17-41, 1981.
+// http://www.caam.rice.edu/~zhang/caam454/nls/MGH.pdf
+//
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include <minimum/nonlinear/google_test_compatibility.h>
+#include <catch.hpp>
+
+#include <minimum/core/string.h>
+#include <minimum/nonlinear/auto_diff_term.h>
+#include <minimum/nonlinear/solver.h>
+using minimum::core::to_string;
+
+using namespace minimum::nonlinear;
+
+std::stringstream global_string_stream;
+void info_log_function(const std::string& str) { global_string_stream << str << "\n"; }
+
+std::unique_ptr<Solver> create_solver() {
+	std::unique_ptr<NewtonCGSolver> solver(new NewtonCGSolver);
+
+	solver->maximum_iterations = 1000;
+
+	solver->function_improvement_tolerance = 0;
+	solver->argument_improvement_tolerance = 0;
+	solver->gradient_tolerance = 1e-7;
+
+	solver->log_function = info_log_function;
+
+	return std::move(solver);
+}
+
+template <typename Functor, int dimension>
+double run_test(double* var, const Solver* solver = 0) {
+	Function f;
+
+	f.add_variable(var, dimension);
+	f.add_term(std::make_shared<AutoDiffTerm<Functor, dimension>>(), var);
+
+	auto own_solver = create_solver();
+	if (solver == 0) {
+		solver = own_solver.get();
+	}
+
+	SolverResults results;
+	global_string_stream.str("");
+	solver->solve(f, &results);
+	INFO(global_string_stream.str());
+	INFO(results);
+
+	std::stringstream sout;
+	f.print_timing_information(sout);
+	for (int i = 0; i < dimension; ++i) {
+		sout << "x" << i + 1 << " = " << var[i] << ",  ";
+	}
+	INFO(sout.str());
+
+	EXPECT_TRUE(results.exit_condition == SolverResults::GRADIENT_TOLERANCE);
+	EXPECT_TRUE(results.hessian_vector_products > 0);
+
+	return f.evaluate();
+}
+
+#include "suite_more_et_al.h"
+#include "suite_test_opt.h"
+#include "suite_uctp.h"
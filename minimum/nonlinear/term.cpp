@@ -12,6 +12,56 @@ Interval<double> Term::evaluate_interval(const Interval<double>* const* const va
 	return {0, 0};
 };
 
+double Term::evaluate_batch(const Term* const* terms,
+                            int number_of_terms,
+                            double* const* const* variables,
+                            double* gradients) const {
+	std::vector<Eigen::VectorXd> gradient;
+	double value = 0;
+	for (int k = 0; k < number_of_terms; ++k) {
+		// Terms of the same type may still have different dimensions.
+		auto term = terms[k];
+		gradient.resize(term->number_of_variables());
+		for (int var = 0; var < term->number_of_variables(); ++var) {
+			gradient[var].resize(term->variable_dimension(var));
+		}
+
+		value += term->evaluate(variables[k], &gradient);
+		for (const auto& part : gradient) {
+			for (int i = 0; i < part.size(); ++i) {
+				*gradients++ = part[i];
+			}
+		}
+	}
+	return value;
+}
+
+void Term::hessian_vector_product(double* const* const variables,
+                                  const double* const* directions,
+                                  double* result) const {
+	int n = number_of_variables();
+	std::vector<Eigen::VectorXd> gradient(n);
+	std::vector<std::vector<Eigen::MatrixXd>> hessian(n, std::vector<Eigen::MatrixXd>(n));
+	for (int var0 = 0; var0 < n; ++var0) {
+		gradient[var0].resize(variable_dimension(var0));
+		for (int var1 = 0; var1 < n; ++var1) {
+			hessian[var0][var1].resize(variable_dimension(var0), variable_dimension(var1));
+		}
+	}
+
+	evaluate(variables, &gradient, &hessian);
+
+	for (int var0 = 0; var0 < n; ++var0) {
+		Eigen::Map<Eigen::VectorXd> part(result, variable_dimension(var0));
+		part.setZero();
+		for (int var1 = 0; var1 < n; ++var1) {
+			Eigen::Map<const Eigen::VectorXd> direction(directions[var1], variable_dimension(var1));
+			part += hessian[var0][var1] * direction;
+		}
+		result += variable_dimension(var0);
+	}
+}
+
 void Term::read(std::istream& in) {}
 
 void Term::write(std::ostream& out) const {}
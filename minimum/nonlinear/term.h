@@ -32,6 +32,30 @@ class MINIMUM_NONLINEAR_API Term {
 	                        std::vector<Eigen::VectorXd>* gradient,
 	                        std::vector<std::vector<Eigen::MatrixXd>>* hessian) const = 0;
 
+	// Evaluates several terms with the same concrete type as this term and
+	// returns the sum of their values. variables[k] are the variables of
+	// terms[k]. The gradients of all terms are written consecutively to
+	// gradients, one variable after the other.
+	//
+	// The default implementation calls evaluate for every term. Overload
+	// this to avoid the virtual call and temporary storage per term.
+	// AutoDiffTerm evaluates several terms at once in SIMD lanes if its
+	// functor allows it (see has_lane_evaluation).
+	virtual double evaluate_batch(const Term* const* terms,
+	                              int number_of_terms,
+	                              double* const* const* variables,
+	                              double* gradients) const;
+
+	// Computes the product of the Hessian of the term with a vector without
+	// forming the Hessian. directions[var] is the part of the vector for
+	// variable var. The product is written to result, one variable after the
+	// other.
+	//
+	// The default implementation evaluates the full Hessian of the term.
+	virtual void hessian_vector_product(double* const* const variables,
+	                                    const double* const* directions,
+	                                    double* result) const;
+
 	// This function only needs to be implemented if interval arithmetic is
 	// desired.
 	virtual Interval<double> evaluate_interval(
@@ -721,3 +721,70 @@ TEST_CASE("Term/IntervalsNotImplemented") {
 	variables.push_back(x);
 	CHECK_THROWS(term.evaluate_interval(variables.data()));
 }
+
+template <bool lanes>
+struct LaneTestFunctor {
+	static constexpr bool evaluate_in_lanes = lanes;
+	static int lane_calls;
+
+	template <typename R>
+	R operator()(const R* x, const R* y) const {
+		if constexpr (std::is_same_v<R, F<Lanes<double, default_lane_width>, 5>>) {
+			lane_calls++;
+		}
+		R r = x[0] * y[0] + x[1] * y[1] - 2 * y[2];
+		return exp(-r * r) + sqrt(x[0] * x[0] + 1.0) * sin(y[1]) + 1 / (1 + y[2] * y[2])
+		       + pow(x[1] * x[1] + 1, 1.5) - cos(y[0]) / 3 + log(2 + x[0] * x[0]) + atan(x[1]);
+	}
+};
+
+template <bool lanes>
+int LaneTestFunctor<lanes>::lane_calls = 0;
+
+TEST_CASE("AutoDiffTerm/evaluate_batch_in_lanes") {
+	static_assert(has_lane_evaluation<LaneTestFunctor<true>>::value);
+	static_assert(!has_lane_evaluation<LaneTestFunctor<false>>::value);
+	static_assert(!has_lane_evaluation<MyFunctor1>::value);
+
+	constexpr int W = default_lane_width;
+	// Three full groups of lanes and one term evaluated on its own.
+	const int n = 3 * W + 1;
+	std::vector<double> data(5 * n);
+	for (int i = 0; i < data.size(); ++i) {
+		data[i] = std::sin(0.7 * i) + 0.1 * i;
+	}
+	std::vector<std::vector<double*>> term_variables(n);
+	std::vector<double* const*> variables(n);
+	for (int k = 0; k < n; ++k) {
+		term_variables[k] = {&data[5 * k], &data[5 * k + 2]};
+		variables[k] = term_variables[k].data();
+	}
+
+	AutoDiffTerm<LaneTestFunctor<true>, 2, 3> lane_term;
+	AutoDiffTerm<LaneTestFunctor<false>, 2, 3> scalar_term;
+	std::vector<const Term*> lane_terms(n, &lane_term);
+	std::vector<const Term*> scalar_terms(n, &scalar_term);
+
+	std::vector<double> lane_gradients(5 * n);
+	std::vector<double> scalar_gradients(5 * n);
+	double lane_value =
+	    lane_term.evaluate_batch(lane_terms.data(), n, variables.data(), lane_gradients.data());
+	double scalar_value = scalar_term.evaluate_batch(
+	    scalar_terms.data(), n, variables.data(), scalar_gradients.data());
+
+	CHECK(LaneTestFunctor<true>::lane_calls == 3);
+	CHECK(LaneTestFunctor<false>::lane_calls == 0);
+	CHECK(Approx(lane_value) == scalar_value);
+	for (int i = 0; i < 5 * n; ++i) {
+		CHECK(Approx(lane_gradients[i]) == scalar_gradients[i]);
+	}
+
+	// The term evaluated on its own still agrees with the lanes.
+	std::vector<Eigen::VectorXd> gradient = {Eigen::VectorXd(2), Eigen::VectorXd(3)};
+	lane_term.evaluate(variables[0], &gradient);
+	CHECK(Approx(gradient[0][0]) == lane_gradients[0]);
+	CHECK(Approx(gradient[0][1]) == lane_gradients[1]);
+	CHECK(Approx(gradient[1][0]) == lane_gradients[2]);
+	CHECK(Approx(gradient[1][1]) == lane_gradients[3]);
+	CHECK(Approx(gradient[1][2]) == lane_gradients[4]);
+}